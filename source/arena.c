@@ -0,0 +1,182 @@
+#include <gccore.h>
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+// The header preceding every allocation within the region.
+// Its capacity is the space following it, which is more than its size once reused from the pool.
+struct ArenaHeader {
+  u32 size;
+  u32 capacity;
+};
+
+// Rounds the given size up to our alignment.
+static u32 arenaAlign(u32 size) {
+  return (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+}
+
+// Returns whether the given allocation lies within the region of the given arena.
+// An empty allocation may end the region, so it is its header that lies within.
+static bool arenaOwns(const struct Arena *arena, const void *pointer) {
+  const u8 *p = (const u8 *)pointer;
+  return arena->region != NULL && p >= arena->region + sizeof(struct ArenaHeader) && p <= arena->region + arena->capacity;
+}
+
+// Returns the header of an allocation within the region.
+static struct ArenaHeader *arenaHeader(void *pointer) {
+  return (struct ArenaHeader *)((u8 *)pointer - sizeof(struct ArenaHeader));
+}
+
+// Returns the size class serving allocations of the given size, or -1 if none does.
+static s32 arenaPoolClass(u32 size) {
+  if (size > ARENA_POOL_MAX_SIZE) {
+    return -1;
+  }
+  s32 sizeClass = 0;
+  while ((ARENA_POOL_MIN_SIZE << sizeClass) < size) {
+    sizeClass++;
+  }
+  return sizeClass;
+}
+
+// Returns the size class a freed allocation of the given capacity may serve, or -1 if none.
+static s32 arenaPoolFreeClass(u32 capacity) {
+  if (capacity < ARENA_POOL_MIN_SIZE || capacity > ARENA_POOL_MAX_SIZE) {
+    return -1;
+  }
+  s32 sizeClass = ARENA_POOL_CLASSES - 1;
+  while ((ARENA_POOL_MIN_SIZE << sizeClass) > capacity) {
+    sizeClass--;
+  }
+  return sizeClass;
+}
+
+// Prepares an arena with a region of the given size.
+// Returns false if the region could not be allocated.
+bool arenaInit(struct Arena *arena, u32 capacity) {
+  memset(arena, 0, sizeof(struct Arena));
+  if (capacity == 0) {
+    return true;
+  }
+
+  arena->region = memalign(32, capacity);
+  if (arena->region == NULL) {
+    return false;
+  }
+
+  arena->capacity = capacity;
+  return true;
+}
+
+// Allocates the given amount of bytes, returning NULL on failure.
+void *arenaAlloc(struct Arena *arena, u32 size) {
+  // Small allocations are served from the pool first.
+  s32 sizeClass = arenaPoolClass(size);
+  if (sizeClass >= 0 && arena->pool[sizeClass] != NULL) {
+    void *pointer = arena->pool[sizeClass];
+    arena->pool[sizeClass] = *(void **)pointer;
+    struct ArenaHeader *header = arenaHeader(pointer);
+    header->size = size;
+    arena->wasted -= sizeof(struct ArenaHeader) + header->capacity;
+    arena->reused++;
+    return pointer;
+  }
+
+  u32 length = sizeof(struct ArenaHeader) + arenaAlign(size);
+  if (size > arena->capacity || length > arena->capacity - arena->used) {
+    arena->overflows++;
+    return malloc(size);
+  }
+
+  struct ArenaHeader *header = (struct ArenaHeader *)(arena->region + arena->used);
+  header->size = size;
+  header->capacity = arenaAlign(size);
+  arena->last = arena->used;
+  arena->used += length;
+  if (arena->used > arena->peak) {
+    arena->peak = arena->used;
+  }
+
+  return header + 1;
+}
+
+// Resizes an allocation, returning NULL on failure.
+void *arenaRealloc(struct Arena *arena, void *pointer, u32 size) {
+  if (pointer == NULL) {
+    return arenaAlloc(arena, size);
+  }
+  if (!arenaOwns(arena, pointer)) {
+    // realloc frees an allocation resized to nothing, which would leave it dangling.
+    return realloc(pointer, size > 0 ? size : 1);
+  }
+
+  struct ArenaHeader *header = arenaHeader(pointer);
+  u32 start = (u8 *)header - arena->region;
+
+  // The most recent allocation is resized in place whenever it fits.
+  if (start == arena->last && arena->used > start) {
+    u32 length = sizeof(struct ArenaHeader) + arenaAlign(size);
+    if (size <= arena->capacity && length <= arena->capacity - start) {
+      header->size = size;
+      header->capacity = arenaAlign(size);
+      arena->used = start + length;
+      if (arena->used > arena->peak) {
+        arena->peak = arena->used;
+      }
+      return pointer;
+    }
+  } else if (size <= header->capacity) {
+    header->size = size;
+    return pointer;
+  }
+
+  u32 previousSize = header->size;
+  void *moved = arenaAlloc(arena, size);
+  if (moved == NULL) {
+    return NULL;
+  }
+  memcpy(moved, pointer, previousSize < size ? previousSize : size);
+  arenaFree(arena, pointer);
+  return moved;
+}
+
+// Frees an allocation.
+void arenaFree(struct Arena *arena, void *pointer) {
+  if (pointer == NULL) {
+    return;
+  }
+  if (!arenaOwns(arena, pointer)) {
+    free(pointer);
+    return;
+  }
+
+  struct ArenaHeader *header = arenaHeader(pointer);
+  u32 start = (u8 *)header - arena->region;
+  u32 length = sizeof(struct ArenaHeader) + header->capacity;
+
+  // The most recent allocation is simply given back.
+  if (start == arena->last && arena->used == start + length) {
+    arena->used = start;
+    return;
+  }
+
+  // Anything earlier joins the pool if small enough, and otherwise remains until the arena is destroyed.
+  arena->wasted += length;
+  s32 sizeClass = arenaPoolFreeClass(header->capacity);
+  if (sizeClass >= 0) {
+    *(void **)pointer = arena->pool[sizeClass];
+    arena->pool[sizeClass] = pointer;
+  }
+}
+
+// Releases the region of the given arena.
+void arenaDestroy(struct Arena *arena) {
+  free(arena->region);
+  arena->region = NULL;
+  arena->capacity = 0;
+  arena->used = 0;
+  arena->last = 0;
+  memset(arena->pool, 0, sizeof(arena->pool));
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <gccore.h>
+
+// Every allocation is aligned to this, and preceded by a header of the same size recording its length.
+#define ARENA_ALIGNMENT 8
+
+// Allocations freed out of order are kept for reuse in size classes of powers of two,
+// from ARENA_POOL_MIN_SIZE up to ARENA_POOL_MAX_SIZE bytes.
+#define ARENA_POOL_MIN_SIZE 16
+#define ARENA_POOL_MAX_SIZE 512
+#define ARENA_POOL_CLASSES 6
+
+// Arena hands out memory from a single contiguous region, released all at once.
+//
+// It suits state allocated together and released together, such as the central directory of
+// an archive and the arrays miniz keeps to index it. Freeing or resizing the most recent
+// allocation happens in place. Any other small allocation freed joins a pool by its size class,
+// from which later allocations of that class are served. Space of anything else freed is only
+// reclaimed once the arena is destroyed. Space freed is counted as wasted until reused.
+//
+// Allocations which do not fit within the region are made from the heap instead,
+// so that a region sized too small only costs performance.
+struct Arena {
+  u8* region;
+  u32 capacity;
+  u32 used;
+
+  // The start of the most recent allocation within the region, which may be resized in place.
+  u32 last;
+
+  // Allocations freed out of order, by size class, each linked to the next through its data.
+  void* pool[ARENA_POOL_CLASSES];
+
+  // The most of the region ever in use, the amount of it wasted by allocations freed or moved
+  // out of order, the amount of allocations served from the pool, and the amount of allocations
+  // made from the heap as they did not fit.
+  u32 peak;
+  u32 wasted;
+  u32 reused;
+  u32 overflows;
+};
+
+// Prepares an arena with a region of the given size.
+// A size of zero leaves every allocation to the heap.
+// Returns false if the region could not be allocated.
+bool arenaInit(struct Arena *arena, u32 capacity);
+
+// Allocates the given amount of bytes, returning NULL on failure.
+void *arenaAlloc(struct Arena *arena, u32 size);
+
+// Resizes an allocation, returning NULL on failure, in which case the allocation is kept.
+// As with realloc, a NULL pointer is allocated anew.
+void *arenaRealloc(struct Arena *arena, void *pointer, u32 size);
+
+// Frees an allocation.
+void arenaFree(struct Arena *arena, void *pointer);
+
+// Releases the region of the given arena, and with it every allocation made within it.
+// Allocations made from the heap must have been freed beforehand.
+void arenaDestroy(struct Arena *arena);
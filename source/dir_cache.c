@@ -0,0 +1,182 @@
+#include <errno.h>
+#include <gccore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "dir_cache.h"
+#include "main.h"
+#include "trace.h"
+
+// Initializes a cache whose root, such as "fat:", is known to exist.
+// Returns false if it could not be allocated.
+bool dirCacheInit(struct DirCache *cache, const char *root) {
+  memset(cache, 0, sizeof(struct DirCache));
+  cache->root.path = strdup(root);
+  return cache->root.path != NULL;
+}
+
+// Returns the child of the given node with the given name, creating it if necessary.
+static struct DirNode *dirCacheChild(struct DirCache *cache, struct DirNode *parent, const char *name, u32 length) {
+  u32 parentLength = strlen(parent->path);
+
+  struct DirNode *node;
+  for (node = parent->child; node != NULL; node = node->sibling) {
+    const char *nodeName = node->path + parentLength + 1;
+    if (strncmp(nodeName, name, length) == 0 && nodeName[length] == '\0') {
+      return node;
+    }
+  }
+
+  node = calloc(1, sizeof(struct DirNode));
+  if (node == NULL) {
+    return NULL;
+  }
+
+  // Our path is our parent's path, a separator, and our name.
+  node->path = malloc(parentLength + 1 + length + 1);
+  if (node->path == NULL) {
+    free(node);
+    return NULL;
+  }
+  sprintf(node->path, "%s/%.*s", parent->path, (int)length, name);
+
+  node->parent = parent;
+  node->sibling = parent->child;
+  parent->child = node;
+  cache->count++;
+  return node;
+}
+
+// Returns whether the given archive path holds a ".." component, which would leave the root.
+static bool dirCacheEscapes(const char *name) {
+  while (*name != '\0') {
+    const char *separator = strchr(name, '/');
+    u32 length = separator != NULL ? separator - name : strlen(name);
+    if (length == 2 && name[0] == '.' && name[1] == '.') {
+      return true;
+    }
+
+    if (separator == NULL) {
+      break;
+    }
+    name = separator + 1;
+  }
+
+  return false;
+}
+
+// Adds the directories needed by the given archive path to the cache.
+// Returns false on failure, updating errorMessage/errorCode appropiately.
+bool dirCacheAdd(struct DirCache *cache, const char *name, bool isDirectory) {
+  if (dirCacheEscapes(name)) {
+    sprintf(errorMessage, "Archive entry leaves the SD card's root.");
+    sprintf(errorCode, "ZIP_EXTRACT_FAILED");
+    return false;
+  }
+
+  struct DirNode *node = &cache->root;
+
+  while (*name != '\0') {
+    const char *separator = strchr(name, '/');
+
+    // The final component of a file is not a directory.
+    if (separator == NULL && !isDirectory) {
+      break;
+    }
+
+    u32 length = separator != NULL ? separator - name : strlen(name);
+    if (length > 0 && !(length == 1 && name[0] == '.')) {
+      node = dirCacheChild(cache, node, name, length);
+      if (node == NULL) {
+        sprintf(errorMessage, "Could not allocate buffer (%d).", errno);
+        sprintf(errorCode, "MEM_ALLOC_FAILED");
+        return false;
+      }
+    }
+
+    if (separator == NULL) {
+      break;
+    }
+    name = separator + 1;
+  }
+
+  // Each directory entry was once created as it was met, even if named before.
+  if (isDirectory && node != &cache->root) {
+    if (node->named) {
+      cache->duplicates++;
+    }
+    node->named = true;
+  }
+
+  return true;
+}
+
+// Creates every directory within the cache.
+//
+// Directories are visited breadth-first, so that they are ordered by depth and
+// every parent is created before its children. Each is created by its full path,
+// as the working directory is shared with every other thread.
+// Returns false on failure, updating errorMessage/errorCode appropiately.
+bool dirCacheCreate(struct DirCache *cache) {
+  if (cache->count == 0) {
+    return true;
+  }
+
+  struct DirNode **queue = malloc(cache->count * sizeof(struct DirNode *));
+  if (queue == NULL) {
+    sprintf(errorMessage, "Could not allocate buffer (%d).", errno);
+    sprintf(errorCode, "MEM_ALLOC_FAILED");
+    return false;
+  }
+
+  // Queue the children of our root, then the children of every queued directory in turn.
+  u32 queued = 0;
+  struct DirNode *node;
+  for (node = cache->root.child; node != NULL; node = node->sibling) {
+    queue[queued++] = node;
+  }
+
+  bool success = true;
+  struct DirNode *child;
+  u32 i;
+  for (i = 0; i < queued; i++) {
+    node = queue[i];
+    for (child = node->child; child != NULL; child = child->sibling) {
+      queue[queued++] = child;
+    }
+
+    TRACE_COUNT(TRACE_MKDIR_CALLS, 1);
+    if (mkdir(node->path, 0777) < 0 && errno != EEXIST) {
+      sprintf(errorMessage, "Could not create directory on SD card.");
+      sprintf(errorCode, "ZIP_EXTRACT_FAILED");
+      success = false;
+      break;
+    }
+  }
+
+  if (success) {
+    TRACE_COUNT(TRACE_MKDIR_CALLS_AVOIDED, cache->duplicates);
+  }
+  free(queue);
+  return success;
+}
+
+// Releases the given node and all nodes beneath it.
+static void dirCacheFreeNode(struct DirNode *node) {
+  while (node != NULL) {
+    struct DirNode *sibling = node->sibling;
+    dirCacheFreeNode(node->child);
+    free(node->path);
+    free(node);
+    node = sibling;
+  }
+}
+
+// Releases every directory within the cache.
+void dirCacheDestroy(struct DirCache *cache) {
+  dirCacheFreeNode(cache->root.child);
+  free(cache->root.path);
+  memset(cache, 0, sizeof(struct DirCache));
+}
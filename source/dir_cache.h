@@ -0,0 +1,50 @@
+#pragma once
+
+#include <gccore.h>
+
+// DirNode is a single directory within a DirCache.
+struct DirNode {
+  // The full path of this directory, such as "fat:/apps/example".
+  char* path;
+
+  // Whether a directory entry of the archive names this directory.
+  bool named;
+
+  struct DirNode *parent;
+  struct DirNode *child;
+  struct DirNode *sibling;
+};
+
+// DirCache is a trie of directories needed by an archive.
+//
+// Every directory an archive requires, whether given as an entry or only implied
+// by the path of a file, is added once. They are then created in a single pass,
+// ordered by depth so that parents always exist before their children.
+struct DirCache {
+  struct DirNode root;
+  u32 count;
+
+  // The amount of directory entries naming a directory already named by another.
+  // Creating the directory of each directory entry as it was met, as we once did,
+  // would have made this many more mkdir calls.
+  u32 duplicates;
+};
+
+// Initializes a cache whose root, such as "fat:", is known to exist.
+// Returns false if it could not be allocated.
+bool dirCacheInit(struct DirCache *cache, const char *root);
+
+// Adds the directories needed by the given archive path to the cache.
+// If the path is not itself a directory, only its parents are added.
+// Paths leaving the root via ".." are rejected before anything is added.
+// Returns false on failure, updating errorMessage/errorCode appropiately.
+bool dirCacheAdd(struct DirCache *cache, const char *name, bool isDirectory);
+
+// Creates every directory within the cache.
+// The mkdir calls avoided by creating each directory once, rather than once per directory
+// entry naming it, are added to the trace.
+// Returns false on failure, updating errorMessage/errorCode appropiately.
+bool dirCacheCreate(struct DirCache *cache);
+
+// Releases every directory within the cache.
+void dirCacheDestroy(struct DirCache *cache);
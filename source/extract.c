@@ -0,0 +1,740 @@
+#include <errno.h>
+#include <gccore.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "extract.h"
+#include "main.h"
+#include "region.h"
+#include "trace.h"
+
+// Our stages are given their own stacks of this size.
+#define EXTRACT_STACK_SIZE (32 * 1024)
+
+// The reader and writer spend nearly all of their time blocked on IOS,
+// so they run above the main thread. The inflater runs below it so that
+// rendering is never starved by decompression.
+#define EXTRACT_IO_PRIORITY 80
+#define EXTRACT_INFLATE_PRIORITY 48
+
+// The layout of a local file header, preceding every entry's data.
+#define ZIP_LOCAL_HEADER_SIZE 30
+#define ZIP_LOCAL_HEADER_SIG 0x04034b50
+#define ZIP_LOCAL_HEADER_FILENAME_LEN_OFS 26
+#define ZIP_LOCAL_HEADER_EXTRA_LEN_OFS 28
+
+// Marks extraction as failed, updating errorMessage/errorCode.
+// Only the first failure is reported, as later failures are typically a consequence of it.
+// If code is NULL, the error message and code already present are kept.
+static void extractorFail(struct Extractor *ex, const char *code, const char *format, ...) {
+  LWP_MutexLock(ex->lock);
+  if (!ex->failed) {
+    if (code != NULL) {
+      va_list args;
+      va_start(args, format);
+      vsprintf(errorMessage, format, args);
+      va_end(args);
+      sprintf(errorCode, "%s", code);
+    }
+    ex->failed = true;
+  }
+  LWP_MutexUnlock(ex->lock);
+}
+
+// Closes the given link by passing a block flagged EXTRACT_BLOCK_END, upon which the stage
+// it feeds finishes. Must only be called by the stage feeding the link, or in its place.
+static void extractLinkClose(struct ExtractLink *link) {
+  struct ExtractBlock *block = ringPop(&link->empty);
+  block->flags = EXTRACT_BLOCK_END;
+  block->length = 0;
+  ringPush(&link->full, block);
+}
+
+/*
+ *
+ *	Reader
+ *
+ */
+
+// Returns whether the file of the given entry already holds the entry's contents.
+// Files the journal records as finished are trusted without touching the card, as are files
+// described by the manifest as long as they have not been modified since it was saved.
+// Otherwise, existing files of the right size are hashed.
+static bool extractIsUnchanged(struct Extractor *ex, const mz_zip_archive_file_stat *fileStat) {
+  // Entries recorded by the journal were written by an interrupted launch of this same install,
+  // and synced before their checksummed batch was. Only the entries finished since the last batch,
+  // the last of which may have been cut short, are left to be checked by size and CRC-32.
+  if (ex->journal != NULL && journalIsDone(ex->journal, fileStat->m_file_index)) {
+    if (ex->mtimes != NULL) {
+      ex->mtimes[fileStat->m_file_index] = journalGetMtime(ex->journal, fileStat->m_file_index);
+    }
+    return true;
+  }
+  if (ex->mtimes == NULL) {
+    return false;
+  }
+
+  char path[EXTRACT_PATH_SIZE];
+  snprintf(path, EXTRACT_PATH_SIZE, "fat:/%s", fileStat->m_filename);
+
+  struct stat st;
+  if (stat(path, &st) != 0 || S_ISDIR(st.st_mode) || (u64)st.st_size != fileStat->m_uncomp_size) {
+    return false;
+  }
+
+  bool unchanged;
+  const struct ManifestEntry *entry = manifestFind(&ex->manifest, fileStat->m_filename);
+  if (entry != NULL && entry->mtime == st.st_mtime && entry->size == (u64)st.st_size) {
+    unchanged = entry->crc32 == fileStat->m_crc32;
+  } else {
+    u32 crc;
+    unchanged = manifestHashFile(path, ex->hashBuffer, EXTRACT_BLOCK_SIZE, &crc) && crc == fileStat->m_crc32;
+  }
+
+  if (unchanged) {
+    ex->mtimes[fileStat->m_file_index] = st.st_mtime;
+  }
+  return unchanged;
+}
+
+// Reads the compressed data of the given entry, passing it to the inflater.
+// Returns false on failure.
+static bool extractReadEntry(struct Extractor *ex, u32 index) {
+  mz_zip_archive *zip = ex->zip;
+  mz_zip_archive_file_stat stat;
+  if (!mz_zip_reader_file_stat(zip, index, &stat)) {
+    extractorFail(ex, "ZIP_EXTRACT_FAILED", "Could not read archive entry %d.", index);
+    return false;
+  }
+
+  // Directories have already been created.
+  if (stat.m_is_directory) {
+    return true;
+  }
+
+  // Files left unchanged since a previous install are not written again.
+  if (extractIsUnchanged(ex, &stat)) {
+    progressAddBytes(&ex->progress, stat.m_uncomp_size);
+    progressEntryDone(&ex->progress);
+    TRACE_COUNT(TRACE_ENTRIES_SKIPPED, 1);
+    return true;
+  }
+
+  struct ExtractBlock *block = ringPop(&ex->compressed.empty);
+  block->flags = EXTRACT_BLOCK_FIRST;
+  block->length = 0;
+
+  struct ExtractEntry *entry = &block->entry;
+  entry->index = index;
+  entry->method = stat.m_method;
+  entry->crc32 = stat.m_crc32;
+  entry->compSize = stat.m_comp_size;
+  entry->uncompSize = stat.m_uncomp_size;
+  snprintf(entry->path, EXTRACT_PATH_SIZE, "fat:/%s", stat.m_filename);
+
+  // Once a block has been taken, it must always be passed on.
+  // Upon failure, we pass it along empty. The inflater discards it.
+  if (!stat.m_is_supported || (stat.m_method != 0 && stat.m_method != MZ_DEFLATED)) {
+    extractorFail(ex, "ZIP_EXTRACT_FAILED", "Unsupported archive entry %d.", index);
+    ringPush(&ex->compressed.full, block);
+    return false;
+  }
+
+  // The entry's data follows its local header, whose length varies.
+  u8 header[ZIP_LOCAL_HEADER_SIZE];
+  mz_uint64 offset = stat.m_local_header_ofs;
+  if (zip->m_pRead(zip->m_pIO_opaque, offset, header, ZIP_LOCAL_HEADER_SIZE) != ZIP_LOCAL_HEADER_SIZE) {
+    // An error message is set by the archive's read function.
+    extractorFail(ex, NULL, NULL);
+    ringPush(&ex->compressed.full, block);
+    return false;
+  }
+  if (MZ_READ_LE32(header) != ZIP_LOCAL_HEADER_SIG) {
+    extractorFail(ex, "ZIP_EXTRACT_FAILED", "Invalid archive entry %d.", index);
+    ringPush(&ex->compressed.full, block);
+    return false;
+  }
+  offset += ZIP_LOCAL_HEADER_SIZE;
+  offset += MZ_READ_LE16(header + ZIP_LOCAL_HEADER_FILENAME_LEN_OFS);
+  offset += MZ_READ_LE16(header + ZIP_LOCAL_HEADER_EXTRA_LEN_OFS);
+
+  mz_uint64 remaining = stat.m_comp_size;
+  while (true) {
+    u32 length = remaining > EXTRACT_BLOCK_SIZE ? EXTRACT_BLOCK_SIZE : (u32)remaining;
+    if (zip->m_pRead(zip->m_pIO_opaque, offset, block->data, length) != length) {
+      extractorFail(ex, NULL, NULL);
+      ringPush(&ex->compressed.full, block);
+      return false;
+    }
+
+    block->length = length;
+    offset += length;
+    remaining -= length;
+    if (remaining == 0) {
+      block->flags |= EXTRACT_BLOCK_LAST;
+    }
+    ringPush(&ex->compressed.full, block);
+
+    if (remaining == 0 || ex->failed) {
+      return !ex->failed;
+    }
+
+    block = ringPop(&ex->compressed.empty);
+    block->flags = 0;
+    block->length = 0;
+  }
+}
+
+// The reader stage creates all directories needed by the archive, then reads every
+// entry in order, followed by a block flagged EXTRACT_BLOCK_END.
+static void *extractReader(void *arg) {
+  struct Extractor *ex = (struct Extractor *)arg;
+  TRACE_THREAD("reader");
+  TRACE_SCOPE("read");
+
+  TRACE_BEGIN(createDirs, "dirCacheCreate");
+  if (!dirCacheCreate(&ex->dirs)) {
+    // An error message is set via dirCacheCreate.
+    extractorFail(ex, NULL, NULL);
+  }
+  TRACE_END(createDirs);
+
+  u32 i;
+  for (i = 0; i < ex->entryCount && !ex->failed; i++) {
+    if (!extractReadEntry(ex, i)) {
+      break;
+    }
+  }
+
+  extractLinkClose(&ex->compressed);
+  return NULL;
+}
+
+/*
+ *
+ *	Inflater
+ *
+ */
+
+// State of the entry currently being decompressed.
+struct InflateState {
+  struct ExtractBlock *out;
+  tinfl_status status;
+  u32 index;
+  u16 method;
+  u32 crc32;
+  u32 expectedCrc32;
+  u64 produced;
+  u64 expectedSize;
+  u32 dictOffset;
+
+#if TRACE_ENABLED
+  // Time spent decompressing the entry, and its path, as the blocks holding it are passed on.
+  struct TraceTimer timer;
+  char path[EXTRACT_PATH_SIZE];
+#endif
+};
+
+// Appends decompressed data to the current output block,
+// passing blocks on to the writer as they fill.
+static void extractEmit(struct Extractor *ex, struct InflateState *state, const u8 *data, u32 length) {
+  state->crc32 = mz_crc32(state->crc32, data, length);
+  state->produced += length;
+
+  while (length > 0) {
+    struct ExtractBlock *out = state->out;
+    u32 chunk = EXTRACT_BLOCK_SIZE - out->length;
+    if (chunk > length) {
+      chunk = length;
+    }
+
+    memcpy(out->data + out->length, data, chunk);
+    out->length += chunk;
+    data += chunk;
+    length -= chunk;
+
+    if (out->length == EXTRACT_BLOCK_SIZE) {
+      ringPush(&ex->decompressed.full, out);
+      out = ringPop(&ex->decompressed.empty);
+      out->flags = 0;
+      out->length = 0;
+      state->out = out;
+    }
+  }
+}
+
+// Passes a block of a stored entry on to the writer.
+// The reader fills every block of an entry but its last, so our current output block is
+// typically empty. Its buffer is then exchanged with the input block's rather than copied.
+static void extractStore(struct Extractor *ex, struct InflateState *state, struct ExtractBlock *in) {
+  struct ExtractBlock *out = state->out;
+  if (out->length != 0) {
+    extractEmit(ex, state, in->data, in->length);
+    return;
+  }
+
+  state->crc32 = mz_crc32(state->crc32, in->data, in->length);
+  state->produced += in->length;
+
+  u8 *data = out->data;
+  out->data = in->data;
+  out->length = in->length;
+  in->data = data;
+  in->length = 0;
+
+  if (out->length == EXTRACT_BLOCK_SIZE) {
+    ringPush(&ex->decompressed.full, out);
+    out = ringPop(&ex->decompressed.empty);
+    out->flags = 0;
+    out->length = 0;
+    state->out = out;
+  }
+}
+
+// Decompresses a single block of compressed data.
+// Returns false on failure.
+static bool extractInflateBlock(struct Extractor *ex, struct InflateState *state, struct ExtractBlock *in) {
+  if (state->method == 0) {
+    extractStore(ex, state, in);
+    return true;
+  }
+
+  const u8 *input = in->data;
+  size_t inputRemaining = in->length;
+  mz_uint32 flags = (in->flags & EXTRACT_BLOCK_LAST) ? 0 : TINFL_FLAG_HAS_MORE_INPUT;
+
+  while (state->status != TINFL_STATUS_DONE) {
+    size_t inBytes = inputRemaining;
+    size_t outBytes = TINFL_LZ_DICT_SIZE - state->dictOffset;
+    state->status = tinfl_decompress(&ex->inflator, input, &inBytes, ex->dict, ex->dict + state->dictOffset, &outBytes, flags);
+    input += inBytes;
+    inputRemaining -= inBytes;
+
+    if (outBytes > 0) {
+      extractEmit(ex, state, ex->dict + state->dictOffset, outBytes);
+      state->dictOffset = (state->dictOffset + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+    }
+
+    if (state->status < 0) {
+      return false;
+    }
+    if (state->status == TINFL_STATUS_NEEDS_MORE_INPUT) {
+      break;
+    }
+  }
+
+  return true;
+}
+
+// The inflater stage decompresses and verifies every entry passed by the reader.
+static void *extractInflater(void *arg) {
+  struct Extractor *ex = (struct Extractor *)arg;
+  TRACE_THREAD("inflater");
+  TRACE_SCOPE("inflate");
+
+  struct InflateState state;
+  memset(&state, 0, sizeof(struct InflateState));
+
+  while (true) {
+    struct ExtractBlock *in = ringPop(&ex->compressed.full);
+    u32 flags = in->flags;
+
+    if (flags & EXTRACT_BLOCK_END) {
+      ringPush(&ex->compressed.empty, in);
+
+      // An entry left unfinished by a failure elsewhere still holds a block, which must be returned
+      // so that every block is available to the next archive.
+      if (state.out != NULL) {
+        ringPush(&ex->decompressed.full, state.out);
+        state.out = NULL;
+      }
+      break;
+    }
+
+    // Upon failure elsewhere, we discard our input and release any block held for the writer.
+    if (ex->failed) {
+      ringPush(&ex->compressed.empty, in);
+      if (state.out != NULL) {
+        ringPush(&ex->decompressed.full, state.out);
+        state.out = NULL;
+      }
+      continue;
+    }
+
+    if (flags & EXTRACT_BLOCK_FIRST) {
+      struct ExtractBlock *out = ringPop(&ex->decompressed.empty);
+      out->flags = EXTRACT_BLOCK_FIRST;
+      out->length = 0;
+      out->entry = in->entry;
+
+      state.out = out;
+      state.index = in->entry.index;
+      state.method = in->entry.method;
+      state.crc32 = MZ_CRC32_INIT;
+      state.expectedCrc32 = in->entry.crc32;
+      state.produced = 0;
+      state.expectedSize = in->entry.uncompSize;
+      state.dictOffset = 0;
+
+      // Stored entries need no decompression, and empty entries do not always contain a deflate stream.
+      bool inflating = in->entry.method == MZ_DEFLATED && in->entry.uncompSize > 0;
+      state.status = inflating ? TINFL_STATUS_NEEDS_MORE_INPUT : TINFL_STATUS_DONE;
+      tinfl_init(&ex->inflator);
+
+#if TRACE_ENABLED
+      strcpy(state.path, in->entry.path);
+      TRACE_TIMER_RESET(state.timer);
+#endif
+    }
+
+    TRACE_TIMER_START(state.timer);
+    bool success = extractInflateBlock(ex, &state, in);
+    TRACE_TIMER_STOP(state.timer);
+    ringPush(&ex->compressed.empty, in);
+
+    if (success && (flags & EXTRACT_BLOCK_LAST)) {
+      success = state.status == TINFL_STATUS_DONE;
+      success = success && state.produced == state.expectedSize;
+      success = success && state.crc32 == state.expectedCrc32;
+    }
+
+    if (!success) {
+      extractorFail(ex, "ZIP_EXTRACT_FAILED", "Could not decompress archive entry %d.", state.index);
+    }
+
+    // Pass on our current block once the entry is complete, or immediately upon failure.
+    if (!success || (flags & EXTRACT_BLOCK_LAST)) {
+      if (success) {
+        state.out->flags |= EXTRACT_BLOCK_LAST;
+        TRACE_COUNT(TRACE_BYTES_INFLATED, state.produced);
+        TRACE_ENTRY(TRACE_STAGE_INFLATE, state.path, state.timer);
+      }
+      ringPush(&ex->decompressed.full, state.out);
+      state.out = NULL;
+    }
+  }
+
+  // Inform the writer that we are finished.
+  extractLinkClose(&ex->decompressed);
+  return NULL;
+}
+
+/*
+ *
+ *	Writer
+ *
+ */
+
+// The writer stage writes every entry passed by the inflater to the SD card.
+static void *extractWriter(void *arg) {
+  struct Extractor *ex = (struct Extractor *)arg;
+  TRACE_THREAD("writer");
+  TRACE_SCOPE("write");
+
+  struct FatWriter *writer = &ex->writer;
+  bool fileOpen = false;
+
+  // The entry being written, whose details are only present on its first block.
+  u32 index = 0;
+  char path[EXTRACT_PATH_SIZE];
+#if TRACE_ENABLED
+  // The time spent on the current entry, and on extraction as a whole.
+  // As the first stage started and the last to finish, the writer spans all of extraction.
+  struct TraceTimer timer = {0, 0};
+  struct TraceTimer elapsed = {0, 0};
+  u32 allocations = traceAllocationCount();
+#endif
+  TRACE_TIMER_START(elapsed);
+
+  while (true) {
+    struct ExtractBlock *block = ringPop(&ex->decompressed.full);
+    u32 flags = block->flags;
+
+    if (flags & EXTRACT_BLOCK_END) {
+      ringPush(&ex->decompressed.empty, block);
+      break;
+    }
+
+    if (ex->failed) {
+      ringPush(&ex->decompressed.empty, block);
+      continue;
+    }
+
+    bool success = true;
+    TRACE_TIMER_START(timer);
+    if (flags & EXTRACT_BLOCK_FIRST) {
+      index = block->entry.index;
+      strcpy(path, block->entry.path);
+      progressSetCaption(&ex->progress, path);
+      TRACE_TIMER_RESET(timer);
+
+      fileOpen = fatWriterOpen(writer, block->entry.path, block->entry.uncompSize);
+      if (!fileOpen) {
+        extractorFail(ex, "ZIP_EXTRACT_FAILED", "Could not extract file to SD card.");
+        success = false;
+      }
+    }
+
+    if (success && block->length > 0) {
+      if (!fatWriterWrite(writer, block->data, block->length)) {
+        extractorFail(ex, "ZIP_EXTRACT_FAILED", "Could not write file to SD card.");
+        success = false;
+      } else {
+        progressAddBytes(&ex->progress, block->length);
+      }
+    }
+    TRACE_TIMER_STOP(timer);
+
+    if (success && (flags & EXTRACT_BLOCK_LAST)) {
+      TRACE_TIMER_START(timer);
+      if (!fatWriterClose(writer)) {
+        extractorFail(ex, "ZIP_EXTRACT_FAILED", "Could not write file to SD card.");
+      }
+      fileOpen = false;
+      TRACE_TIMER_STOP(timer);
+      TRACE_ENTRY(TRACE_STAGE_WRITE, path, timer);
+      TRACE_COUNT(TRACE_ENTRIES_WRITTEN, 1);
+
+      // Its modification time is only final once closed.
+      struct stat st;
+      time_t mtime = 0;
+      if (ex->mtimes != NULL && stat(path, &st) == 0) {
+        mtime = st.st_mtime;
+        ex->mtimes[index] = mtime;
+      }
+      if (ex->journal != NULL && !ex->failed) {
+        journalAdd(ex->journal, index, mtime);
+      }
+      progressEntryDone(&ex->progress);
+    }
+
+    ringPush(&ex->decompressed.empty, block);
+  }
+
+  // Close any file left partially written by a failure.
+  if (fileOpen) {
+    fatWriterAbort(writer);
+  }
+
+  // The manifest only spares work for later installs, so failing to save it is not an error.
+  if (!ex->failed && ex->mtimes != NULL) {
+    manifestSave(ex->manifestPath, ex->zip, ex->mtimes);
+  }
+
+  TRACE_TIMER_STOP(elapsed);
+  TRACE_COUNT(TRACE_EXTRACT_MICROSECONDS, ticks_to_microsecs(elapsed.ticks));
+  TRACE_COUNT(TRACE_EXTRACT_ALLOCATIONS, traceAllocationCount() - allocations);
+
+  progressFinish(&ex->progress);
+  return NULL;
+}
+
+/*
+ *
+ *	Setup
+ *
+ */
+
+// Allocates the blocks of a link and queues them as empty.
+// Every block's buffer has the same size and alignment, allowing buffers to be exchanged between links.
+static bool extractLinkInit(struct ExtractLink *link, u32 depth) {
+  link->depth = depth < EXTRACT_RING_MAX_DEPTH ? depth : EXTRACT_RING_MAX_DEPTH;
+  if (!ringInit(&link->full, link->depth) || !ringInit(&link->empty, link->depth)) {
+    return false;
+  }
+
+  u32 i;
+  for (i = 0; i < link->depth; i++) {
+    link->blocks[i].data = regionAlloc(REGION_MEM2, EXTRACT_BLOCK_SIZE);
+    if (link->blocks[i].data == NULL) {
+      return false;
+    }
+    ringPush(&link->empty, &link->blocks[i]);
+  }
+
+  return true;
+}
+
+// Releases the blocks of a link.
+static void extractLinkDestroy(struct ExtractLink *link) {
+  u32 i;
+  for (i = 0; i < link->depth; i++) {
+    regionFree(link->blocks[i].data);
+    link->blocks[i].data = NULL;
+  }
+
+  ringDestroy(&link->full);
+  ringDestroy(&link->empty);
+}
+
+// Prepares an extractor, allocating all of its buffers.
+// Returns false on failure, updating errorMessage/errorCode appropiately.
+bool extractorInit(struct Extractor *ex) {
+  memset(ex, 0, sizeof(struct Extractor));
+  ex->readerThread = LWP_THREAD_NULL;
+  ex->inflaterThread = LWP_THREAD_NULL;
+  ex->writerThread = LWP_THREAD_NULL;
+  LWP_MutexInit(&ex->lock, false);
+
+  // The dictionary is touched for every byte inflated, whereas blocks are passed through once.
+  // Our inflator and miniz's CRC tables are already within MEM1, alongside our executable.
+  const struct RegionPlan *plan = regionGetPlan();
+  ex->dict = regionAlloc(REGION_MEM1, TINFL_LZ_DICT_SIZE);
+  ex->hashBuffer = regionAlloc(REGION_MEM2, EXTRACT_BLOCK_SIZE);
+  if (ex->dict == NULL || ex->hashBuffer == NULL || !extractLinkInit(&ex->compressed, plan->ringDepth) ||
+      !extractLinkInit(&ex->decompressed, plan->ringDepth) || !fatWriterInit(&ex->writer, "fat:/", plan->writerSize)) {
+    sprintf(errorMessage, "Could not allocate buffer (%d).", errno);
+    sprintf(errorCode, "MEM_ALLOC_FAILED");
+    return false;
+  }
+
+  return true;
+}
+
+// Prepares the extractor to extract the given archive.
+// Returns false on failure, updating errorMessage/errorCode appropiately.
+bool extractorLoad(struct Extractor *ex, mz_zip_archive *zip, const char *manifestPath, struct Journal *journal) {
+  TRACE_SCOPE("extractorLoad");
+  ex->entryCount = mz_zip_reader_get_num_files(zip);
+  ex->failed = false;
+  ex->journal = journal;
+
+  // Collect the directories needed by every entry, and the amount of data to write.
+  // Progress is weighted by the amount of data written.
+  if (!dirCacheInit(&ex->dirs, "fat:")) {
+    sprintf(errorMessage, "Could not allocate buffer (%d).", errno);
+    sprintf(errorCode, "MEM_ALLOC_FAILED");
+    return false;
+  }
+
+  u64 bytesTotal = 0;
+  u32 fileCount = 0;
+  u32 i;
+  for (i = 0; i < ex->entryCount; i++) {
+    mz_zip_archive_file_stat stat;
+    if (!mz_zip_reader_file_stat(zip, i, &stat)) {
+      continue;
+    }
+
+    if (!dirCacheAdd(&ex->dirs, stat.m_filename, stat.m_is_directory)) {
+      // An error message is set via dirCacheAdd.
+      dirCacheDestroy(&ex->dirs);
+      return false;
+    }
+
+    if (!stat.m_is_directory) {
+      bytesTotal += stat.m_uncomp_size;
+      fileCount++;
+    }
+  }
+  progressInit(&ex->progress, bytesTotal, fileCount);
+
+  if (manifestPath != NULL) {
+    ex->mtimes = calloc(ex->entryCount, sizeof(time_t));
+    if (ex->mtimes == NULL) {
+      sprintf(errorMessage, "Could not allocate buffer (%d).", errno);
+      sprintf(errorCode, "MEM_ALLOC_FAILED");
+      dirCacheDestroy(&ex->dirs);
+      progressDestroy(&ex->progress);
+      return false;
+    }
+
+    snprintf(ex->manifestPath, MANIFEST_PATH_SIZE, "%s", manifestPath);
+    manifestLoad(&ex->manifest, manifestPath);
+  }
+
+  ex->zip = zip;
+  return true;
+}
+
+// Starts the given stage on a thread of its own, leaving its thread null should it not start.
+static s32 extractStartStage(struct Extractor *ex, lwp_t *thread, void *(*stage)(void *), u8 priority) {
+  s32 ret = LWP_CreateThread(thread, stage, ex, NULL, EXTRACT_STACK_SIZE, priority);
+  if (ret < 0) {
+    *thread = LWP_THREAD_NULL;
+  }
+  return ret;
+}
+
+// Starts extraction on background threads.
+// Returns false on failure, updating errorMessage/errorCode appropiately.
+bool extractorStart(struct Extractor *ex) {
+  s32 ret = extractStartStage(ex, &ex->writerThread, extractWriter, EXTRACT_IO_PRIORITY);
+  if (ret >= 0) {
+    ret = extractStartStage(ex, &ex->inflaterThread, extractInflater, EXTRACT_INFLATE_PRIORITY);
+  }
+  if (ret >= 0) {
+    ret = extractStartStage(ex, &ex->readerThread, extractReader, EXTRACT_IO_PRIORITY);
+  }
+
+  if (ret < 0) {
+    extractorFail(ex, "ZIP_EXTRACT_FAILED", "Could not start extraction (%d).", ret);
+
+    // Any stage already started waits on its link, so we close it in place of the stage
+    // that would have fed it. Every stage discards what it is given once extraction has failed,
+    // then closes the link it feeds in turn.
+    if (ex->inflaterThread != LWP_THREAD_NULL) {
+      extractLinkClose(&ex->compressed);
+    } else if (ex->writerThread != LWP_THREAD_NULL) {
+      extractLinkClose(&ex->decompressed);
+    }
+    extractorWait(ex);
+    return false;
+  }
+
+  return true;
+}
+
+// Waits for extraction to finish.
+// Returns false on failure, with errorMessage/errorCode updated by the failing stage.
+bool extractorWait(struct Extractor *ex) {
+  if (ex->readerThread != LWP_THREAD_NULL) {
+    LWP_JoinThread(ex->readerThread, NULL);
+    ex->readerThread = LWP_THREAD_NULL;
+  }
+  if (ex->inflaterThread != LWP_THREAD_NULL) {
+    LWP_JoinThread(ex->inflaterThread, NULL);
+    ex->inflaterThread = LWP_THREAD_NULL;
+  }
+  if (ex->writerThread != LWP_THREAD_NULL) {
+    LWP_JoinThread(ex->writerThread, NULL);
+    ex->writerThread = LWP_THREAD_NULL;
+  }
+
+  return !ex->failed;
+}
+
+// Releases state held for the archive given to extractorLoad.
+// Extraction must have finished beforehand.
+void extractorUnload(struct Extractor *ex) {
+  if (ex->zip == NULL) {
+    return;
+  }
+
+  dirCacheDestroy(&ex->dirs);
+  progressDestroy(&ex->progress);
+  manifestDestroy(&ex->manifest);
+  free(ex->mtimes);
+  ex->mtimes = NULL;
+  ex->journal = NULL;
+  ex->zip = NULL;
+  ex->entryCount = 0;
+}
+
+// Releases all buffers held by the given extractor.
+void extractorDestroy(struct Extractor *ex) {
+  extractorUnload(ex);
+  extractLinkDestroy(&ex->compressed);
+  extractLinkDestroy(&ex->decompressed);
+
+  regionFree(ex->dict);
+  ex->dict = NULL;
+  regionFree(ex->hashBuffer);
+  ex->hashBuffer = NULL;
+
+  fatWriterDestroy(&ex->writer);
+  LWP_MutexDestroy(ex->lock);
+}
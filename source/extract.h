@@ -0,0 +1,142 @@
+#pragma once
+
+#include <gccore.h>
+
+#include "dir_cache.h"
+#include "fat_writer.h"
+#include "journal.h"
+#include "manifest.h"
+#include "miniz.h"
+#include "progress.h"
+#include "ring.h"
+
+// The size of every block passed between extraction stages.
+#define EXTRACT_BLOCK_SIZE (64 * 1024)
+
+// The most blocks in flight between two stages.
+// The actual amount is chosen by regionInit. See region.h.
+#define EXTRACT_RING_MAX_DEPTH 8
+
+// The size of our buffers holding a path on the SD card.
+#define EXTRACT_PATH_SIZE 1024
+
+// Flags describing the contents of an ExtractBlock.
+#define EXTRACT_BLOCK_FIRST (1 << 0)  // The block begins an entry.
+#define EXTRACT_BLOCK_LAST  (1 << 1)  // The block ends an entry.
+#define EXTRACT_BLOCK_END   (1 << 2)  // There are no further entries.
+
+// ExtractEntry describes the archive entry a block belongs to.
+// It is only valid on blocks flagged with EXTRACT_BLOCK_FIRST.
+struct ExtractEntry {
+  u32 index;
+  u16 method;
+  u32 crc32;
+  u64 compSize;
+  u64 uncompSize;
+  char path[EXTRACT_PATH_SIZE];
+};
+
+// ExtractBlock is a unit of work passed between two stages.
+struct ExtractBlock {
+  u8* data;
+  u32 length;
+  u32 flags;
+  struct ExtractEntry entry;
+};
+
+// ExtractLink connects two stages.
+// Filled blocks travel through "full" from the producing stage to the consuming stage,
+// and are handed back through "empty" once consumed.
+struct ExtractLink {
+  struct Ring full;
+  struct Ring empty;
+  struct ExtractBlock blocks[EXTRACT_RING_MAX_DEPTH];
+  u32 depth;
+};
+
+// Extractor extracts every entry of an archive to the SD card.
+// Its buffers and decompressor are allocated once, and reused for every archive loaded.
+//
+// Before any file is written, every directory needed by the archive is created once.
+// It is split into three stages, each running on its own thread:
+//  - the reader, reading compressed data from the archive,
+//  - the inflater, decompressing it and verifying its CRC-32,
+//  - the writer, writing the decompressed data to the SD card.
+// As the reader and writer spend most of their time waiting on IOS,
+// decompression is able to proceed while NAND and SD access take place.
+struct Extractor {
+  mz_zip_archive *zip;
+  u32 entryCount;
+
+  // Directories needed by the archive, created by the reader before any entry is read.
+  struct DirCache dirs;
+
+  struct ExtractLink compressed;
+  struct ExtractLink decompressed;
+
+  // State owned by the inflater.
+  tinfl_decompressor inflator;
+  u8* dict;
+
+  // State owned by the writer.
+  struct FatWriter writer;
+
+  // The manifest left by the previous install, if any, and where this install's manifest is saved.
+  // Files left unchanged since are not written again.
+  struct Manifest manifest;
+  char manifestPath[MANIFEST_PATH_SIZE];
+
+  // The modification time of every entry's file once present, indexed by entry.
+  time_t* mtimes;
+
+  // A buffer used by the reader to hash existing files.
+  u8* hashBuffer;
+
+  // The journal of this install, if any. Entries it records as finished are not extracted again.
+  // Entries are appended by the writer as they finish.
+  struct Journal* journal;
+
+  lwp_t readerThread;
+  lwp_t inflaterThread;
+  lwp_t writerThread;
+
+  // Guards failure state.
+  mutex_t lock;
+  volatile bool failed;
+
+  // Progress, updated by the writer as data reaches the SD card.
+  struct Progress progress;
+};
+
+// Prepares an extractor, allocating all of its buffers.
+// The same extractor may then be used for any amount of archives, one after another.
+// Returns false on failure, updating errorMessage/errorCode appropiately.
+bool extractorInit(struct Extractor *ex);
+
+// Prepares the extractor to extract the given archive.
+//
+// If a manifest path is given, files already holding the contents of their entry are skipped,
+// and a manifest of the files installed is saved there once extraction succeeds.
+// Files are known to be unchanged when they match the manifest present at that path, or
+// failing that, when they have the size and CRC-32 of their entry.
+//
+// If a journal is given, entries it records as finished are skipped as long as their file
+// is present with the expected size, and every entry extracted is added to it.
+//
+// Returns false on failure, updating errorMessage/errorCode appropiately.
+bool extractorLoad(struct Extractor *ex, mz_zip_archive *zip, const char *manifestPath, struct Journal *journal);
+
+// Starts extraction on background threads.
+// Returns false on failure, updating errorMessage/errorCode appropiately.
+bool extractorStart(struct Extractor *ex);
+
+// Waits for extraction to finish.
+// Returns false on failure, with errorMessage/errorCode updated by the failing stage.
+bool extractorWait(struct Extractor *ex);
+
+// Releases state held for the archive given to extractorLoad.
+// Extraction must have finished beforehand.
+void extractorUnload(struct Extractor *ex);
+
+// Releases all buffers held by the given extractor.
+void extractorDestroy(struct Extractor *ex);
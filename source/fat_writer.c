@@ -0,0 +1,162 @@
+#include <fcntl.h>
+#include <gccore.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+#include "fat_writer.h"
+#include "region.h"
+#include "trace.h"
+
+// Prepares a writer for the volume containing the given path, with a buffer of at least the given size.
+// Returns false if its buffer could not be allocated.
+bool fatWriterInit(struct FatWriter *writer, const char *volume, u32 size) {
+  memset(writer, 0, sizeof(struct FatWriter));
+  writer->fd = -1;
+
+  // libfat reports its cluster size as the block size of the volume.
+  struct statvfs stats;
+  if (statvfs(volume, &stats) == 0 && stats.f_bsize > 0) {
+    writer->clusterSize = stats.f_bsize;
+  } else {
+    writer->clusterSize = FAT_WRITER_DEFAULT_CLUSTER_SIZE;
+  }
+
+  // Our buffer holds a whole number of clusters.
+  u32 clusters = (size + writer->clusterSize - 1) / writer->clusterSize;
+  writer->capacity = clusters * writer->clusterSize;
+  writer->buffer = regionAlloc(REGION_MEM1, writer->capacity);
+  return writer->buffer != NULL;
+}
+
+// Writes the given data in its entirety.
+static bool fatWriterWriteRaw(struct FatWriter *writer, const u8 *data, u32 length) {
+  while (length > 0) {
+    TRACE_COUNT(TRACE_WRITE_CALLS, 1);
+    ssize_t written = write(writer->fd, data, length);
+    if (written <= 0) {
+      return false;
+    }
+
+    data += written;
+    length -= written;
+    TRACE_COUNT(TRACE_BYTES_WRITTEN, written);
+    TRACE_MARK(TRACE_FIRST_BYTE_MICROSECONDS);
+  }
+
+  return true;
+}
+
+// Opens the file at the given path for writing, creating it if necessary.
+// The given size is the final length of the file once written.
+// Returns false on failure.
+bool fatWriterOpen(struct FatWriter *writer, const char *path, u64 size) {
+  writer->used = 0;
+
+  // We intentionally do not truncate. Truncating frees a file's entire cluster chain,
+  // only for writing to allocate it again. Overwriting in place keeps the chain.
+  TRACE_COUNT(TRACE_FOPEN_CALLS, 1);
+  writer->fd = open(path, O_WRONLY | O_CREAT, 0666);
+  if (writer->fd < 0) {
+    return false;
+  }
+
+  struct stat stats;
+  if (fstat(writer->fd, &stats) < 0) {
+    fatWriterAbort(writer);
+    return false;
+  }
+
+  // Should the existing file be longer, we release its surplus clusters once, up front.
+  // Growing a file is left to our writes unless preallocating, as libfat fills any extension with zeroes.
+  if (stats.st_size > 0) {
+    TRACE_COUNT(TRACE_FILES_REUSED, 1);
+  }
+  if ((u64)stats.st_size > size && ftruncate(writer->fd, size) < 0) {
+    fatWriterAbort(writer);
+    return false;
+  }
+#if FAT_WRITER_PREALLOCATE
+  if ((u64)stats.st_size < size) {
+    if (ftruncate(writer->fd, size) < 0) {
+      fatWriterAbort(writer);
+      return false;
+    }
+    TRACE_COUNT(TRACE_BYTES_PREALLOCATED, size - stats.st_size);
+  }
+#endif
+
+  return true;
+}
+
+// Writes data to the currently open file.
+// Returns false on failure.
+bool fatWriterWrite(struct FatWriter *writer, const u8 *data, u32 length) {
+  while (length > 0) {
+    // When nothing is buffered, our position within the file lies on a cluster boundary.
+    // Whole clusters can then be written directly from the caller's data.
+    if (writer->used == 0 && length >= writer->clusterSize) {
+      u32 direct = length - (length % writer->clusterSize);
+      if (!fatWriterWriteRaw(writer, data, direct)) {
+        return false;
+      }
+
+      data += direct;
+      length -= direct;
+      continue;
+    }
+
+    u32 chunk = writer->capacity - writer->used;
+    if (chunk > length) {
+      chunk = length;
+    }
+
+    memcpy(writer->buffer + writer->used, data, chunk);
+    writer->used += chunk;
+    data += chunk;
+    length -= chunk;
+
+    if (writer->used == writer->capacity) {
+      if (!fatWriterWriteRaw(writer, writer->buffer, writer->used)) {
+        return false;
+      }
+      writer->used = 0;
+    }
+  }
+
+  return true;
+}
+
+// Flushes and closes the currently open file.
+// Returns false on failure.
+bool fatWriterClose(struct FatWriter *writer) {
+  bool success = true;
+  if (writer->used > 0) {
+    success = fatWriterWriteRaw(writer, writer->buffer, writer->used);
+    writer->used = 0;
+  }
+
+  if (close(writer->fd) < 0) {
+    success = false;
+  }
+  writer->fd = -1;
+  return success;
+}
+
+// Closes the currently open file, discarding any buffered data.
+void fatWriterAbort(struct FatWriter *writer) {
+  if (writer->fd >= 0) {
+    close(writer->fd);
+  }
+  writer->fd = -1;
+  writer->used = 0;
+}
+
+// Releases the buffer of the given writer.
+void fatWriterDestroy(struct FatWriter *writer) {
+  fatWriterAbort(writer);
+  regionFree(writer->buffer);
+  writer->buffer = NULL;
+}
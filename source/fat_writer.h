@@ -0,0 +1,57 @@
+#pragma once
+
+#include <gccore.h>
+
+// The cluster size assumed should the volume not report one.
+#define FAT_WRITER_DEFAULT_CLUSTER_SIZE (32 * 1024)
+
+// FatWriter writes files to a FAT volume in whole clusters.
+//
+// Writes made through stdio reach libfat in small pieces, causing partial sector
+// writes and repeated updates of the FAT. Instead, data is collected in a single
+// reusable buffer sized to a multiple of the volume's cluster size and written with
+// raw write() calls. Data already spanning whole clusters is written directly.
+//
+// Files being replaced are overwritten in place rather than truncated, so that their
+// existing cluster chain is reused instead of being freed and allocated again.
+//
+// Building with PREALLOCATE=1 grows each file to its final size before it is written, so that
+// its whole cluster chain is allocated at once. libfat fills the extension with zeroes, which
+// our writes then overwrite, so a new file is written twice. It is off by default.
+#ifndef FAT_WRITER_PREALLOCATE
+#define FAT_WRITER_PREALLOCATE 0
+#endif
+
+struct FatWriter {
+  int fd;
+  u32 clusterSize;
+
+  // A 32-byte aligned buffer, reused for every file.
+  u8* buffer;
+  u32 capacity;
+  u32 used;
+};
+
+// Prepares a writer for the volume containing the given path.
+// Its buffer holds at least the given amount of bytes, rounded up to a whole number of clusters.
+// Returns false if its buffer could not be allocated.
+bool fatWriterInit(struct FatWriter *writer, const char *volume, u32 size);
+
+// Opens the file at the given path for writing, creating it if necessary.
+// The given size is the final length of the file once written.
+// Returns false on failure.
+bool fatWriterOpen(struct FatWriter *writer, const char *path, u64 size);
+
+// Writes data to the currently open file.
+// Returns false on failure.
+bool fatWriterWrite(struct FatWriter *writer, const u8 *data, u32 length);
+
+// Flushes and closes the currently open file.
+// Returns false on failure.
+bool fatWriterClose(struct FatWriter *writer);
+
+// Closes the currently open file, discarding any buffered data.
+void fatWriterAbort(struct FatWriter *writer);
+
+// Releases the buffer of the given writer.
+void fatWriterDestroy(struct FatWriter *writer);
@@ -0,0 +1,184 @@
+#include <gccore.h>
+#include <grrlib.h>
+#include <string.h>
+
+#include "font.h"
+
+// The version of tools/bakefont.c's output we are able to read. See it for the format.
+#define FONT_VERSION 1
+
+// The sizes of the fixed parts of the format.
+#define FONT_HEADER_SIZE 16
+#define FONT_SIZE_SIZE 4
+#define FONT_GLYPH_SIZE 10
+#define FONT_KERNING_SIZE 4
+
+// Reads a big-endian u16. Our data is big-endian, as is the Wii, but may not be aligned.
+static u16 fontRead16(const u8 *data) {
+  return (data[0] << 8) | data[1];
+}
+
+// Loads a font baked by tools/bakefont.c.
+// Returns false if the data is invalid or its atlas could not be allocated.
+bool fontLoad(struct Font *font, const u8 *data, u32 length) {
+  memset(font, 0, sizeof(struct Font));
+  if (length < FONT_HEADER_SIZE || memcmp(data, "FONT", 4) != 0 || fontRead16(data + 4) != FONT_VERSION) {
+    return false;
+  }
+
+  u32 faceCount = fontRead16(data + 6);
+  u32 width = fontRead16(data + 8);
+  u32 height = fontRead16(data + 10);
+  font->firstChar = fontRead16(data + 12);
+  font->glyphCount = fontRead16(data + 14);
+  if (faceCount > FONT_MAX_SIZES || font->glyphCount > FONT_MAX_GLYPHS) {
+    return false;
+  }
+
+  // Every section is sized by the header, so validate the whole before reading any of it.
+  u32 offset = FONT_HEADER_SIZE + faceCount * FONT_SIZE_SIZE;
+  if (offset > length) {
+    return false;
+  }
+  u32 kerningTotal = 0;
+  u32 i;
+  for (i = 0; i < faceCount; i++) {
+    kerningTotal += fontRead16(data + FONT_HEADER_SIZE + i * FONT_SIZE_SIZE + 2);
+  }
+  u32 glyphsOffset = offset;
+  u32 kerningOffset = glyphsOffset + faceCount * font->glyphCount * FONT_GLYPH_SIZE;
+  u32 atlasOffset = (kerningOffset + kerningTotal * FONT_KERNING_SIZE + 31) & ~31;
+  if (atlasOffset > length || width * height * 4 > length - atlasOffset) {
+    return false;
+  }
+
+  for (i = 0; i < faceCount; i++) {
+    struct FontFace *face = &font->faces[i];
+    const u8 *size = data + FONT_HEADER_SIZE + i * FONT_SIZE_SIZE;
+    face->size = fontRead16(size);
+    u32 kerningCount = fontRead16(size + 2);
+
+    u32 g;
+    for (g = 0; g < font->glyphCount; g++) {
+      const u8 *record = data + glyphsOffset + (i * font->glyphCount + g) * FONT_GLYPH_SIZE;
+      struct FontGlyph *glyph = &face->glyphs[g];
+      glyph->x = fontRead16(record);
+      glyph->y = fontRead16(record + 2);
+      glyph->width = record[4];
+      glyph->height = record[5];
+      glyph->left = (s8)record[6];
+      glyph->top = (s8)record[7];
+      glyph->advance = record[8];
+    }
+
+    // Index kerning pairs by their left character, as they are ordered by it.
+    face->kerning = data + kerningOffset;
+    u32 pair = 0;
+    for (g = 0; g <= font->glyphCount; g++) {
+      while (pair < kerningCount && face->kerning[pair * FONT_KERNING_SIZE] < font->firstChar + g) {
+        pair++;
+      }
+      face->kerningStart[g] = pair;
+    }
+    kerningOffset += kerningCount * FONT_KERNING_SIZE;
+  }
+
+  // The atlas is already tiled, so it is merely copied in to an aligned texture.
+  font->atlas = GRRLIB_CreateEmptyTexture(width, height);
+  if (font->atlas == NULL) {
+    return false;
+  }
+  memcpy(font->atlas->data, data + atlasOffset, width * height * 4);
+  GRRLIB_FlushTex(font->atlas);
+
+  font->faceCount = faceCount;
+  return true;
+}
+
+// Returns the kerning between the given glyphs.
+static int fontKerning(const struct Font *font, const struct FontFace *face, u32 left, u32 right) {
+  u32 pair;
+  for (pair = face->kerningStart[left]; pair < face->kerningStart[left + 1]; pair++) {
+    const u8 *kerning = face->kerning + pair * FONT_KERNING_SIZE;
+    if (kerning[1] == font->firstChar + right) {
+      return (s8)kerning[2];
+    }
+  }
+  return 0;
+}
+
+// Lays out the given text, calling the given function for every glyph to be drawn.
+// Returns false if the given size was not baked.
+bool fontLayout(const struct Font *font, const char *text, u32 size, FontGlyphFunc func, void *arg) {
+  const struct FontFace *face = NULL;
+  u32 i;
+  for (i = 0; i < font->faceCount; i++) {
+    if (font->faces[i].size == size) {
+      face = &font->faces[i];
+    }
+  }
+  if (face == NULL) {
+    return false;
+  }
+
+  // As with GRRLIB_PrintfTTF, the baseline lies the size of the font below the top of the line.
+  int penX = 0;
+  int penY = size;
+  s32 previous = -1;
+  for (; *text != '\0'; text++) {
+    u32 index = (u8)*text - font->firstChar;
+    if ((u8)*text < font->firstChar || index >= font->glyphCount) {
+      continue;
+    }
+
+    if (previous >= 0) {
+      penX += fontKerning(font, face, previous, index);
+    }
+
+    const struct FontGlyph *glyph = &face->glyphs[index];
+    if (glyph->width > 0 && glyph->height > 0) {
+      func(font, glyph, penX + glyph->left, penY - glyph->top, arg);
+    }
+    penX += glyph->advance;
+    previous = index;
+  }
+
+  return true;
+}
+
+// Returns the coverage of the atlas at the given position, from 0 to 255.
+u8 fontCoverage(const struct Font *font, u32 x, u32 y) {
+  // The atlas is made of 4x4 tiles of 64 bytes, beginning with the alpha and red of each texel.
+  const u8 *data = font->atlas->data;
+  u32 tile = (y / 4) * (font->atlas->w / 4) + x / 4;
+  return data[tile * 64 + ((y % 4) * 4 + x % 4) * 2];
+}
+
+// Where fontPrint draws its text, and in which colour.
+struct FontPrint {
+  int x;
+  int y;
+  u32 color;
+};
+
+// Draws a single glyph for fontPrint.
+static void fontPrintGlyph(const struct Font *font, const struct FontGlyph *glyph, int x, int y, void *arg) {
+  const struct FontPrint *print = (const struct FontPrint *)arg;
+  GRRLIB_DrawPart(print->x + x, print->y + y, glyph->x, glyph->y, glyph->width, glyph->height, font->atlas, 0, 1, 1,
+                  print->color);
+}
+
+// Draws the given text with the top-left of its line at the given position, as GRRLIB_PrintfTTF does.
+void fontPrint(const struct Font *font, int x, int y, const char *text, u32 size, u32 color) {
+  struct FontPrint print = {x, y, color};
+  fontLayout(font, text, size, fontPrintGlyph, &print);
+}
+
+// Releases the atlas of the given font.
+void fontDestroy(struct Font *font) {
+  if (font->atlas != NULL) {
+    GRRLIB_FreeTexture(font->atlas);
+    font->atlas = NULL;
+  }
+  font->faceCount = 0;
+}
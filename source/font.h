@@ -0,0 +1,69 @@
+#pragma once
+
+#include <gccore.h>
+#include <grrlib.h>
+
+// The most sizes and glyphs a font may hold.
+#define FONT_MAX_SIZES 4
+#define FONT_MAX_GLYPHS 256
+
+// FontGlyph describes where a glyph lies within the atlas, and how it is positioned
+// relative to the pen. Its top is the distance from the baseline to its first row.
+struct FontGlyph {
+  u16 x;
+  u16 y;
+  u8 width;
+  u8 height;
+  s8 left;
+  s8 top;
+  u8 advance;
+};
+
+// FontFace holds the glyphs of a single size.
+struct FontFace {
+  u32 size;
+  struct FontGlyph glyphs[FONT_MAX_GLYPHS];
+
+  // Kerning pairs of four bytes each, ordered by their left character,
+  // and the first pair of each left character.
+  const u8 *kerning;
+  u16 kerningStart[FONT_MAX_GLYPHS + 1];
+};
+
+struct Font;
+
+// Called by fontLayout for every glyph to be drawn, with the position of its top-left
+// relative to the top-left of the line.
+typedef void (*FontGlyphFunc)(const struct Font *font, const struct FontGlyph *glyph, int x, int y, void *arg);
+
+// Font draws text from glyphs baked at build time by tools/bakefont.c.
+//
+// Rasterizing text through FreeType on every frame, as GRRLIB_PrintfTTF does, plots each pixel
+// of every glyph individually. Instead, every glyph is drawn as a single quad from an atlas,
+// laid out exactly as GRRLIB_PrintfTTF would have.
+struct Font {
+  GRRLIB_texImg *atlas;
+  u32 firstChar;
+  u32 glyphCount;
+
+  struct FontFace faces[FONT_MAX_SIZES];
+  u32 faceCount;
+};
+
+// Loads a font baked by tools/bakefont.c. The given data must remain valid, as kerning is read from it.
+// Returns false if the data is invalid or its atlas could not be allocated.
+bool fontLoad(struct Font *font, const u8 *data, u32 length);
+
+// Lays out the given text, calling the given function for every glyph to be drawn.
+// Returns false if the given size was not baked.
+bool fontLayout(const struct Font *font, const char *text, u32 size, FontGlyphFunc func, void *arg);
+
+// Returns the coverage of the atlas at the given position, from 0 to 255.
+u8 fontCoverage(const struct Font *font, u32 x, u32 y);
+
+// Draws the given text with the top-left of its line at the given position, as GRRLIB_PrintfTTF does.
+// Characters not baked in to the font, and sizes not baked, are not drawn.
+void fontPrint(const struct Font *font, int x, int y, const char *text, u32 size, u32 color);
+
+// Releases the atlas of the given font.
+void fontDestroy(struct Font *font);
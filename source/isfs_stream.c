@@ -0,0 +1,153 @@
+#include <errno.h>
+#include <gccore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "isfs_stream.h"
+#include "region.h"
+#include "trace.h"
+
+// Opens a file at the given path for streamed reading, through a window of the given size.
+// Returns false on failure, updating message/code appropiately.
+bool ISFS_OpenStream(struct ISFSStream *stream, const char *path, u32 windowSize, char *message, char *code) {
+  memset(stream, 0, sizeof(struct ISFSStream));
+  stream->fd = -1;
+  stream->errorMessage = message;
+  stream->errorCode = code;
+
+  // Attempt to open a handle to our file.
+  TRACE_COUNT(TRACE_ISFS_CALLS, 1);
+  s32 fd = ISFS_Open(path, ISFS_OPEN_READ);
+  if (fd < 0) {
+    sprintf(stream->errorMessage, "Could not open file (%d).", fd);
+    sprintf(stream->errorCode, "ISFS_OPEN_FAILED");
+    return false;
+  }
+
+  // Read its length so that miniz is able to locate the central directory.
+  static fstats stats ATTRIBUTE_ALIGN(32);
+  memset(&stats, 0, sizeof(fstats));
+
+  TRACE_COUNT(TRACE_ISFS_CALLS, 1);
+  s32 ret = ISFS_GetFileStats(fd, &stats);
+  if (ret < 0) {
+    sprintf(stream->errorMessage, "Could not retrieve file stats (%d).", ret);
+    sprintf(stream->errorCode, "ISFS_OPEN_FAILED");
+
+    ISFS_Close(fd);
+    return false;
+  }
+
+  // Our window is the only buffer we read in to.
+  // As with ISFS_GetFile, it must be aligned by 32. Data is read through it once, so it lives within MEM2.
+  u8* window = regionAlloc(REGION_MEM2, windowSize);
+  if (window == NULL) {
+    sprintf(stream->errorMessage, "Could not allocate buffer (%d).", errno);
+    sprintf(stream->errorCode, "MEM_ALLOC_FAILED");
+
+    ISFS_Close(fd);
+    return false;
+  }
+
+  stream->fd = fd;
+  stream->length = stats.file_length;
+  stream->window = window;
+  stream->windowSize = windowSize;
+  return true;
+}
+
+// Refills the window of the given stream, starting at the given offset.
+// Returns false on failure, updating the stream's errorMessage/errorCode appropiately.
+static bool ISFS_FillWindow(struct ISFSStream *stream, u32 offset) {
+  // Invalidate our window in case we fail partway.
+  stream->windowLength = 0;
+
+  if (stream->position != offset) {
+    TRACE_COUNT(TRACE_ISFS_CALLS, 1);
+    s32 ret = ISFS_Seek(stream->fd, offset, SEEK_SET);
+    if (ret < 0) {
+      sprintf(stream->errorMessage, "Could not seek file (%d).", ret);
+      sprintf(stream->errorCode, "ISFS_READ_FAILED");
+      return false;
+    }
+    stream->position = offset;
+  }
+
+  u32 length = stream->length - offset;
+  if (length > stream->windowSize) {
+    length = stream->windowSize;
+  }
+
+  TRACE_COUNT(TRACE_ISFS_CALLS, 1);
+  s32 ret = ISFS_Read(stream->fd, stream->window, length);
+  if (ret != (s32)length) {
+    if (ret >= 0) {
+      sprintf(stream->errorMessage, "Could not read file (read %d/%d bytes).", ret, length);
+    } else {
+      sprintf(stream->errorMessage, "Could not read file (%d).", ret);
+    }
+    sprintf(stream->errorCode, "ISFS_READ_FAILED");
+
+    // Our position is no longer known.
+    stream->position = (u32)-1;
+    return false;
+  }
+
+  TRACE_COUNT(TRACE_NAND_BYTES_READ, length);
+  stream->position = offset + length;
+  stream->windowOffset = offset;
+  stream->windowLength = length;
+  return true;
+}
+
+// Reads n bytes at the given offset into buf, returning the amount read.
+// This is used as miniz's m_pRead callback.
+size_t ISFS_ReadStream(void *opaque, mz_uint64 offset, void *buf, size_t n) {
+  struct ISFSStream *stream = (struct ISFSStream *)opaque;
+
+  // We cannot read past the end of our file.
+  if (offset >= stream->length) {
+    return 0;
+  }
+  if (n > stream->length - offset) {
+    n = stream->length - offset;
+  }
+
+  size_t copied = 0;
+  while (copied < n) {
+    u32 current = (u32)offset + copied;
+
+    // Refill our window if the requested data is not present.
+    if (current < stream->windowOffset || current >= stream->windowOffset + stream->windowLength) {
+      if (!ISFS_FillWindow(stream, current)) {
+        break;
+      }
+    }
+
+    size_t available = stream->windowOffset + stream->windowLength - current;
+    size_t chunk = n - copied;
+    if (chunk > available) {
+      chunk = available;
+    }
+
+    memcpy((u8 *)buf + copied, stream->window + (current - stream->windowOffset), chunk);
+    copied += chunk;
+  }
+
+  return copied;
+}
+
+// Closes the given stream and releases its window.
+void ISFS_CloseStream(struct ISFSStream *stream) {
+  if (stream->window != NULL) {
+    regionFree(stream->window);
+    stream->window = NULL;
+  }
+
+  if (stream->fd >= 0) {
+    TRACE_COUNT(TRACE_ISFS_CALLS, 1);
+    ISFS_Close(stream->fd);
+  }
+  stream->fd = -1;
+}
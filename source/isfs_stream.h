@@ -0,0 +1,50 @@
+#pragma once
+
+#include <gccore.h>
+
+#include "miniz.h"
+
+// ISFSStream wraps an open ISFS file so that its contents can be read
+// at arbitrary offsets without loading the whole file into memory.
+//
+// Reads are served from a single aligned window that is refilled
+// with ISFS_Seek/ISFS_Read as needed. Peak memory is therefore bounded by
+// the window size, not by the size of the file.
+struct ISFSStream {
+  s32 fd;
+  u32 length;
+
+  // The current position of our handle, so that sequential
+  // reads do not require an additional seek.
+  u32 position;
+
+  // The window cache, its offset within the file and the amount of valid data.
+  // ISFS requires 32-byte aligned buffers, so its size must be a multiple of 32.
+  u8* window;
+  u32 windowSize;
+  u32 windowOffset;
+  u32 windowLength;
+
+  // Where failures are described. These are errorMessage/errorCode, unless the stream
+  // is in use on a thread other than the one that shows errors.
+  char* errorMessage;
+  char* errorCode;
+};
+
+// ISFS_OpenStream opens a file at the given path for streamed reading,
+// through a window of the given size.
+// Failures of the stream are described in the given message and code, which may be
+// errorMessage/errorCode themselves.
+// Returns false on failure, updating message/code appropiately.
+bool ISFS_OpenStream(struct ISFSStream *stream, const char *path, u32 windowSize, char *message, char *code);
+
+// ISFS_ReadStream reads n bytes at the given offset into buf.
+// It returns the amount of bytes read, which is less than n on failure,
+// describing the failure where the stream's errorMessage/errorCode point.
+//
+// Its signature matches mz_file_read_func, allowing it to be used
+// as an mz_zip_archive's m_pRead with the stream as its m_pIO_opaque.
+size_t ISFS_ReadStream(void *opaque, mz_uint64 offset, void *buf, size_t n);
+
+// ISFS_CloseStream closes the given stream and releases its window.
+void ISFS_CloseStream(struct ISFSStream *stream);
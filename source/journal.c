@@ -0,0 +1,204 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <gccore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "journal.h"
+#include "main.h"
+#include "miniz.h"
+#include "trace.h"
+
+// The header at the start of every journal.
+struct JournalHeader {
+  u32 magic;
+  u32 version;
+  u64 titleId;
+  u32 centralDirCrc32;
+  u32 entryCount;
+};
+
+// Marks the given entry as finished within the bitmap of the given journal.
+static void journalMark(struct Journal *journal, u32 index) {
+  journal->done[index >> 3] |= 1 << (index & 7);
+}
+
+// The size of a batch of the given amount of entries, within the words of the buffer holding it.
+// A batch is its length, the records of its entries and the CRC-32 of both.
+#define JOURNAL_BATCH_WORDS(count) (1 + (count) * 2 + 1)
+
+// Reads every intact batch of an open journal, leaving its position at the end of the last.
+static void journalLoad(struct Journal *journal) {
+  u32 batch[JOURNAL_BATCH_WORDS(JOURNAL_BATCH_SIZE)];
+  off_t end = sizeof(struct JournalHeader);
+
+  while (read(journal->fd, batch, sizeof(u32)) == sizeof(u32)) {
+    u32 count = batch[0];
+    if (count == 0 || count > JOURNAL_BATCH_SIZE) {
+      break;
+    }
+
+    ssize_t length = (JOURNAL_BATCH_WORDS(count) - 1) * sizeof(u32);
+    if (read(journal->fd, batch + 1, length) != length) {
+      break;
+    }
+    u32 crcOffset = JOURNAL_BATCH_WORDS(count) - 1;
+    if (batch[crcOffset] != (u32)mz_crc32(MZ_CRC32_INIT, (const u8 *)batch, crcOffset * sizeof(u32))) {
+      break;
+    }
+
+    if (journal->mtimes == NULL) {
+      journal->mtimes = calloc(journal->entryCount, sizeof(u32));
+    }
+    const struct JournalRecord *records = (const struct JournalRecord *)(batch + 1);
+    u32 i;
+    for (i = 0; i < count; i++) {
+      if (records[i].index < journal->entryCount) {
+        journalMark(journal, records[i].index);
+        if (journal->mtimes != NULL) {
+          journal->mtimes[records[i].index] = records[i].mtime;
+        }
+        TRACE_COUNT(TRACE_ENTRIES_RESUMED, 1);
+      }
+    }
+    end += JOURNAL_BATCH_WORDS(count) * sizeof(u32);
+  }
+
+  // Anything following the last intact batch is overwritten by our own.
+  lseek(journal->fd, end, SEEK_SET);
+}
+
+// Opens the journal for the given archive, loading its finished entries if it belongs to it.
+// Returns false on failure, updating errorMessage/errorCode appropiately.
+bool journalOpen(struct Journal *journal, u64 titleId, u32 centralDirCrc32, u32 entryCount) {
+  memset(journal, 0, sizeof(struct Journal));
+  journal->fd = -1;
+  journal->titleId = titleId;
+  journal->centralDirCrc32 = centralDirCrc32;
+  journal->entryCount = entryCount;
+
+  journal->done = calloc(entryCount / 8 + 1, 1);
+  if (journal->done == NULL) {
+    sprintf(errorMessage, "Could not allocate buffer (%d).", errno);
+    sprintf(errorCode, "MEM_ALLOC_FAILED");
+    return false;
+  }
+
+  struct JournalHeader header;
+  TRACE_COUNT(TRACE_FOPEN_CALLS, 1);
+  int fd = open(JOURNAL_PATH, O_RDWR);
+  if (fd >= 0) {
+    bool matches = read(fd, &header, sizeof(header)) == sizeof(header) &&
+                   header.magic == JOURNAL_MAGIC && header.version == JOURNAL_VERSION &&
+                   header.titleId == titleId && header.centralDirCrc32 == centralDirCrc32 &&
+                   header.entryCount == entryCount;
+    if (matches) {
+      journal->fd = fd;
+      journalLoad(journal);
+      return true;
+    }
+    close(fd);
+  }
+
+  // There is no journal for this archive. Begin a new one.
+  TRACE_COUNT(TRACE_MKDIR_CALLS, 2);
+  TRACE_COUNT(TRACE_FOPEN_CALLS, 1);
+  mkdir("fat:/apps", 0777);
+  mkdir(OSC_DATA_PATH, 0777);
+  fd = open(JOURNAL_PATH, O_RDWR | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0) {
+    return true;
+  }
+
+  memset(&header, 0, sizeof(header));
+  header.magic = JOURNAL_MAGIC;
+  header.version = JOURNAL_VERSION;
+  header.titleId = titleId;
+  header.centralDirCrc32 = centralDirCrc32;
+  header.entryCount = entryCount;
+  if (write(fd, &header, sizeof(header)) != sizeof(header) || fsync(fd) != 0) {
+    close(fd);
+    unlink(JOURNAL_PATH);
+    return true;
+  }
+
+  journal->fd = fd;
+  return true;
+}
+
+// Returns whether the given entry was recorded as finished by a previous launch.
+bool journalIsDone(const struct Journal *journal, u32 index) {
+  return index < journal->entryCount && (journal->done[index >> 3] & (1 << (index & 7))) != 0;
+}
+
+// Returns the modification time recorded for the given entry, or 0 if none was.
+time_t journalGetMtime(const struct Journal *journal, u32 index) {
+  return journal->mtimes != NULL && index < journal->entryCount ? journal->mtimes[index] : 0;
+}
+
+// Records the given entry as finished, with the modification time of its file,
+// appending a batch once enough have finished.
+void journalAdd(struct Journal *journal, u32 index, time_t mtime) {
+  journal->pending[journal->pendingCount].index = index;
+  journal->pending[journal->pendingCount].mtime = (u32)mtime;
+  journal->pendingCount++;
+  if (journal->pendingCount == JOURNAL_BATCH_SIZE) {
+    journalFlush(journal);
+  }
+}
+
+// Appends any entries not yet appended.
+void journalFlush(struct Journal *journal) {
+  u32 count = journal->pendingCount;
+  journal->pendingCount = 0;
+  if (journal->fd < 0 || count == 0) {
+    return;
+  }
+
+  u32 batch[JOURNAL_BATCH_WORDS(JOURNAL_BATCH_SIZE)];
+  u32 crcOffset = JOURNAL_BATCH_WORDS(count) - 1;
+  batch[0] = count;
+  memcpy(batch + 1, journal->pending, count * sizeof(struct JournalRecord));
+  batch[crcOffset] = (u32)mz_crc32(MZ_CRC32_INIT, (const u8 *)batch, crcOffset * sizeof(u32));
+
+  // Syncing any file flushes libfat's entire cache, which includes the data of the entries
+  // we are about to record. Only then may they be recorded as finished.
+  ssize_t length = JOURNAL_BATCH_WORDS(count) * sizeof(u32);
+  if (fsync(journal->fd) != 0 || write(journal->fd, batch, length) != length || fsync(journal->fd) != 0) {
+    // Later batches would follow a torn one, and be ignored regardless.
+    close(journal->fd);
+    journal->fd = -1;
+  }
+}
+
+// Flushes and closes the journal, leaving it in place for a later launch to resume.
+void journalClose(struct Journal *journal) {
+  journalFlush(journal);
+  if (journal->fd >= 0) {
+    close(journal->fd);
+    journal->fd = -1;
+  }
+
+  free(journal->done);
+  journal->done = NULL;
+  free(journal->mtimes);
+  journal->mtimes = NULL;
+}
+
+// Closes and removes the journal, as its install has completed.
+void journalRemove(struct Journal *journal) {
+  journal->pendingCount = 0;
+  if (journal->fd >= 0) {
+    close(journal->fd);
+    journal->fd = -1;
+  }
+  unlink(JOURNAL_PATH);
+
+  free(journal->done);
+  journal->done = NULL;
+  free(journal->mtimes);
+  journal->mtimes = NULL;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <gccore.h>
+#include <time.h>
+
+// The journal of the install in progress, if any.
+#define JOURNAL_PATH OSC_DATA_PATH "/journal.bin"
+
+// Identifies a journal, followed by the version of its layout.
+#define JOURNAL_MAGIC 0x4F53434A
+#define JOURNAL_VERSION 2
+
+// The amount of finished entries collected before they are appended to the journal.
+#define JOURNAL_BATCH_SIZE 32
+
+// A finished entry, along with the modification time of its file once written.
+struct JournalRecord {
+  u32 index;
+  u32 mtime;
+};
+
+// Journal records the entries of an archive already extracted, so that an install
+// interrupted by a power loss, the HOME button or a failure is able to resume where it stopped.
+//
+// It begins with a header identifying the archive by its title ID and the CRC-32 of its
+// central directory. Finished entries follow in checksummed batches, each appended only
+// once the data of its entries has been flushed to the card. A batch torn by a power loss
+// fails its checksum, and it and anything after it are ignored. Entries within an intact
+// batch are therefore trusted to be on the card as they were written, without checking.
+struct Journal {
+  int fd;
+  u64 titleId;
+  u32 centralDirCrc32;
+  u32 entryCount;
+
+  // A bitmap of entries recorded as finished.
+  u8* done;
+
+  // The modification time recorded for each entry, only allocated once a batch is loaded.
+  u32* mtimes;
+
+  // Finished entries not yet appended.
+  struct JournalRecord pending[JOURNAL_BATCH_SIZE];
+  u32 pendingCount;
+};
+
+// Opens the journal for the given archive.
+// Should the journal on the card belong to the same archive, its finished entries are loaded.
+// Otherwise, it is replaced with an empty journal.
+// Should the journal not be writable, the install proceeds without one, as it would merely be
+// unable to resume. Returns false on failure, updating errorMessage/errorCode appropiately.
+bool journalOpen(struct Journal *journal, u64 titleId, u32 centralDirCrc32, u32 entryCount);
+
+// Returns whether the given entry was recorded as finished by a previous launch.
+bool journalIsDone(const struct Journal *journal, u32 index);
+
+// Returns the modification time recorded for the given entry, or 0 if none was.
+time_t journalGetMtime(const struct Journal *journal, u32 index);
+
+// Records the given entry as finished, with the modification time of its file,
+// appending a batch once enough have finished.
+void journalAdd(struct Journal *journal, u32 index, time_t mtime);
+
+// Appends any entries not yet appended.
+void journalFlush(struct Journal *journal);
+
+// Flushes and closes the journal, leaving it in place for a later launch to resume.
+void journalClose(struct Journal *journal);
+
+// Closes and removes the journal, as its install has completed.
+void journalRemove(struct Journal *journal);
@@ -28,15 +28,27 @@
 
 // Custom headers
 #include "ec_cfg.h"
+#include "extract.h"
+#include "font.h"
+#include "journal.h"
 #include "main.h"
+#include "manifest.h"
 #include "miniz.h"
+#include "package.h"
+#include "progress.h"
+#include "region.h"
+#include "storage.h"
+#include "text_cache.h"
+#include "texture.h"
+#include "trace.h"
 #include "utils.h"
 
 // Fonts and images
-#include "LiberationSans-Regular_ttf.h"
-#include "osc_png.h"
-GRRLIB_ttfFont *libSans;
-GRRLIB_texImg *osclogo;
+#include "LiberationSans-Regular_font.h"
+#include "osc_tex.h"
+struct Font libSans;
+struct TextCache textCache;
+GRRLIB_texImg osclogo;
 
 /*
  *
@@ -44,10 +56,6 @@ GRRLIB_texImg *osclogo;
  *
  */
 
-// For the IO
-const DISC_INTERFACE *sd_slot = &__io_wiisd;
-const DISC_INTERFACE *usb = &__io_usbstorage;
-
 // See main.h for an explanation of their purpose.
 char * errorMessage;
 char * errorCode;
@@ -61,33 +69,61 @@ u8 EMPTY_SHA1_HASH[20] = {0xda, 0x39, 0xa3, 0xee, 0x5e, 0x6b, 0x4b, 0x0d, 0x32,
  *
  */
 
-// getTitleId()
+// getTitleQueue(titleIds, maxTitles)
 //
-// This function extracts a URL from the loaded ec.cfg.
+// This function extracts the title IDs to install from the loaded ec.cfg.
 //
 // The shop channel web interface is able to invoke a JS function,
 // ec.setPersistentValue(name, value), which writes a given key/value pair to the that file.
 // This function is part of the ECommerceInterface JS interface.
-// The frontend is expected to set the key "titleId" to a valid URL.
 //
-// If the key is not present, or another error occurs, this function will return NULL.
-// Otherwise, it returns the given value for the key "titleId".
-u64 getTitleId() {
-	char* result = ecGetKeyValue("titleId");
+// The frontend may set the key "titleIds" to a comma-separated list of title IDs,
+// allowing several titles to be installed within a single launch. Otherwise, it is
+// expected to set the key "titleId" to a single title ID.
+//
+// Up to maxTitles title IDs are written to titleIds, in the order given.
+// If no key is present, or another error occurs, this function will return 0.
+// Otherwise, it returns the amount of title IDs read.
+u32 getTitleQueue(u64 * titleIds, u32 maxTitles) {
+	char* result = ecGetKeyValue("titleIds");
+	if (result == NULL) {
+		result = ecGetKeyValue("titleId");
+	}
 	if (result == NULL) {
 		sprintf(errorMessage, "No title ID present to download.");
 		sprintf(errorCode, "NO_URL_IN_BIN");
 		return 0;
 	}
 
-	u64 titleId = strtoull(result, NULL, 16);
-	if (titleId == 0) {
+	u32 count = 0;
+	char* position = result;
+	while (*position != '\0') {
+		if (count == maxTitles) {
+			sprintf(errorMessage, "Too many titles queued (at most %d).", maxTitles);
+			sprintf(errorCode, "INVALID_TITLE_ID");
+			return 0;
+		}
+
+		char* end = NULL;
+		u64 titleId = strtoull(position, &end, 16);
+		while (*end == ' ') {
+			end++;
+		}
+		if (titleId == 0 || (*end != ',' && *end != '\0')) {
+			sprintf(errorMessage, "Invalid title ID.");
+			sprintf(errorCode, "INVALID_TITLE_ID");
+			return 0;
+		}
+		titleIds[count++] = titleId;
+
+		position = *end == ',' ? end + 1 : end;
+	}
+
+	if (count == 0) {
 		sprintf(errorMessage, "Invalid title ID.");
 		sprintf(errorCode, "INVALID_TITLE_ID");
-		return 0;
-	} else {
-		return titleId;
 	}
+	return count;
 }
 
 /*
@@ -114,9 +150,9 @@ void renderMainScreen(char * title, char * boxcaption) {
 	GRRLIB_Rectangle(41, 37, 559, 41, 0xF3F3F3FF, true);
 	GRRLIB_Rectangle(123, 247, 394, 68, 0x34ED90FF, true);
 	GRRLIB_Rectangle(132, 272, 377, 34, 0xE3FFF1FF, true);
-	GRRLIB_PrintfTTF(53, 44, libSans, title, 20, 0x707070FF);
-	GRRLIB_PrintfTTF(131, 252, libSans, boxcaption, 13, 0xFFFFFFFF);
-	GRRLIB_DrawImg(237, 169, osclogo, 0, 0.741, 0.725, 0xFFFFFFFF);
+	textCacheDraw(&textCache, 53, 44, title, 20, 0x707070FF);
+	textCacheDraw(&textCache, 131, 252, boxcaption, 13, 0xFFFFFFFF);
+	GRRLIB_DrawImg(237, 169, &osclogo, 0, 0.741, 0.725, 0xFFFFFFFF);
 }
 
 // errorMessageLoop(title)
@@ -125,6 +161,9 @@ void renderMainScreen(char * title, char * boxcaption) {
 // stack as a template, then "traps" the program in a while loop until the user
 // presses HOME to exit.
 //
+// The trace of the failed install is saved beforehand, as it is the most useful.
+// Storage is unmounted before exiting, so that nothing written is lost.
+//
 // Please refer to screenshots of the program for an example of what an error
 // message looks like. If you would like to trigger one yourself, a reliable method
 // is to disable your console's internet connection between pressing "download"
@@ -132,15 +171,18 @@ void renderMainScreen(char * title, char * boxcaption) {
 // errorMessageLoop and compile yourself.
 
 void errorMessageLoop(char * title) {
+	TRACE_SAVE(TRACE_PATH);
+
 	char * returnUrl = memalign(32, 512);
 	sprintf(returnUrl, "/error?error=%s", errorCode);
 	while (1) {
 		renderMainScreen(title, "Press HOME to exit.");
-		GRRLIB_PrintfTTF(138, 281, libSans, errorMessage, 13, 0x000000FF);
+		textCacheDraw(&textCache, 138, 281, errorMessage, 13, 0x000000FF);
 		GRRLIB_Render();
 		WPAD_ScanPads();
 		u32 pressed = WPAD_ButtonsDown(0);
 		if ( pressed & WPAD_BUTTON_HOME ) {
+			storageUnmount();
 			GRRLIB_Exit();
 			WII_Initialize();
 			WII_LaunchTitleWithArgs(0x0001000248414241LL, 0,returnUrl, NULL);
@@ -149,6 +191,39 @@ void errorMessageLoop(char * title) {
 	}
 }
 
+// renderProgressLoop(title, progress)
+//
+// This function will render the progress of work taking place on another
+// thread until it has finished, using the renderMainScreen() render stack
+// as a template with the current caption of the given progress.
+//
+// The progress bar is weighted by bytes rather than by entries, so that many
+// small files do not make it race ahead of a single large one.
+//
+// GRRLib_Render() waits for the next frame, so we redraw at most once per
+// frame. When progress has not changed since the last frame, we skip
+// rendering altogether and leave the CPU to the thread doing the work.
+
+void renderProgressLoop(char * title, struct Progress * progress) {
+	static struct ProgressSnapshot snapshot;
+	u32 lastSequence = 0;
+	bool rendered = false;
+
+	do {
+		progressGetSnapshot(progress, &snapshot);
+		if (rendered && snapshot.sequence == lastSequence) {
+			VIDEO_WaitVSync();
+			continue;
+		}
+		lastSequence = snapshot.sequence;
+		rendered = true;
+
+		renderMainScreen(title, snapshot.caption);
+		GRRLIB_Rectangle(132, 272, progressFraction(&snapshot) * 377.0f, 34, 0x35BEECFF, true);
+		GRRLIB_Render();
+	} while (!snapshot.finished);
+}
+
 // fadeIn()
 //
 // This function will render a "dummy" status screen while the program "fades in"
@@ -157,13 +232,16 @@ void errorMessageLoop(char * title) {
 // To increase the speed of the effect, increase the speed integer.
 
 void fadeIn() {
+	TRACE_SCOPE("fadeIn");
 	int opacity = 0;
 	int speed = 8; 
 	for (opacity = 0; opacity <= 255; opacity = opacity + speed) {
 		renderMainScreen("Extract", "Extracting");
 		GRRLIB_Rectangle(0, 0, 640, 480, RGBA(0,0,0,0xFF - opacity), true);
 		GRRLIB_Render();
+		TRACE_MARK(TRACE_FIRST_FRAME_MICROSECONDS);
 	}
+	TRACE_MARK(TRACE_FADE_IN_MICROSECONDS);
 }
 
 // fadeOut()
@@ -174,6 +252,7 @@ void fadeIn() {
 // To increase the speed of the effect, increase the speed integer.
 
 void fadeOut() {
+	TRACE_SCOPE("fadeOut");
 	int opacity = 0;
 	int speed = 8; 
 	for (opacity = 0; opacity <= 255; opacity = opacity + speed) {
@@ -192,38 +271,19 @@ void fadeOut() {
 
 // initSystems()
 //
-// This function attempts to initialize the socket (network), FAT (SD card), and
-// ISFS (NAND) subsystems. It then loads ec.cfg for later usage.
+// This function attempts to initialize the ISFS (NAND) subsystem and load ec.cfg,
+// then starts and mounts FAT (SD card or USB).
+//
+// ec.cfg is loaded first, as it may specify which device to install to and how
+// its FAT cache should be tuned.
+// See storage.h for further details.
 //
 // Upon failure, this function will return -1.
 
 s32 initSystems() {
-        // Initialize IO
-        usb->startup();
-        sd_slot->startup();
-
-        // Check if the SD Card is inserted
-        bool isInserted = __io_wiisd.isInserted();
-
-        // Try to mount the SD Card before the USB
-        if (isInserted) {
-                fatMountSimple("fat", sd_slot);
-        } else {
-                // Since the SD Card is not inserted, we will attempt to mount the USB.
-                bool USB = __io_usbstorage.isInserted();
-                if (USB) {
-                        fatMountSimple("fat", usb);
-                } else {
-                        // No input devices were inserted OR it failed to mount either
-                        // device.
-                        sprintf(errorMessage, "Please insert either an SD Card or USB.");
-                        sprintf(errorCode, "FAT_INIT_FAILED");
-                        __io_usbstorage.shutdown();
-                        __io_wiisd.shutdown();
-                        return -1;
-                }
-        }
+	TRACE_SCOPE("initSystems");
 
+	TRACE_COUNT(TRACE_ISFS_CALLS, 1);
 	s32 ISFSInitResult = ISFS_Initialize();
 	if (ISFSInitResult < 0) {
 		sprintf(errorMessage, "Could not access NAND (%d).", ISFSInitResult);
@@ -237,6 +297,12 @@ s32 initSystems() {
 		return -1;
 	}
 
+	// Start and mount the device we install to
+	if (!storageInit()) {
+		// An error message and code is already set upon failure.
+		return -1;
+	}
+
 	return 0;
 }
 
@@ -252,6 +318,8 @@ char* getTitleContentPath(u64 titleId, u32 contentId) {
 // nullifyTitle edits a TMD to have its zeroth index an empty hash.
 // It then writes an empty file to NAND for its zeroth content.
 bool nullifyTitle(u64 titleId) {
+	TRACE_SCOPE("nullifyTitle");
+
 	// /title/%08x/%08x/content/title.tmd, plus a null terminator.
 	char tmdPath[43] = "";
 
@@ -297,6 +365,159 @@ bool nullifyTitle(u64 titleId) {
 	return true;
 }
 
+// extractPackage(extractor, package, title)
+//
+// This function extracts the given package to the SD card, rendering its progress
+// under the given title. Upon failure, an error message is shown.
+//
+// Files left unchanged since the title was last installed are skipped, as described
+// by its manifest. Should a previous launch have been interrupted while extracting
+// the same package, extraction resumes from where it stopped, as described by the journal.
+
+void extractPackage(struct Extractor * extractor, struct Package * package, char * title) {
+	TRACE_SCOPE("extractPackage");
+
+	static struct Journal journal;
+	u32 entryCount = mz_zip_reader_get_num_files(&package->zip);
+	if (!journalOpen(&journal, package->titleId, package->centralDirCrc32, entryCount)) {
+		// An error message is set via journalOpen.
+		errorMessageLoop("Extract failed");
+	}
+
+	char manifestPath[MANIFEST_PATH_SIZE];
+	manifestGetPath(manifestPath, package->titleId);
+	if (!extractorLoad(extractor, &package->zip, manifestPath, &journal) || !extractorStart(extractor)) {
+		// An error message is set via extractorLoad or extractorStart.
+		journalClose(&journal);
+		errorMessageLoop("Extract failed");
+	}
+
+	// Extraction takes place on background threads.
+	// We render its progress while waiting for it to finish.
+	renderProgressLoop(title, &extractor->progress);
+
+	if (!extractorWait(extractor)) {
+		// An error message is set by the failing extraction stage.
+		// The journal is kept, so that the next launch is able to resume.
+		journalClose(&journal);
+		errorMessageLoop("Extract failed");
+	}
+	extractorUnload(extractor);
+	journalRemove(&journal);
+}
+
+// The state of startup, taking place on a background thread while fadeIn() plays.
+// It is only accessed by the main thread once the startup thread has finished.
+#define STARTUP_STACK_SIZE (32 * 1024)
+#define STARTUP_PRIORITY 80
+
+static struct {
+	lwp_t thread;
+
+	// The title of the error to show should startup fail, with errorMessage
+	// and errorCode describing it. NULL upon success.
+	char * failure;
+
+	u64 titleIds[TITLE_QUEUE_SIZE];
+	u32 titleCount;
+	struct Extractor * extractor;
+	struct Package * package;
+} startup;
+
+// startupThread(arg)
+//
+// This function brings up NAND and storage via initSystems(), reads the queue
+// of titles to install, prepares the extractor and opens the first package.
+//
+// None of this draws anything, so it takes place while fadeIn() plays rather
+// than keeping the screen black. By the time the fade has finished, extraction
+// is ready to begin.
+
+void * startupThread(void * arg) {
+	TRACE_THREAD("startup");
+	TRACE_SCOPE("startupThread");
+
+	if (initSystems() < 0) {
+		startup.failure = "Initialization failed";
+		return NULL;
+	}
+
+	// Get title IDs of hidden SD titles from ec.cfg
+	startup.titleCount = getTitleQueue(startup.titleIds, TITLE_QUEUE_SIZE);
+	if (startup.titleCount == 0) {
+		// An error message is set via getTitleQueue.
+		startup.failure = "Reading title failed";
+		return NULL;
+	}
+
+	if (!extractorInit(startup.extractor)) {
+		// An error message is set via extractorInit.
+		startup.failure = "Extract failed";
+		return NULL;
+	}
+
+	// Our NAND content is both index and ID 0.
+	char* path = getTitleContentPath(startup.titleIds[0], 0);
+	bool opened = packageOpen(startup.package, startup.titleIds[0], path);
+	free(path);
+	if (!opened) {
+		// An error message is set via packageOpen.
+		startup.failure = "Reading title failed";
+		return NULL;
+	}
+
+	TRACE_MARK(TRACE_STARTUP_MICROSECONDS);
+	return NULL;
+}
+
+// The state of teardown, taking place on a background thread while fadeOut() plays.
+// It is only accessed by the main thread once the teardown thread has finished.
+#define TEARDOWN_STACK_SIZE (32 * 1024)
+#define TEARDOWN_PRIORITY 80
+
+static struct {
+	lwp_t thread;
+
+	// The title of the error to show should teardown fail, with errorMessage
+	// and errorCode describing it. NULL upon success.
+	char * failure;
+
+	// The last title installed, left for teardown to nullify. Zero if there is none.
+	u64 titleId;
+} teardown;
+
+// teardownThread(arg)
+//
+// This function nullifies the last title installed, saves the trace of the
+// launch and then flushes and unmounts storage via storageUnmount().
+//
+// Like startupThread(), none of this draws anything, so it takes place while
+// fadeOut() plays. We only relaunch once both have finished.
+//
+// The trace is saved before unmounting, so it holds every step of teardown
+// but the unmount itself. Should nullifying fail, storage is left mounted
+// for errorMessageLoop() to save the trace of the failure.
+
+void * teardownThread(void * arg) {
+	TRACE_THREAD("teardown");
+	TRACE_BEGIN(teardownScope, "teardownThread");
+
+	// Nullify the contents of our hidden SD title.
+	// We do so in order to not clog up the user's available NAND space.
+	if (teardown.titleId != 0 && !nullifyTitle(teardown.titleId)) {
+		// An error message is set via ISFS_GetFile.
+		teardown.failure = "Cleanup failed";
+		TRACE_END(teardownScope);
+		return NULL;
+	}
+	TRACE_END(teardownScope);
+
+	// The trace of the whole launch.
+	TRACE_SAVE(TRACE_PATH);
+	storageUnmount();
+	return NULL;
+}
+
 /*
  *
  *	Main function
@@ -304,6 +525,14 @@ bool nullifyTitle(u64 titleId) {
  */
 
 int main(int argc, char **argv) {
+	// Reserve memory within MEM1 and MEM2 before anything else is allocated.
+	// See region.h for what is placed where.
+	regionInit();
+
+	// Timing is traced from here on. See trace.h for details.
+	TRACE_INIT();
+	TRACE_THREAD("main");
+
 	// The odd-looking order of the following code, up until VIDEO_SetBlack(false),
 	// is necessary to prevent graphical irregularities from appearing while
 	// the program starts.
@@ -316,8 +545,13 @@ int main(int argc, char **argv) {
         WPAD_Init();
 
 	// Load font and logo
-	libSans = GRRLIB_LoadTTF(LiberationSans_Regular_ttf, LiberationSans_Regular_ttf_size);
-	osclogo = GRRLIB_LoadTexturePNG(osc_png);
+	// Our font is baked at build time. See font.h.
+	// Text remaining on screen is drawn from textures kept by textCache.
+	fontLoad(&libSans, LiberationSans_Regular_font, LiberationSans_Regular_font_size);
+	textCacheInit(&textCache, &libSans);
+
+	// Our logo is converted to a texture at build time. See texture.h.
+	textureLoad(&osclogo, osc_tex, osc_tex_size);
 
 	// Setup errorMessage and errorCode buffers
 	errorMessage = memalign(32,16384);
@@ -325,8 +559,28 @@ int main(int argc, char **argv) {
 	errorCode = memalign(32,255);
 	bzero(errorCode, 255);
 
-	// Attempt to initialize systems
-	s32 initRes = initSystems();
+	// Extraction takes place on background threads.
+	// Its buffers are allocated once and reused for every title.
+	static struct Extractor extractor;
+
+	// Read NAND contents
+	// Our NAND content is both index and ID 0.
+	// We read at index 0.
+	//
+	// Each package is streamed from NAND through a small window rather than
+	// read in its entirety, as it may not fit within memory.
+	// While one package is being extracted, the next is opened in the background
+	// so that its extraction is able to begin immediately.
+	static struct Package packages[2];
+
+	// Initialize systems and open the first package while we fade in.
+	// Should a thread not be available, we do so before fading in instead.
+	startup.extractor = &extractor;
+	startup.package = &packages[0];
+	if (LWP_CreateThread(&startup.thread, startupThread, NULL, NULL, STARTUP_STACK_SIZE, STARTUP_PRIORITY) < 0) {
+		startup.thread = LWP_THREAD_NULL;
+		startupThread(NULL);
+	}
 
 	// Enable video output
 	VIDEO_SetBlack(false);
@@ -335,93 +589,95 @@ int main(int argc, char **argv) {
 	fadeIn();
 
 	// Throw error if any system failed to initialize
-	if (initRes < 0) {
-		errorMessageLoop("Initialization failed");
+	if (startup.thread != LWP_THREAD_NULL) {
+		TRACE_BEGIN(startupWait, "startupWait");
+		LWP_JoinThread(startup.thread, NULL);
+		TRACE_END(startupWait);
 	}
-
-	// Get title ID of hidden SD title from ec.cfg
-	u64 titleId = getTitleId();
-	if (titleId == 0) {
-		// An error message is set via getTitleId.
-		errorMessageLoop("Reading title failed");
+	if (startup.failure != NULL) {
+		errorMessageLoop(startup.failure);
 	}
 
+	u64 * titleIds = startup.titleIds;
+	u32 titleCount = startup.titleCount;
+	u32 i;
+	for (i = 0; i < titleCount; i++) {
+		TRACE_SCOPE("install");
+		struct Package *package = &packages[i % 2];
+		struct Package *next = &packages[(i + 1) % 2];
+
+		// The first package was opened during startup.
+		if (i > 0 && !packageWait(package)) {
+			// An error message is set via packageWait.
+			errorMessageLoop("Reading title failed");
+		}
 
-	// Read NAND contents
-	// Our NAND content is both index and ID 0.
-	// We read at index 0.
-	char* path = getTitleContentPath(titleId, 0);
-	u32 zip_length = 0;
-  void* zip_data = ISFS_GetFile(path, &zip_length);
-	if (zip_data == NULL) {
-		// An error message is set via ISFS_GetFile.
-		errorMessageLoop("Reading title failed");
-	}
+		// Should a thread not be available, the next package is opened by packageWait instead.
+		if (i + 1 < titleCount) {
+			char* path = getTitleContentPath(titleIds[i + 1], 0);
+			packagePrefetch(next, titleIds[i + 1], path);
+			free(path);
+		}
 
-	// Unzip our hidden SD title.
-	// See the following URL for details & examples on how to use miniz:
-	// https://github.com/richgel999/miniz
-	mz_zip_archive zip_archive;
-	memset(&zip_archive, 0, sizeof(zip_archive));
-	mz_bool success = mz_zip_reader_init_mem(&zip_archive, zip_data, zip_length, 0);
-	if (!success) {
-		sprintf(errorMessage, "Could not initialize zip extraction.");
-		sprintf(errorCode, "ZIP_OPEN_FAILED");
-		errorMessageLoop("Extract failed");
-	}
+		// A launch interrupted partway through its queue leaves the titles it installed
+		// nullified, as recorded by their TMD. They have nothing left to install.
+		// An empty content the TMD expects to hold an archive fails to open instead. See package.h.
+		if (package->nullified) {
+			packageClose(package);
+			continue;
+		}
 
-	int i;
-	int imax = mz_zip_reader_get_num_files(&zip_archive);
-	char * fullpath = memalign(32,1024);
-	for (i = 0; i < imax; i++) {
-		bzero(fullpath, 1024);
-		mz_zip_archive_file_stat file_stat;
-		mz_zip_reader_file_stat(&zip_archive, i, &file_stat);
-		sprintf(fullpath, "fat:/%s", file_stat.m_filename);
-		if (mz_zip_reader_is_file_a_directory(&zip_archive, i)) {
-			if (fullpath[strlen(fullpath)-1] == '/') {
-				fullpath[strlen(fullpath)-1] = 0x00;
-			}
-			if (mkdir(fullpath, 0777) < 0 && errno != EEXIST) {
-				sprintf(errorMessage, "Could not create directory on SD card.");
-				sprintf(errorCode, "ZIP_EXTRACT_FAILED");
-				errorMessageLoop("Extract failed");
-			}
-		} else {
-			if (mz_zip_reader_extract_to_file(&zip_archive, i, fullpath, 0) < 0) {
-				sprintf(errorMessage, "Could extract file to SD card.");
-				sprintf(errorCode, "ZIP_EXTRACT_FAILED");
-				errorMessageLoop(fullpath);
-			}
+		// Unzip our hidden SD title.
+		char title[32] = "Install";
+		if (titleCount > 1) {
+			sprintf(title, "Install (%d/%d)", i + 1, titleCount);
 		}
+		extractPackage(&extractor, package, title);
+		packageClose(package);
 
-		// Render progress bar as unzipping proceeds
-		renderMainScreen("Install", fullpath);
-		GRRLIB_Rectangle(132, 272, ((float)(i+1)/(float)imax) * 377.0f, 34, 0x35BEECFF, true);
+		// The last title is nullified while we fade out. See teardownThread().
+		if (i + 1 == titleCount) {
+			teardown.titleId = titleIds[i];
+			break;
+		}
+
+		// Nullify the contents of our hidden SD title.
+		// We do so in order to not clog up the user's available NAND space.
+		renderMainScreen("Cleanup", "Cleaning up");
 		GRRLIB_Render();
+		if (!nullifyTitle(titleIds[i])) {
+			// An error message is set via ISFS_GetFile.
+			errorMessageLoop("Cleanup failed");
+		}
+
+		// The trace is rewritten after each install, so that a launch interrupted
+		// partway through its queue still leaves one.
+		TRACE_SAVE(TRACE_PATH);
 	}
-	mz_zip_reader_end(&zip_archive);
+	extractorDestroy(&extractor);
 
-	// Nullify the contents of our hidden SD title.
-	// We do so in order to not clog up the user's available NAND space.
-	renderMainScreen("Cleanup", "Cleaning up");
-	GRRLIB_Render();
-	success = nullifyTitle(titleId);
-	if (!success) {
-		// An error message is set via ISFS_GetFile.
-		errorMessageLoop("Cleanup failed");
+	// Nullify the last title, then flush & unmount fat while we fade out.
+	// Should a thread not be available, we do so before fading out instead.
+	if (LWP_CreateThread(&teardown.thread, teardownThread, NULL, NULL, TEARDOWN_STACK_SIZE, TEARDOWN_PRIORITY) < 0) {
+		teardown.thread = LWP_THREAD_NULL;
+		teardownThread(NULL);
 	}
 
-	// Fade out & exit to shop channel with "SUCCESS" error code
+	// Fade out
 	fadeOut();
+
+	// Throw error if cleanup failed
+	if (teardown.thread != LWP_THREAD_NULL) {
+		LWP_JoinThread(teardown.thread, NULL);
+	}
+	if (teardown.failure != NULL) {
+		errorMessageLoop(teardown.failure);
+	}
+
+	// Exit to shop channel with "SUCCESS" error code
 	GRRLIB_Exit();
 	WII_Initialize();
 	WII_LaunchTitleWithArgs(0x0001000248414241LL, 0,"/error?error=SUCCESS", NULL); 
-        
-        // Unmount fat and deinit IO
-        fatUnmount("fat:/");
-        __io_usbstorage.shutdown();
-        __io_wiisd.shutdown();
 
 	// In case hell freezes over, exit to loader
 	exit(0);
@@ -19,6 +19,17 @@ extern char * errorCode;
 // Stores the URL of the ZIP to download
 extern char * downloadURL;
 
+// The SHA-1 of an empty file, given to a title's content
+// within its TMD once nullified. See nullifyTitle in main.c.
+extern u8 EMPTY_SHA1_HASH[20];
+
+// The maximum amount of titles installed within a single launch.
+#define TITLE_QUEUE_SIZE 32
+
 // Helpers for manipulating title IDs.
 #define TITLE_UPPER(x) ((u32)((x) >> 32))
-#define TITLE_LOWER(x) ((u32)(x)&0xFFFFFFFF)
\ No newline at end of file
+#define TITLE_LOWER(x) ((u32)(x)&0xFFFFFFFF)
+
+// The directory of this application on the SD card or USB.
+// Data we keep between launches is stored here.
+#define OSC_DATA_PATH "fat:/apps/oscdownload"
\ No newline at end of file
@@ -0,0 +1,186 @@
+#include <fcntl.h>
+#include <gccore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "main.h"
+#include "manifest.h"
+#include "trace.h"
+
+// Writes the path of the manifest of the given title to path.
+void manifestGetPath(char *path, u64 titleId) {
+  snprintf(path, MANIFEST_PATH_SIZE, "%s/%08x%08x.txt", MANIFEST_DIRECTORY, TITLE_UPPER(titleId), TITLE_LOWER(titleId));
+}
+
+// Orders manifest entries by name.
+static int manifestCompare(const void *a, const void *b) {
+  return strcmp(((const struct ManifestEntry *)a)->name, ((const struct ManifestEntry *)b)->name);
+}
+
+// Reads the file at the given path in its entirety, terminated by a null byte.
+// Returns NULL if it could not be read.
+static char *manifestReadFile(const char *path) {
+  TRACE_COUNT(TRACE_FOPEN_CALLS, 1);
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    return NULL;
+  }
+
+  char *data = NULL;
+  long length = -1;
+  if (fseek(file, 0, SEEK_END) == 0) {
+    length = ftell(file);
+  }
+  if (length >= 0 && fseek(file, 0, SEEK_SET) == 0) {
+    data = malloc(length + 1);
+  }
+  if (data != NULL && fread(data, 1, length, file) != (size_t)length) {
+    free(data);
+    data = NULL;
+  }
+  fclose(file);
+
+  if (data != NULL) {
+    data[length] = '\0';
+  }
+  return data;
+}
+
+// Loads the manifest at the given path.
+// A missing or unreadable manifest is loaded as empty.
+//
+// The manifest is kept in memory as read, with every entry's name pointing within it.
+// A manifest of thousands of entries therefore takes two allocations rather than thousands.
+void manifestLoad(struct Manifest *manifest, const char *path) {
+  memset(manifest, 0, sizeof(struct Manifest));
+
+  char *data = manifestReadFile(path);
+  if (data == NULL) {
+    return;
+  }
+
+  // Every entry is a single line, so there are at most as many entries as lines.
+  u32 lines = 1;
+  char *position;
+  for (position = data; *position != '\0'; position++) {
+    if (*position == '\n') {
+      lines++;
+    }
+  }
+
+  manifest->entries = malloc(lines * sizeof(struct ManifestEntry));
+  if (manifest->entries == NULL) {
+    free(data);
+    return;
+  }
+  manifest->data = data;
+
+  // Every entry is its CRC-32, size, modification time and name.
+  char *line = data;
+  while (*line != '\0') {
+    char *end = line + strcspn(line, "\n");
+    char *next = *end == '\0' ? end : end + 1;
+    *end = '\0';
+    if (end > line && end[-1] == '\r') {
+      end[-1] = '\0';
+    }
+
+    unsigned int crc;
+    unsigned long long size;
+    long long mtime;
+    int nameOffset = 0;
+    if (sscanf(line, "%x %llu %lld %n", &crc, &size, &mtime, &nameOffset) == 3 && nameOffset != 0) {
+      struct ManifestEntry *entry = &manifest->entries[manifest->count++];
+      entry->name = line + nameOffset;
+      entry->size = size;
+      entry->crc32 = crc;
+      entry->mtime = (time_t)mtime;
+    }
+    line = next;
+  }
+
+  if (manifest->count > 0) {
+    qsort(manifest->entries, manifest->count, sizeof(struct ManifestEntry), manifestCompare);
+  }
+}
+
+// Returns the entry for the given archive path, or NULL if there is none.
+const struct ManifestEntry *manifestFind(const struct Manifest *manifest, const char *name) {
+  if (manifest->count == 0) {
+    return NULL;
+  }
+
+  struct ManifestEntry key;
+  key.name = (char *)name;
+  return bsearch(&key, manifest->entries, manifest->count, sizeof(struct ManifestEntry), manifestCompare);
+}
+
+// Writes a manifest describing every file of the given archive to the given path.
+// Returns false on failure, in which case no manifest is left at the given path.
+bool manifestSave(const char *path, mz_zip_archive *zip, const time_t *mtimes) {
+  TRACE_SCOPE("manifestSave");
+  TRACE_COUNT(TRACE_MKDIR_CALLS, 3);
+  mkdir("fat:/apps", 0777);
+  mkdir(OSC_DATA_PATH, 0777);
+  mkdir(MANIFEST_DIRECTORY, 0777);
+
+  // We write a temporary file first, so that a manifest is never left partially written.
+  char temporaryPath[MANIFEST_PATH_SIZE + 4];
+  snprintf(temporaryPath, sizeof(temporaryPath), "%s.tmp", path);
+  unlink(path);
+
+  TRACE_COUNT(TRACE_FOPEN_CALLS, 1);
+  FILE *file = fopen(temporaryPath, "w");
+  if (file == NULL) {
+    return false;
+  }
+
+  bool success = true;
+  u32 count = mz_zip_reader_get_num_files(zip);
+  u32 i;
+  for (i = 0; i < count && success; i++) {
+    mz_zip_archive_file_stat stat;
+    if (mtimes[i] == 0 || !mz_zip_reader_file_stat(zip, i, &stat) || stat.m_is_directory) {
+      continue;
+    }
+
+    success = fprintf(file, "%08x %llu %lld %s\n", stat.m_crc32, (unsigned long long)stat.m_uncomp_size, (long long)mtimes[i], stat.m_filename) > 0;
+  }
+
+  success = fclose(file) == 0 && success;
+  success = success && rename(temporaryPath, path) == 0;
+  if (!success) {
+    unlink(temporaryPath);
+  }
+  return success;
+}
+
+// Computes the CRC-32 of the file at the given path, reading it through the given buffer.
+// Returns false if it could not be read.
+bool manifestHashFile(const char *path, u8 *buffer, u32 bufferSize, u32 *result) {
+  TRACE_COUNT(TRACE_FOPEN_CALLS, 1);
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  mz_ulong crc = MZ_CRC32_INIT;
+  ssize_t length;
+  while ((length = read(fd, buffer, bufferSize)) > 0) {
+    crc = mz_crc32(crc, buffer, length);
+  }
+  close(fd);
+
+  *result = (u32)crc;
+  return length == 0;
+}
+
+// Releases every entry of the given manifest.
+void manifestDestroy(struct Manifest *manifest) {
+  free(manifest->entries);
+  free(manifest->data);
+  memset(manifest, 0, sizeof(struct Manifest));
+}
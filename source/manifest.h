@@ -0,0 +1,60 @@
+#pragma once
+
+#include <gccore.h>
+#include <time.h>
+
+#include "miniz.h"
+
+// Manifests of installed titles are kept within our data directory, one per title.
+#define MANIFEST_DIRECTORY OSC_DATA_PATH "/manifests"
+
+// The size of our buffers holding the path of a manifest.
+#define MANIFEST_PATH_SIZE 128
+
+// ManifestEntry describes a file as it was left by a previous install.
+struct ManifestEntry {
+  // The path of the file within its archive, such as "apps/example/boot.dol".
+  char* name;
+  u64 size;
+  u32 crc32;
+
+  // The modification time of the file once written, allowing later changes to be detected.
+  time_t mtime;
+};
+
+// Manifest records every file written by the last successful install of a title.
+//
+// When a title is installed again, archive entries whose size and CRC-32 match the
+// manifest, and whose file has not been modified since, do not need to be written again.
+struct Manifest {
+  // Sorted by name.
+  struct ManifestEntry *entries;
+  u32 count;
+
+  // The contents of the manifest as read, holding the name of every entry.
+  char *data;
+};
+
+// Writes the path of the manifest of the given title to path,
+// which must hold at least MANIFEST_PATH_SIZE bytes.
+void manifestGetPath(char *path, u64 titleId);
+
+// Loads the manifest at the given path.
+// A missing or unreadable manifest is loaded as empty.
+void manifestLoad(struct Manifest *manifest, const char *path);
+
+// Returns the entry for the given archive path, or NULL if there is none.
+const struct ManifestEntry *manifestFind(const struct Manifest *manifest, const char *name);
+
+// Writes a manifest describing every file of the given archive to the given path.
+// mtimes holds the modification time of each entry's file, indexed by entry.
+// Entries with no modification time are left out.
+// Returns false on failure, in which case no manifest is left at the given path.
+bool manifestSave(const char *path, mz_zip_archive *zip, const time_t *mtimes);
+
+// Computes the CRC-32 of the file at the given path, reading it through the given buffer.
+// Returns false if it could not be read.
+bool manifestHashFile(const char *path, u8 *buffer, u32 bufferSize, u32 *result);
+
+// Releases every entry of the given manifest.
+void manifestDestroy(struct Manifest *manifest);
@@ -180,12 +180,19 @@
 #endif
 #endif
 
+/* Set MINIZ_CRC32_SLICE_BY_8 to 0 to use a single 256-entry CRC-32 table instead of eight, trading speed for 7KB less data. */
+#ifndef MINIZ_CRC32_SLICE_BY_8
+#define MINIZ_CRC32_SLICE_BY_8 1
+#endif
+
+#ifndef MINIZ_HAS_64BIT_REGISTERS
 #if defined(_M_X64) || defined(_WIN64) || defined(__MINGW64__) || defined(_LP64) || defined(__LP64__) || defined(__ia64__) || defined(__x86_64__)
 /* Set MINIZ_HAS_64BIT_REGISTERS to 1 if operations on 64-bit integers are reasonably fast (and don't involve compiler generated calls to helper functions). */
 #define MINIZ_HAS_64BIT_REGISTERS 1
 #else
 #define MINIZ_HAS_64BIT_REGISTERS 0
 #endif
+#endif
 
 #ifdef __cplusplus
 extern "C" {
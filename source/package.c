@@ -0,0 +1,275 @@
+#include <errno.h>
+#include <gccore.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "main.h"
+#include "package.h"
+#include "region.h"
+#include "trace.h"
+
+// Prefetching must never delay the package being extracted,
+// so it runs below every extraction stage.
+#define PACKAGE_PREFETCH_PRIORITY 40
+#define PACKAGE_PREFETCH_STACK_SIZE (32 * 1024)
+
+// The layout of the end of central directory record, ending an archive without a comment.
+#define ZIP_END_OF_CENTRAL_DIR_SIZE 22
+#define ZIP_END_OF_CENTRAL_DIR_SIG 0x06054b50
+#define ZIP_END_OF_CENTRAL_DIR_ENTRIES_OFS 10
+#define ZIP_END_OF_CENTRAL_DIR_LENGTH_OFS 12
+
+// The size of a TMD with a single content, the only kind nullifyTitle modifies.
+#define PACKAGE_TMD_SIZE 520
+
+// Space within a package's arena for miniz's own state and our allocation headers,
+// beyond its central directory and indices.
+#define PACKAGE_ARENA_SLACK 1024
+
+// Prepares a package to be opened, without touching NAND.
+static void packageReset(struct Package *package, u64 titleId, const char *path) {
+  memset(package, 0, sizeof(struct Package));
+  package->titleId = titleId;
+  package->thread = LWP_THREAD_NULL;
+  package->stream.fd = -1;
+  snprintf(package->path, PACKAGE_PATH_SIZE, "%s", path);
+}
+
+// miniz's allocation hooks, allocating from the arena of a package.
+static void *packageAlloc(void *opaque, size_t items, size_t size) {
+  return arenaAlloc((struct Arena *)opaque, items * size);
+}
+
+static void packageFree(void *opaque, void *address) {
+  arenaFree((struct Arena *)opaque, address);
+}
+
+static void *packageRealloc(void *opaque, void *address, size_t items, size_t size) {
+  return arenaRealloc((struct Arena *)opaque, address, items * size);
+}
+
+// Returns the size of the arena needed for the central directory of the given package,
+// along with the arrays of 32-bit offsets miniz uses to index and sort it.
+// Returns 0 if the archive ends with a comment, leaving miniz to allocate from the heap.
+static u32 packageArenaSize(struct Package *package) {
+  u8 record[ZIP_END_OF_CENTRAL_DIR_SIZE];
+  u32 length = package->stream.length;
+  if (length < ZIP_END_OF_CENTRAL_DIR_SIZE) {
+    return 0;
+  }
+  if (ISFS_ReadStream(&package->stream, length - ZIP_END_OF_CENTRAL_DIR_SIZE, record, ZIP_END_OF_CENTRAL_DIR_SIZE) != ZIP_END_OF_CENTRAL_DIR_SIZE) {
+    return 0;
+  }
+  if (MZ_READ_LE32(record) != ZIP_END_OF_CENTRAL_DIR_SIG) {
+    return 0;
+  }
+
+  u32 entries = MZ_READ_LE16(record + ZIP_END_OF_CENTRAL_DIR_ENTRIES_OFS);
+  u32 centralDirLength = MZ_READ_LE32(record + ZIP_END_OF_CENTRAL_DIR_LENGTH_OFS);
+  if (centralDirLength > length) {
+    return 0;
+  }
+  return centralDirLength + entries * 2 * sizeof(mz_uint32) + PACKAGE_ARENA_SLACK;
+}
+
+// Returns whether the TMD of the given package's title shows its content as nullified by
+// nullifyTitle, being empty with the hash of an empty file. A TMD which still expects
+// an archive, or which could not be read, does not.
+static bool packageTitleNullified(struct Package *package) {
+  char tmdPath[PACKAGE_PATH_SIZE];
+  snprintf(tmdPath, PACKAGE_PATH_SIZE, "/title/%08x/%08x/content/title.tmd", TITLE_UPPER(package->titleId),
+           TITLE_LOWER(package->titleId));
+
+  // We read beyond the size we expect, so that a longer TMD is noticed.
+  u8 data[PACKAGE_TMD_SIZE + 32] ATTRIBUTE_ALIGN(32);
+  TRACE_COUNT(TRACE_ISFS_CALLS, 1);
+  s32 fd = ISFS_Open(tmdPath, ISFS_OPEN_READ);
+  if (fd < 0) {
+    return false;
+  }
+  TRACE_COUNT(TRACE_ISFS_CALLS, 2);
+  s32 length = ISFS_Read(fd, data, sizeof(data));
+  ISFS_Close(fd);
+  if (length != PACKAGE_TMD_SIZE) {
+    return false;
+  }
+  TRACE_COUNT(TRACE_NAND_BYTES_READ, length);
+
+  tmd *titleTmd = SIGNATURE_PAYLOAD((signed_blob *)data);
+  return titleTmd->contents[0].size == 0 && memcmp(titleTmd->contents[0].hash, EMPTY_SHA1_HASH, 20) == 0;
+}
+
+// Releases the central directory of a package and closes its stream.
+static void packageUnload(struct Package *package) {
+  mz_zip_reader_end(&package->zip);
+  arenaDestroy(&package->arena);
+  ISFS_CloseStream(&package->stream);
+}
+
+// Opens the stream and central directory of a package prepared by packageReset.
+// This may take place on a background thread, so failures are described by the package itself.
+// Returns false on failure, updating the package's errorMessage/errorCode appropiately.
+static bool packageLoad(struct Package *package) {
+  TRACE_SCOPE("packageLoad");
+  if (!ISFS_OpenStream(&package->stream, package->path, regionGetPlan()->windowSize, package->errorMessage,
+                       package->errorCode)) {
+    // An error message is set via ISFS_OpenStream.
+    return false;
+  }
+
+  // An empty content is left by nullifyTitle once a title has been installed, which also
+  // empties the content within its TMD. Should the TMD still expect an archive, the
+  // content was emptied or truncated otherwise, and there is nothing we can install.
+  if (package->stream.length == 0) {
+    if (!packageTitleNullified(package)) {
+      sprintf(package->errorMessage, "Could not initialize zip extraction.");
+      sprintf(package->errorCode, "ZIP_OPEN_FAILED");
+      ISFS_CloseStream(&package->stream);
+      return false;
+    }
+    package->nullified = true;
+    package->opened = true;
+    return true;
+  }
+
+  // miniz allocates its state from an arena sized to fit it, in a single allocation.
+  if (!arenaInit(&package->arena, packageArenaSize(package))) {
+    sprintf(package->errorMessage, "Could not allocate buffer (%d).", errno);
+    sprintf(package->errorCode, "MEM_ALLOC_FAILED");
+    ISFS_CloseStream(&package->stream);
+    return false;
+  }
+
+  // See the following URL for details & examples on how to use miniz:
+  // https://github.com/richgel999/miniz
+  memset(&package->zip, 0, sizeof(mz_zip_archive));
+  package->zip.m_pRead = ISFS_ReadStream;
+  package->zip.m_pIO_opaque = &package->stream;
+  package->zip.m_pAlloc = packageAlloc;
+  package->zip.m_pFree = packageFree;
+  package->zip.m_pRealloc = packageRealloc;
+  package->zip.m_pAlloc_opaque = &package->arena;
+  TRACE_BEGIN(readerInit, "mz_zip_reader_init");
+  bool initialized = mz_zip_reader_init(&package->zip, package->stream.length, 0);
+  TRACE_END(readerInit);
+  if (!initialized) {
+    sprintf(package->errorMessage, "Could not initialize zip extraction.");
+    sprintf(package->errorCode, "ZIP_OPEN_FAILED");
+    arenaDestroy(&package->arena);
+    ISFS_CloseStream(&package->stream);
+    return false;
+  }
+
+  // miniz has just read the central directory through our window,
+  // so hashing it does not require reading NAND again.
+  u8 chunk[512];
+  mz_uint64 offset = package->zip.m_central_directory_file_ofs;
+  size_t remaining = mz_zip_get_central_dir_size(&package->zip);
+  mz_ulong crc = MZ_CRC32_INIT;
+  while (remaining > 0) {
+    size_t length = remaining > sizeof(chunk) ? sizeof(chunk) : remaining;
+    if (ISFS_ReadStream(&package->stream, offset, chunk, length) != length) {
+      // An error message is set via ISFS_ReadStream.
+      packageUnload(package);
+      return false;
+    }
+    crc = mz_crc32(crc, chunk, length);
+    offset += length;
+    remaining -= length;
+  }
+  package->centralDirCrc32 = (u32)crc;
+
+  // The first entry typically begins at the start of the archive.
+  // Reading its local header fills our window from there, leaving the
+  // central directory behind us as extraction has no further use for it.
+  u8 header[4];
+  if (ISFS_ReadStream(&package->stream, 0, header, sizeof(header)) != sizeof(header)) {
+    // An error message is set via ISFS_ReadStream.
+    packageUnload(package);
+    return false;
+  }
+
+  package->opened = true;
+  return true;
+}
+
+// Hands a package over to the calling thread once it has been opened or failed to.
+// From then on, failures of its stream are described by errorMessage/errorCode.
+// Returns false if it failed to open, copying its failure to errorMessage/errorCode.
+static bool packageReport(struct Package *package) {
+  if (!package->opened) {
+    strcpy(errorMessage, package->errorMessage);
+    strcpy(errorCode, package->errorCode);
+    return false;
+  }
+
+  package->stream.errorMessage = errorMessage;
+  package->stream.errorCode = errorCode;
+  return true;
+}
+
+// Opens the package of the given title, stored at the given path.
+// Returns false on failure, updating errorMessage/errorCode appropiately.
+bool packageOpen(struct Package *package, u64 titleId, const char *path) {
+  packageReset(package, titleId, path);
+  packageLoad(package);
+  return packageReport(package);
+}
+
+// The entry point of a background thread opening a package.
+static void *packagePrefetchThread(void *arg) {
+  struct Package *package = (struct Package *)arg;
+  TRACE_THREAD("prefetch");
+  packageLoad(package);
+  return NULL;
+}
+
+// Begins opening the package of the given title on a background thread.
+// Returns false if the thread could not be started.
+bool packagePrefetch(struct Package *package, u64 titleId, const char *path) {
+  packageReset(package, titleId, path);
+
+  s32 ret = LWP_CreateThread(&package->thread, packagePrefetchThread, package, NULL, PACKAGE_PREFETCH_STACK_SIZE, PACKAGE_PREFETCH_PRIORITY);
+  if (ret < 0) {
+    package->thread = LWP_THREAD_NULL;
+    return false;
+  }
+
+  return true;
+}
+
+// Waits for a package being opened in the background.
+// Should its thread not have started, the package is opened on the calling thread instead.
+// Returns false on failure, copying the package's failure to errorMessage/errorCode.
+bool packageWait(struct Package *package) {
+  if (package->thread != LWP_THREAD_NULL) {
+    LWP_JoinThread(package->thread, NULL);
+    package->thread = LWP_THREAD_NULL;
+  } else if (!package->opened) {
+    packageLoad(package);
+  }
+
+  return packageReport(package);
+}
+
+// Closes the given package, releasing its central directory and stream.
+// The usage of its arena is added to the trace.
+void packageClose(struct Package *package) {
+  if (package->thread != LWP_THREAD_NULL) {
+    LWP_JoinThread(package->thread, NULL);
+    package->thread = LWP_THREAD_NULL;
+  }
+
+  if (package->opened) {
+    if (package->nullified) {
+      ISFS_CloseStream(&package->stream);
+    } else {
+      TRACE_COUNT(TRACE_ARENA_BYTES, package->arena.peak);
+      TRACE_COUNT(TRACE_ARENA_WASTED_BYTES, package->arena.wasted);
+      TRACE_COUNT(TRACE_ARENA_REUSED, package->arena.reused);
+      TRACE_COUNT(TRACE_ARENA_OVERFLOWS, package->arena.overflows);
+      packageUnload(package);
+    }
+    package->opened = false;
+  }
+}
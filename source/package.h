@@ -0,0 +1,65 @@
+#pragma once
+
+#include <gccore.h>
+
+#include "arena.h"
+#include "isfs_stream.h"
+#include "miniz.h"
+
+// The size of our buffers holding a path on NAND.
+#define PACKAGE_PATH_SIZE 64
+
+// The size of the buffers describing a failure to open a package.
+#define PACKAGE_ERROR_MESSAGE_SIZE 256
+#define PACKAGE_ERROR_CODE_SIZE 64
+
+// Package is the archive of a title waiting to be installed, streamed from NAND.
+//
+// Opening a package reads its central directory and the start of its first entry,
+// so that extraction may begin without waiting on NAND.
+// This can take place on a background thread while another package is being extracted.
+struct Package {
+  u64 titleId;
+  char path[PACKAGE_PATH_SIZE];
+
+  struct ISFSStream stream;
+  mz_zip_archive zip;
+  bool opened;
+
+  // Holds everything miniz allocates for the archive, released at once when closed.
+  struct Arena arena;
+
+  // Whether the title's content has already been nullified, leaving no archive to install.
+  // This is the case for titles installed by a launch interrupted before finishing its queue,
+  // as shown by their TMD. An empty content the TMD expects to hold an archive fails to open.
+  bool nullified;
+
+  // The CRC-32 of the central directory, identifying the archive's contents.
+  u32 centralDirCrc32;
+
+  // The thread opening this package in the background, if any.
+  lwp_t thread;
+
+  // Describes a failure to open the package. A package opened in the background must not
+  // touch errorMessage/errorCode, as they describe failures of the package being extracted.
+  // Once the package is in use, its stream describes failures there instead.
+  char errorMessage[PACKAGE_ERROR_MESSAGE_SIZE];
+  char errorCode[PACKAGE_ERROR_CODE_SIZE];
+};
+
+// Opens the package of the given title, stored at the given path.
+// Returns false on failure, updating errorMessage/errorCode appropiately.
+bool packageOpen(struct Package *package, u64 titleId, const char *path);
+
+// Begins opening the package of the given title on a background thread.
+// packageWait must be called before the package is used.
+// Returns false if the thread could not be started, in which case the package is opened
+// once packageWait is called instead.
+bool packagePrefetch(struct Package *package, u64 titleId, const char *path);
+
+// Waits for a package being opened in the background.
+// Returns false on failure, copying the package's failure to errorMessage/errorCode.
+bool packageWait(struct Package *package);
+
+// Closes the given package, releasing its central directory and stream.
+void packageClose(struct Package *package);
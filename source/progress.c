@@ -0,0 +1,67 @@
+#include <gccore.h>
+#include <string.h>
+
+#include "progress.h"
+
+// Initializes progress for the given amount of work.
+void progressInit(struct Progress *progress, u64 bytesTotal, u32 entryCount) {
+  memset(progress, 0, sizeof(struct Progress));
+  progress->state.bytesTotal = bytesTotal;
+  progress->state.entryCount = entryCount;
+  LWP_MutexInit(&progress->lock, false);
+}
+
+// Sets the caption shown alongside progress.
+void progressSetCaption(struct Progress *progress, const char *caption) {
+  LWP_MutexLock(progress->lock);
+  strncpy(progress->state.caption, caption, PROGRESS_CAPTION_SIZE - 1);
+  progress->state.sequence++;
+  LWP_MutexUnlock(progress->lock);
+}
+
+// Records the given amount of bytes as done.
+void progressAddBytes(struct Progress *progress, u32 bytes) {
+  LWP_MutexLock(progress->lock);
+  progress->state.bytesDone += bytes;
+  progress->state.sequence++;
+  LWP_MutexUnlock(progress->lock);
+}
+
+// Records an entry as done.
+void progressEntryDone(struct Progress *progress) {
+  LWP_MutexLock(progress->lock);
+  progress->state.entriesDone++;
+  progress->state.sequence++;
+  LWP_MutexUnlock(progress->lock);
+}
+
+// Records all work as finished, whether successful or not.
+void progressFinish(struct Progress *progress) {
+  LWP_MutexLock(progress->lock);
+  progress->state.finished = true;
+  progress->state.sequence++;
+  LWP_MutexUnlock(progress->lock);
+}
+
+// Copies the current progress into the given snapshot.
+void progressGetSnapshot(struct Progress *progress, struct ProgressSnapshot *snapshot) {
+  LWP_MutexLock(progress->lock);
+  memcpy(snapshot, &progress->state, sizeof(struct ProgressSnapshot));
+  LWP_MutexUnlock(progress->lock);
+}
+
+// Returns the fraction of work done within the given snapshot, from 0 to 1.
+float progressFraction(const struct ProgressSnapshot *snapshot) {
+  if (snapshot->bytesTotal > 0) {
+    return (float)snapshot->bytesDone / (float)snapshot->bytesTotal;
+  }
+  if (snapshot->entryCount > 0) {
+    return (float)snapshot->entriesDone / (float)snapshot->entryCount;
+  }
+  return 0.0f;
+}
+
+// Releases the given progress.
+void progressDestroy(struct Progress *progress) {
+  LWP_MutexDestroy(progress->lock);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <gccore.h>
+
+// The size of the caption shown alongside progress, typically a path.
+#define PROGRESS_CAPTION_SIZE 1024
+
+// ProgressSnapshot is a consistent copy of progress at a single point in time.
+struct ProgressSnapshot {
+  // Incremented on every update, allowing unchanged progress to be detected.
+  u32 sequence;
+
+  u64 bytesDone;
+  u64 bytesTotal;
+  u32 entriesDone;
+  u32 entryCount;
+  bool finished;
+  char caption[PROGRESS_CAPTION_SIZE];
+};
+
+// Progress is shared between the thread performing work and the thread rendering it.
+// Updates and snapshots are guarded by a mutex so that a snapshot is never torn.
+struct Progress {
+  mutex_t lock;
+  struct ProgressSnapshot state;
+};
+
+// Initializes progress for the given amount of work.
+void progressInit(struct Progress *progress, u64 bytesTotal, u32 entryCount);
+
+// Sets the caption shown alongside progress.
+void progressSetCaption(struct Progress *progress, const char *caption);
+
+// Records the given amount of bytes as done.
+void progressAddBytes(struct Progress *progress, u32 bytes);
+
+// Records an entry as done.
+void progressEntryDone(struct Progress *progress);
+
+// Records all work as finished, whether successful or not.
+void progressFinish(struct Progress *progress);
+
+// Copies the current progress into the given snapshot.
+void progressGetSnapshot(struct Progress *progress, struct ProgressSnapshot *snapshot);
+
+// Returns the fraction of work done within the given snapshot, from 0 to 1.
+// Work is weighted by bytes, falling back to entries when there are no bytes to write.
+float progressFraction(const struct ProgressSnapshot *snapshot);
+
+// Releases the given progress.
+void progressDestroy(struct Progress *progress);
@@ -0,0 +1,170 @@
+#include <gccore.h>
+#include <malloc.h>
+#include <ogc/lwp_heap.h>
+#include <ogc/machine/processor.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "extract.h"
+#include "region.h"
+
+// Our plans, from largest to smallest. The smallest is chosen should no other fit.
+static const struct RegionPlan regionPlans[] = {
+    {"large", 256 * 1024, 256 * 1024, 8},
+    {"default", 128 * 1024, 128 * 1024, 4},
+    {"small", 32 * 1024, 64 * 1024, 2},
+};
+#define REGION_PLAN_COUNT (sizeof(regionPlans) / sizeof(regionPlans[0]))
+
+// The plan chosen by regionInit.
+static struct RegionPlan plan;
+
+// The memory reserved for a region, and the heap managing it.
+static struct {
+  bool reserved;
+  u8 *start;
+  u32 size;
+  heap_cntrl heap;
+
+  u32 peak;
+  u32 fallbacks;
+} regions[REGION_COUNT];
+
+// Reserves the given amount of bytes below the given top of an arena, returning its start.
+// Returns NULL should the arena be too small.
+static u8 *regionReserve(u8 *low, u8 *high, u32 size) {
+  u8 *top = high - ((uintptr_t)high & (REGION_ALIGNMENT - 1));
+  if (top < low || (u32)(top - low) < size) {
+    return NULL;
+  }
+  return top - size;
+}
+
+// Computes the budget of each region needed by the given plan.
+// MEM1 holds the inflate dictionary and the FatWriter's buffer.
+// MEM2 holds the blocks of both extraction links, the hash buffer and two package windows,
+// as the next package is opened while the current one is extracted.
+static void regionPlanBudgets(struct RegionPlan *p) {
+  p->budgets[REGION_MEM1] = TINFL_LZ_DICT_SIZE + p->writerSize + REGION_SLACK;
+  p->budgets[REGION_MEM2] = (2 * p->ringDepth + 1) * EXTRACT_BLOCK_SIZE + 2 * p->windowSize + REGION_SLACK;
+}
+
+// Chooses the largest plan the arenas are able to accommodate,
+// and reserves its budget within each region from the top of its arena.
+// Must be called early on, before the heap grows in to the memory reserved.
+void regionInit() {
+  memset(regions, 0, sizeof(regions));
+
+  u32 arenaSizes[REGION_COUNT] = {SYS_GetArena1Size(), SYS_GetArena2Size()};
+  u32 i;
+  for (i = 0; i < REGION_PLAN_COUNT; i++) {
+    plan = regionPlans[i];
+    regionPlanBudgets(&plan);
+#ifdef REGION_TIER
+    if (i == REGION_TIER) {
+      break;
+    }
+#else
+    if (plan.budgets[REGION_MEM1] <= arenaSizes[REGION_MEM1] / REGION_ARENA_SHARE &&
+        plan.budgets[REGION_MEM2] <= arenaSizes[REGION_MEM2] / REGION_ARENA_SHARE) {
+      break;
+    }
+#endif
+  }
+  memcpy(plan.arenaSizes, arenaSizes, sizeof(arenaSizes));
+
+#if REGION_PLACEMENT == REGION_PLACEMENT_HEAP
+  // Nothing is reserved, so that every allocation is made from the heap.
+  return;
+#endif
+
+  // The heap grows from the bottom of each arena, so we lower their tops.
+  u32 level;
+  _CPU_ISR_Disable(level);
+  u8 *mem1 = regionReserve(SYS_GetArena1Lo(), SYS_GetArena1Hi(), plan.budgets[REGION_MEM1]);
+  if (mem1 != NULL) {
+    SYS_SetArena1Hi(mem1);
+  }
+  u8 *mem2 = regionReserve(SYS_GetArena2Lo(), SYS_GetArena2Hi(), plan.budgets[REGION_MEM2]);
+  if (mem2 != NULL) {
+    SYS_SetArena2Hi(mem2);
+  }
+  _CPU_ISR_Restore(level);
+
+  u8 *starts[REGION_COUNT] = {mem1, mem2};
+  for (i = 0; i < REGION_COUNT; i++) {
+    if (starts[i] == NULL) {
+      continue;
+    }
+    regions[i].start = starts[i];
+    regions[i].size = plan.budgets[i];
+    regions[i].reserved = __lwp_heap_init(&regions[i].heap, starts[i], plan.budgets[i], REGION_ALIGNMENT) > 0;
+  }
+}
+
+// Returns the plan chosen by regionInit.
+const struct RegionPlan *regionGetPlan() {
+  return &plan;
+}
+
+// Returns the amount of bytes in use within the given region.
+static u32 regionUsed(enum Region region) {
+  heap_iblock info;
+  if (!regions[region].reserved || __lwp_heap_getinfo(&regions[region].heap, &info) != 0) {
+    return 0;
+  }
+  return info.used_size;
+}
+
+// Allocates the given amount of bytes within the given region, aligned by REGION_ALIGNMENT.
+// Allocations which do not fit within the region's budget are made from the heap instead.
+void *regionAlloc(enum Region region, u32 size) {
+  // Packages are opened on a background thread, so our bookkeeping is done with interrupts disabled.
+  void *pointer = NULL;
+  u32 level;
+  _CPU_ISR_Disable(level);
+  if (regions[region].reserved) {
+    pointer = __lwp_heap_allocate(&regions[region].heap, size);
+  }
+  if (pointer != NULL) {
+    u32 used = regionUsed(region);
+    if (used > regions[region].peak) {
+      regions[region].peak = used;
+    }
+  } else {
+    regions[region].fallbacks++;
+  }
+  _CPU_ISR_Restore(level);
+
+  if (pointer == NULL) {
+    return memalign(REGION_ALIGNMENT, size);
+  }
+  return pointer;
+}
+
+// Frees an allocation made by regionAlloc.
+void regionFree(void *pointer) {
+  if (pointer == NULL) {
+    return;
+  }
+
+  u32 i;
+  for (i = 0; i < REGION_COUNT; i++) {
+    u8 *p = (u8 *)pointer;
+    if (regions[i].reserved && p >= regions[i].start && p < regions[i].start + regions[i].size) {
+      __lwp_heap_free(&regions[i].heap, pointer);
+      return;
+    }
+  }
+
+  free(pointer);
+}
+
+// Retrieves the usage of the given region.
+void regionGetStats(enum Region region, struct RegionStats *stats) {
+  stats->budget = regions[region].reserved ? regions[region].size : 0;
+  stats->used = regionUsed(region);
+  stats->peak = regions[region].peak;
+  stats->fallbacks = regions[region].fallbacks;
+}
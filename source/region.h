@@ -0,0 +1,89 @@
+#pragma once
+
+#include <gccore.h>
+
+// The Wii has two banks of memory. MEM1 is small, but quicker to access than MEM2,
+// which holds the remainder of the heap once MEM1 fills up.
+//
+// State touched for every byte extracted, such as the inflate dictionary and the buffer
+// files are written from, is placed within MEM1. Data streamed through once, such as the
+// window packages are read through and the blocks passed between extraction threads,
+// is placed within MEM2, keeping MEM1 free for whatever is hot.
+enum Region {
+  REGION_MEM1,
+  REGION_MEM2,
+  REGION_COUNT
+};
+
+// The share of each arena we are willing to reserve. A plan is only chosen
+// should neither of its budgets exceed this fraction of the arena available at startup.
+#define REGION_ARENA_SHARE 8
+
+// Memory reserved beyond our buffers, covering the heap's own bookkeeping
+// and the FatWriter's buffer being rounded up to a whole number of clusters.
+#define REGION_SLACK (64 * 1024)
+
+// The alignment of every allocation, as required by ISFS and suitable for DMA.
+#define REGION_ALIGNMENT 32
+
+// Where our buffers are placed. By default, each is placed within its region as above.
+// Building with PLACEMENT=1 reserves nothing, leaving every buffer to the heap as before
+// regions existed, so that both placements may be compared. See tests/bench.c.
+#define REGION_PLACEMENT_REGIONS 0
+#define REGION_PLACEMENT_HEAP 1
+#ifndef REGION_PLACEMENT
+#define REGION_PLACEMENT REGION_PLACEMENT_REGIONS
+#endif
+
+// RegionPlan describes the size of our buffers, chosen by regionInit from the memory available.
+//
+// Larger buffers mean fewer calls to IOS and more work in flight between extraction threads,
+// but consoles running from a loader or with a large executable have less to spare.
+// Building with MEMORY_TIER set to a plan's index forces that plan, so that every plan
+// can be exercised regardless of the memory available.
+struct RegionPlan {
+  const char *name;
+
+  // The window each package is read through, a multiple of 32.
+  u32 windowSize;
+  // The minimum size of the FatWriter's buffer.
+  u32 writerSize;
+  // The amount of blocks in flight between two extraction stages,
+  // no more than EXTRACT_RING_MAX_DEPTH.
+  u32 ringDepth;
+
+  // The size of each arena at startup, from which the plan was chosen,
+  // and the budget reserved within each region for it.
+  u32 arenaSizes[REGION_COUNT];
+  u32 budgets[REGION_COUNT];
+};
+
+// The usage of a region.
+struct RegionStats {
+  u32 budget;
+  u32 used;
+  u32 peak;
+
+  // The amount of allocations made from the heap, as they did not fit within the budget.
+  u32 fallbacks;
+};
+
+// Chooses the largest plan the arenas are able to accommodate,
+// and reserves its budget within each region from the top of its arena.
+// Must be called early on, before the heap grows in to the memory reserved.
+// Should a region not be reserved, its allocations are made from the heap instead.
+void regionInit();
+
+// Returns the plan chosen by regionInit.
+const struct RegionPlan *regionGetPlan();
+
+// Allocates the given amount of bytes within the given region, aligned by REGION_ALIGNMENT.
+// Allocations which do not fit within the region's budget are made from the heap instead.
+// Returns NULL on failure.
+void *regionAlloc(enum Region region, u32 size);
+
+// Frees an allocation made by regionAlloc.
+void regionFree(void *pointer);
+
+// Retrieves the usage of the given region.
+void regionGetStats(enum Region region, struct RegionStats *stats);
@@ -0,0 +1,50 @@
+#include <gccore.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ring.h"
+
+// Initializes a ring able to hold the given amount of items.
+// Returns false if its slots could not be allocated.
+bool ringInit(struct Ring *ring, u32 capacity) {
+  memset(ring, 0, sizeof(struct Ring));
+
+  ring->slots = malloc(capacity * sizeof(void *));
+  if (ring->slots == NULL) {
+    return false;
+  }
+
+  ring->capacity = capacity;
+  LWP_SemInit(&ring->filled, 0, capacity);
+  LWP_SemInit(&ring->free, capacity, capacity);
+  return true;
+}
+
+// Appends an item to the ring, waiting for a free slot if necessary.
+void ringPush(struct Ring *ring, void *item) {
+  LWP_SemWait(ring->free);
+  ring->slots[ring->head] = item;
+  ring->head = (ring->head + 1) % ring->capacity;
+  LWP_SemPost(ring->filled);
+}
+
+// Removes the oldest item from the ring, waiting for one if necessary.
+void *ringPop(struct Ring *ring) {
+  LWP_SemWait(ring->filled);
+  void *item = ring->slots[ring->tail];
+  ring->tail = (ring->tail + 1) % ring->capacity;
+  LWP_SemPost(ring->free);
+  return item;
+}
+
+// Releases the slots and semaphores of the given ring.
+void ringDestroy(struct Ring *ring) {
+  if (ring->slots == NULL) {
+    return;
+  }
+
+  LWP_SemDestroy(ring->filled);
+  LWP_SemDestroy(ring->free);
+  free(ring->slots);
+  ring->slots = NULL;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <gccore.h>
+
+// Ring is a bounded single-producer/single-consumer queue of pointers.
+//
+// Exactly one thread may push, and exactly one other thread may pop.
+// Pushing blocks while the ring is full, and popping blocks while it is empty,
+// so that a slow stage naturally throttles the stage feeding it.
+struct Ring {
+  void** slots;
+  u32 capacity;
+
+  // Only ever advanced by the producer and the consumer respectively.
+  u32 head;
+  u32 tail;
+
+  // Counts of filled and free slots, used to block either side.
+  sem_t filled;
+  sem_t free;
+};
+
+// Initializes a ring able to hold the given amount of items.
+// Returns false if its slots could not be allocated.
+bool ringInit(struct Ring *ring, u32 capacity);
+
+// Appends an item to the ring, waiting for a free slot if necessary.
+void ringPush(struct Ring *ring, void *item);
+
+// Removes the oldest item from the ring, waiting for one if necessary.
+void *ringPop(struct Ring *ring);
+
+// Releases the slots and semaphores of the given ring.
+void ringDestroy(struct Ring *ring);
@@ -0,0 +1,436 @@
+#include <errno.h>
+#include <fat.h>
+#include <fcntl.h>
+#include <gccore.h>
+#include <malloc.h>
+#include <ogc/lwp_watchdog.h>
+#include <ogc/usbstorage.h>
+#include <sdcard/wiisd_io.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ec_cfg.h"
+#include "main.h"
+#include "storage.h"
+#include "trace.h"
+
+// The profiles we probe, from the smallest to the largest memory footprint.
+static const struct StorageProfile storageCandidates[] = {
+  { 4, 64 },
+  { 8, 64 },
+  { 16, 64 },
+  { 8, 128 },
+};
+#define STORAGE_CANDIDATE_COUNT (sizeof(storageCandidates) / sizeof(storageCandidates[0]))
+
+// The devices we may install to, in the order preferred when neither is measured faster.
+static struct StorageDevice storageDevices[STORAGE_DEVICE_COUNT] = {
+  { &__io_wiisd, false, false, 0 },
+  { &__io_usbstorage, false, false, 0 },
+};
+
+// The profile in use, and the device it is in use with. NULL while nothing is mounted.
+static struct StorageProfile storageProfile = { STORAGE_DEFAULT_CACHE_PAGES, STORAGE_DEFAULT_SECTORS_PER_PAGE };
+static const DISC_INTERFACE *storageDevice = NULL;
+
+// Returns whether the given profile is within reason.
+static bool storageProfileValid(const struct StorageProfile *profile) {
+  return profile->cachePages >= 2 && profile->cachePages <= 64 &&
+         profile->sectorsPerPage >= 8 && profile->sectorsPerPage <= 256;
+}
+
+// Mounts the given device as "fat:" with the given profile.
+static bool storageMountProfile(const DISC_INTERFACE *device, const struct StorageProfile *profile) {
+  if (!fatMount("fat", device, 0, profile->cachePages, profile->sectorsPerPage)) {
+    return false;
+  }
+
+  storageProfile = *profile;
+  storageDevice = device;
+  return true;
+}
+
+// Reads a profile from osc.cfg.
+// Returns false if either key is not present.
+static bool storageReadConfigProfile(struct StorageProfile *profile) {
+  char *cachePages = ecGetKeyValue("fatCachePages");
+  char *sectorsPerPage = ecGetKeyValue("fatSectorsPerPage");
+  if (cachePages == NULL || sectorsPerPage == NULL) {
+    return false;
+  }
+
+  profile->cachePages = strtoul(cachePages, NULL, 10);
+  profile->sectorsPerPage = strtoul(sectorsPerPage, NULL, 10);
+  return storageProfileValid(profile);
+}
+
+// Reads the profile remembered on the mounted device, along with the throughput it was measured at.
+// Profiles remembered before throughput was measured hold no throughput, which is then 0.
+// Returns false if there is none.
+static bool storageReadSavedProfile(struct StorageProfile *profile, u32 *throughput) {
+  TRACE_COUNT(TRACE_FOPEN_CALLS, 1);
+  FILE *file = fopen(STORAGE_PROFILE_PATH, "r");
+  if (file == NULL) {
+    return false;
+  }
+
+  *throughput = 0;
+  int count = fscanf(file, "%u %u %u", &profile->cachePages, &profile->sectorsPerPage, throughput);
+  fclose(file);
+  return count >= 2 && storageProfileValid(profile);
+}
+
+// Writes the given profile and throughput to the mounted device.
+// Returns false should it not have been written in its entirety.
+static bool storageWriteProfile(const struct StorageProfile *profile, u32 throughput) {
+  TRACE_COUNT(TRACE_FOPEN_CALLS, 1);
+  FILE *file = fopen(STORAGE_PROFILE_PATH, "w");
+  if (file == NULL) {
+    return false;
+  }
+
+  bool success = fprintf(file, "%u %u %u\n", profile->cachePages, profile->sectorsPerPage, throughput) > 0;
+  return fclose(file) == 0 && success;
+}
+
+// Ensures our data directory exists on the mounted device.
+static void storageCreateDataPath() {
+  TRACE_COUNT(TRACE_MKDIR_CALLS, 2);
+  mkdir("fat:/apps", 0777);
+  mkdir(OSC_DATA_PATH, 0777);
+}
+
+// Writes data in the given buffer to a file at the given path.
+static bool storageProbeWrite(const char *path, const u8 *buffer, u32 chunk, u32 length) {
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0) {
+    return false;
+  }
+
+  bool success = true;
+  while (length > 0 && success) {
+    u32 size = length < chunk ? length : chunk;
+    success = write(fd, buffer, size) == (ssize_t)size;
+    length -= size;
+  }
+
+  return close(fd) == 0 && success;
+}
+
+// Removes the files written by storageProbe, should any remain.
+static void storageRemoveProbeFiles() {
+  char path[64];
+  unlink(STORAGE_PROBE_PATH);
+  int i;
+  for (i = 0; i < STORAGE_PROBE_SMALL_FILES; i++) {
+    sprintf(path, "%s.%d", STORAGE_PROBE_PATH, i);
+    unlink(path);
+  }
+}
+
+// Remembers the given profile and the throughput it was measured at on the mounted device.
+//
+// Should it not be remembered, the device is probed again next launch. Nothing is left behind
+// in the meantime, neither a partial profile nor the probe's scratch files.
+static void storageSaveProfile(const struct StorageProfile *profile, u32 throughput) {
+  if (!storageWriteProfile(profile, throughput)) {
+    TRACE_COUNT(TRACE_PROFILE_SAVE_FAILURES, 1);
+    unlink(STORAGE_PROFILE_PATH);
+    storageRemoveProbeFiles();
+  }
+}
+
+// Measures the time taken by a workload resembling extraction on the mounted device:
+// a large file written in large blocks and read back, followed by several small files.
+// Unmounting is included, as it flushes whatever the cache still holds.
+// Returns the time taken in microseconds, or 0 on failure.
+static u32 storageProbe(u8 *buffer) {
+  char path[64];
+  u64 start = gettime();
+
+  bool success = storageProbeWrite(STORAGE_PROBE_PATH, buffer, 64 * 1024, STORAGE_PROBE_SIZE);
+
+  int fd = open(STORAGE_PROBE_PATH, O_RDONLY);
+  if (fd >= 0) {
+    while (read(fd, buffer, 64 * 1024) > 0);
+    close(fd);
+  } else {
+    success = false;
+  }
+
+  int i;
+  for (i = 0; i < STORAGE_PROBE_SMALL_FILES && success; i++) {
+    sprintf(path, "%s.%d", STORAGE_PROBE_PATH, i);
+    success = storageProbeWrite(path, buffer, 4 * 1024, 3000 + i * 512);
+  }
+
+  storageRemoveProbeFiles();
+  fatUnmount("fat:");
+  u32 elapsed = diff_usec(start, gettime());
+  return success ? elapsed : 0;
+}
+
+// The amount of bytes written by storageProbe.
+static u64 storageProbeBytes() {
+  u64 bytes = STORAGE_PROBE_SIZE;
+  int i;
+  for (i = 0; i < STORAGE_PROBE_SMALL_FILES; i++) {
+    bytes += 3000 + i * 512;
+  }
+  return bytes;
+}
+
+// Probes each of the given profiles, returning the fastest along with its throughput in KiB/s.
+// The device is left unmounted.
+static struct StorageProfile storageProbeProfiles(const DISC_INTERFACE *device, const struct StorageProfile *candidates,
+                                                  u32 count, u32 *throughput) {
+  struct StorageProfile best = { STORAGE_DEFAULT_CACHE_PAGES, STORAGE_DEFAULT_SECTORS_PER_PAGE };
+  u32 bestTime = 0;
+
+  u8 *buffer = memalign(32, 64 * 1024);
+  if (buffer == NULL) {
+    return best;
+  }
+  memset(buffer, 0xA5, 64 * 1024);
+
+  u32 i;
+  for (i = 0; i < count; i++) {
+    if (!storageMountProfile(device, &candidates[i])) {
+      continue;
+    }
+
+    u32 elapsed = storageProbe(buffer);
+    if (elapsed > 0 && (bestTime == 0 || elapsed < bestTime)) {
+      best = candidates[i];
+      bestTime = elapsed;
+    }
+  }
+
+  free(buffer);
+  *throughput = bestTime > 0 ? (u32)(storageProbeBytes() * 1000000 / bestTime / 1024) : 0;
+  return best;
+}
+
+// Measures the throughput of the mounted device with the profile it is mounted with,
+// remembering the two together. The device is then mounted again with that profile.
+// Returns false should it not be mountable again.
+static bool storageMeasure(const DISC_INTERFACE *device, u32 *throughput) {
+  struct StorageProfile profile = storageProfile;
+  storageCreateDataPath();
+  fatUnmount("fat:");
+
+  TRACE_BEGIN(probe, "storageProbeProfiles");
+  storageProbeProfiles(device, &profile, 1, throughput);
+  TRACE_END(probe);
+  if (!storageMountProfile(device, &profile)) {
+    return false;
+  }
+
+  if (*throughput > 0) {
+    storageSaveProfile(&profile, *throughput);
+  }
+  return true;
+}
+
+// Mounts the given device as "fat:" with a tuned cache profile.
+//
+// The profile is taken from osc.cfg if present. Otherwise, the profile remembered
+// on the device is used. Should neither exist, every candidate profile is probed,
+// and the fastest is remembered for later launches.
+//
+// The throughput the device was measured at is written to throughput, or 0 if unknown.
+// Should measure be set, a device whose throughput is unknown is measured with the profile
+// it is mounted with, as choosing between devices needs the throughput of each.
+// Returns false if the device could not be mounted.
+static bool storageMount(const DISC_INTERFACE *device, bool measure, u32 *throughput) {
+  TRACE_SCOPE("storageMount");
+  struct StorageProfile profile;
+  *throughput = 0;
+
+  // A profile given by osc.cfg takes priority. The device is then only read for its throughput.
+  if (storageReadConfigProfile(&profile)) {
+    if (!storageMountProfile(device, &profile)) {
+      return false;
+    }
+
+    struct StorageProfile saved;
+    if (measure && !storageReadSavedProfile(&saved, throughput)) {
+      *throughput = 0;
+    }
+    return !measure || *throughput > 0 || storageMeasure(device, throughput);
+  }
+
+  // Otherwise, we need to mount the device in order to find its remembered profile.
+  struct StorageProfile defaults = { STORAGE_DEFAULT_CACHE_PAGES, STORAGE_DEFAULT_SECTORS_PER_PAGE };
+  if (!storageMountProfile(device, &defaults)) {
+    return false;
+  }
+
+  if (storageReadSavedProfile(&profile, throughput)) {
+    if (profile.cachePages != defaults.cachePages || profile.sectorsPerPage != defaults.sectorsPerPage) {
+      fatUnmount("fat:");
+      if (!storageMountProfile(device, &profile) && !storageMountProfile(device, &defaults)) {
+        return false;
+      }
+    }
+
+    // Profiles remembered before throughput was measured have none.
+    return !measure || *throughput > 0 || storageMeasure(device, throughput);
+  }
+
+  // This device has not been seen before. Probe it, and remember the result.
+  storageCreateDataPath();
+  fatUnmount("fat:");
+
+  TRACE_BEGIN(probe, "storageProbeProfiles");
+  profile = storageProbeProfiles(device, storageCandidates, STORAGE_CANDIDATE_COUNT, throughput);
+  TRACE_END(probe);
+  if (!storageMountProfile(device, &profile) && !storageMountProfile(device, &defaults)) {
+    return false;
+  }
+
+  storageSaveProfile(&storageProfile, *throughput);
+  return true;
+}
+
+// Starts the given device, and checks whether it holds any media.
+static void storageStart(struct StorageDevice *device) {
+  TRACE_SCOPE("storageStart");
+  device->started = device->interface->startup();
+  device->inserted = device->started && device->interface->isInserted();
+}
+
+// Starts the given device on a background thread.
+static void *storageStartThread(void *arg) {
+  TRACE_THREAD("storage");
+  storageStart((struct StorageDevice *)arg);
+  return NULL;
+}
+
+// Starts both devices at once, as either may take some time to respond.
+// Should a thread not be available, they are started one after the other.
+static void storageStartAll() {
+  lwp_t thread;
+  struct StorageDevice *usb = &storageDevices[STORAGE_DEVICE_USB];
+  if (LWP_CreateThread(&thread, storageStartThread, usb, NULL, STORAGE_THREAD_STACK_SIZE, STORAGE_THREAD_PRIORITY) < 0) {
+    thread = LWP_THREAD_NULL;
+  }
+
+  storageStart(&storageDevices[STORAGE_DEVICE_SD]);
+  if (thread != LWP_THREAD_NULL) {
+    LWP_JoinThread(thread, NULL);
+  } else {
+    storageStart(usb);
+  }
+}
+
+// Reads which device osc.cfg would have us install to.
+static enum StoragePolicy storageReadPolicy() {
+  char *value = ecGetKeyValue("storageDevice");
+  if (value == NULL) {
+    return STORAGE_POLICY_SD;
+  }
+
+  if (strcmp(value, "usb") == 0) {
+    return STORAGE_POLICY_USB;
+  } else if (strcmp(value, "fastest") == 0) {
+    return STORAGE_POLICY_FASTEST;
+  }
+  return STORAGE_POLICY_SD;
+}
+
+// Mounts the given device, remembering its throughput, measuring it should measure be set and it be unknown.
+// It is shut down should it not hold a mountable filesystem.
+static bool storageMountDevice(struct StorageDevice *device, bool measure) {
+  if (!storageMount(device->interface, measure, &device->throughput)) {
+    device->inserted = false;
+    device->interface->shutdown();
+    device->started = false;
+    return false;
+  }
+  return true;
+}
+
+// Starts and mounts the device osc.cfg would have us install to.
+// Returns false on failure, updating errorMessage/errorCode appropiately.
+bool storageInit() {
+  TRACE_SCOPE("storageInit");
+  enum StoragePolicy policy = storageReadPolicy();
+
+  struct StorageDevice *chosen = NULL;
+  if (policy == STORAGE_POLICY_FASTEST) {
+    storageStartAll();
+
+    // Each device holding media is mounted in turn to learn its throughput, measuring it should
+    // it not be known, even when osc.cfg gives the profile. The fastest is then mounted again
+    // for us to install to. A device which could not be measured is never preferred over one which was.
+    u32 i;
+    for (i = 0; i < STORAGE_DEVICE_COUNT; i++) {
+      struct StorageDevice *device = &storageDevices[i];
+      if (!device->inserted || !storageMountDevice(device, true)) {
+        continue;
+      }
+      fatUnmount("fat:");
+      storageDevice = NULL;
+
+      if (chosen == NULL || device->throughput > chosen->throughput) {
+        chosen = device;
+      }
+    }
+
+    if (chosen != NULL && !storageMountDevice(chosen, false)) {
+      chosen = NULL;
+    }
+  } else {
+    // The preferred device is started first. The other is only started should it hold no media.
+    struct StorageDevice *preferred = &storageDevices[policy == STORAGE_POLICY_USB ? STORAGE_DEVICE_USB : STORAGE_DEVICE_SD];
+    struct StorageDevice *fallback = &storageDevices[policy == STORAGE_POLICY_USB ? STORAGE_DEVICE_SD : STORAGE_DEVICE_USB];
+
+    storageStart(preferred);
+    if (preferred->inserted && storageMountDevice(preferred, false)) {
+      chosen = preferred;
+    } else {
+      storageStart(fallback);
+      if (fallback->inserted && storageMountDevice(fallback, false)) {
+        chosen = fallback;
+      }
+    }
+  }
+
+  // Whichever device we are not installing to is shut down, so that it is left idle during extraction.
+  u32 i;
+  for (i = 0; i < STORAGE_DEVICE_COUNT; i++) {
+    struct StorageDevice *device = &storageDevices[i];
+    if (device != chosen && device->started) {
+      device->interface->shutdown();
+      device->started = false;
+    }
+  }
+
+  if (chosen == NULL) {
+    // No input devices were inserted OR it failed to mount either device.
+    sprintf(errorMessage, "Please insert either an SD Card or USB.");
+    sprintf(errorCode, "FAT_INIT_FAILED");
+    return false;
+  }
+  return true;
+}
+
+// Returns the profile the device was mounted with.
+struct StorageProfile storageGetProfile() {
+  return storageProfile;
+}
+
+// Flushes and unmounts "fat:", then shuts down the device it was mounted from.
+void storageUnmount() {
+  if (storageDevice == NULL) {
+    return;
+  }
+
+  fatUnmount("fat:");
+  storageDevice->shutdown();
+  storageDevice = NULL;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <gccore.h>
+
+// A libfat cache profile.
+// libfat holds cachePages pages of sectorsPerPage sectors each in memory.
+struct StorageProfile {
+  u32 cachePages;
+  u32 sectorsPerPage;
+};
+
+// The profile libfat uses when mounted through fatMountSimple.
+#define STORAGE_DEFAULT_CACHE_PAGES 4
+#define STORAGE_DEFAULT_SECTORS_PER_PAGE 64
+
+// The chosen profile is remembered on the device itself, so that it is only probed once.
+// It holds the cache pages, sectors per page and throughput in KiB/s, separated by spaces.
+// Profiles remembered before throughput was measured hold only the first two.
+#define STORAGE_PROFILE_PATH OSC_DATA_PATH "/fatcache.cfg"
+
+// A scratch file written and removed while probing.
+#define STORAGE_PROBE_PATH OSC_DATA_PATH "/probe.tmp"
+
+// The size of the file written while probing each profile.
+#define STORAGE_PROBE_SIZE (512 * 1024)
+
+// The amount of small files written while probing each profile.
+#define STORAGE_PROBE_SMALL_FILES 16
+
+// The devices we may install to.
+enum StorageDeviceIndex {
+  STORAGE_DEVICE_SD,
+  STORAGE_DEVICE_USB,
+  STORAGE_DEVICE_COUNT
+};
+
+// StorageDevice tracks a device while choosing which to install to.
+struct StorageDevice {
+  const DISC_INTERFACE *interface;
+  bool started;
+  bool inserted;
+
+  // The write throughput measured when its profile was probed, in KiB/s. Zero if unknown.
+  u32 throughput;
+};
+
+// Which device to install to, as given by the osc.cfg key "storageDevice".
+//
+// "sd", the default, installs to the SD card, and "usb" to a USB drive. Either falls back
+// to the other device should it hold no media, which is only started in that case.
+// "fastest" starts both devices at once and installs to whichever was measured faster.
+// A device is measured once, with the profile it is mounted with, should its throughput
+// not already be remembered. This holds for profiles given by osc.cfg too.
+enum StoragePolicy {
+  STORAGE_POLICY_SD,
+  STORAGE_POLICY_USB,
+  STORAGE_POLICY_FASTEST
+};
+
+// The thread starting the USB drive while the SD card is started, under the "fastest" policy.
+#define STORAGE_THREAD_STACK_SIZE (16 * 1024)
+#define STORAGE_THREAD_PRIORITY 80
+
+// Starts the device chosen by the osc.cfg key "storageDevice" and mounts it as "fat:"
+// with a tuned cache profile. Any other device started along the way is shut down again.
+//
+// The profile is taken from the osc.cfg keys "fatCachePages" and "fatSectorsPerPage"
+// if present. Otherwise, the profile remembered on the device is used. Should neither
+// exist, a short write/read probe is run for every candidate profile, and the fastest
+// is remembered for later launches along with the throughput it reached.
+//
+// osc.cfg must already be loaded.
+// Returns false on failure, updating errorMessage/errorCode appropiately.
+bool storageInit();
+
+// Returns the profile the device was mounted with.
+struct StorageProfile storageGetProfile();
+
+// Flushes and unmounts "fat:", then shuts down the device it was mounted from.
+//
+// libfat only writes the free cluster count, and whatever its cache still holds,
+// once unmounted. This must be called before relaunching, as nothing is unmounted for us.
+// Does nothing if nothing is mounted.
+void storageUnmount();
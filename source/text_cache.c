@@ -0,0 +1,169 @@
+#include <gccore.h>
+#include <grrlib.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "text_cache.h"
+
+// The area covered by the glyphs of a string, relative to the top-left of its line.
+struct TextBounds {
+  bool empty;
+  int left;
+  int top;
+  int right;
+  int bottom;
+};
+
+// Extends the bounds of a string by a single glyph.
+static void textCacheMeasureGlyph(const struct Font *font, const struct FontGlyph *glyph, int x, int y, void *arg) {
+  struct TextBounds *bounds = (struct TextBounds *)arg;
+  if (bounds->empty) {
+    bounds->left = x;
+    bounds->top = y;
+    bounds->right = x + glyph->width;
+    bounds->bottom = y + glyph->height;
+    bounds->empty = false;
+    return;
+  }
+
+  if (x < bounds->left) {
+    bounds->left = x;
+  }
+  if (y < bounds->top) {
+    bounds->top = y;
+  }
+  if (x + glyph->width > bounds->right) {
+    bounds->right = x + glyph->width;
+  }
+  if (y + glyph->height > bounds->bottom) {
+    bounds->bottom = y + glyph->height;
+  }
+}
+
+// Draws a single glyph in to the texture of an entry.
+// Glyphs may overlap, so their coverage is combined as blending them on screen would.
+static void textCacheRenderGlyph(const struct Font *font, const struct FontGlyph *glyph, int x, int y, void *arg) {
+  struct TextCacheEntry *entry = (struct TextCacheEntry *)arg;
+  u8 *data = entry->texture.data;
+  u32 tilesWide = entry->texture.w / 4;
+
+  u32 row, column;
+  for (row = 0; row < glyph->height; row++) {
+    u32 ty = y - entry->y + row;
+    for (column = 0; column < glyph->width; column++) {
+      u32 coverage = fontCoverage(font, glyph->x + column, glyph->y + row);
+      if (coverage == 0) {
+        continue;
+      }
+
+      // The texture is made of 4x4 tiles of 64 bytes, beginning with the alpha and red of each texel.
+      u32 tx = x - entry->x + column;
+      u8 *alpha = &data[((ty / 4) * tilesWide + tx / 4) * 64 + ((ty % 4) * 4 + tx % 4) * 2];
+      *alpha = *alpha + coverage - (*alpha * coverage) / 255;
+    }
+  }
+}
+
+// Prepares a cache drawing with the given font.
+void textCacheInit(struct TextCache *cache, const struct Font *font) {
+  memset(cache, 0, sizeof(struct TextCache));
+  cache->font = font;
+}
+
+// Renders the given text in to the given entry.
+// Returns false if its texture could not be allocated.
+static bool textCacheRender(struct TextCache *cache, struct TextCacheEntry *entry, const char *text, u32 size) {
+  entry->lastUsed = 0;
+
+  struct TextBounds bounds = {true, 0, 0, 0, 0};
+  if (!fontLayout(cache->font, text, size, textCacheMeasureGlyph, &bounds)) {
+    return false;
+  }
+  if (bounds.empty) {
+    bounds.right = bounds.left + 1;
+    bounds.bottom = bounds.top + 1;
+  }
+
+  // GX textures are made of 4x4 tiles.
+  u32 width = (bounds.right - bounds.left + 3) & ~3;
+  u32 height = (bounds.bottom - bounds.top + 3) & ~3;
+  u32 length = width * height * 4;
+  if (length > entry->capacity) {
+    free(entry->texture.data);
+    entry->texture.data = memalign(32, length);
+    entry->capacity = entry->texture.data != NULL ? length : 0;
+    if (entry->texture.data == NULL) {
+      return false;
+    }
+  }
+
+  entry->texture.w = width;
+  entry->texture.h = height;
+  entry->x = bounds.left;
+  entry->y = bounds.top;
+
+  // Every texel is white, with the text's coverage as its alpha.
+  u8 *data = entry->texture.data;
+  u32 i;
+  for (i = 0; i < length; i += 64) {
+    memset(data + i, 0xFF, 64);
+    u32 j;
+    for (j = 0; j < 32; j += 2) {
+      data[i + j] = 0;
+    }
+  }
+  fontLayout(cache->font, text, size, textCacheRenderGlyph, entry);
+
+  // The buffer may have held a previous string, which GX may still have cached.
+  GRRLIB_FlushTex(&entry->texture);
+  GX_InvalidateTexAll();
+
+  snprintf(entry->text, TEXT_CACHE_TEXT_SIZE, "%s", text);
+  entry->size = size;
+  return true;
+}
+
+// Draws the given text with the top-left of its line at the given position, as fontPrint does.
+void textCacheDraw(struct TextCache *cache, int x, int y, const char *text, u32 size, u32 color) {
+  if (strlen(text) >= TEXT_CACHE_TEXT_SIZE) {
+    fontPrint(cache->font, x, y, text, size, color);
+    return;
+  }
+
+  // Find the entry holding this text, or else the one drawn least recently.
+  struct TextCacheEntry *entry = NULL;
+  struct TextCacheEntry *oldest = &cache->entries[0];
+  u32 i;
+  for (i = 0; i < TEXT_CACHE_ENTRIES; i++) {
+    struct TextCacheEntry *candidate = &cache->entries[i];
+    if (candidate->lastUsed != 0 && candidate->size == size && strcmp(candidate->text, text) == 0) {
+      entry = candidate;
+      break;
+    }
+    if (candidate->lastUsed < oldest->lastUsed) {
+      oldest = candidate;
+    }
+  }
+
+  if (entry == NULL) {
+    entry = oldest;
+    if (!textCacheRender(cache, entry, text, size)) {
+      fontPrint(cache->font, x, y, text, size, color);
+      return;
+    }
+  }
+
+  entry->lastUsed = ++cache->uses;
+  GRRLIB_DrawImg(x + entry->x, y + entry->y, &entry->texture, 0, 1, 1, color);
+}
+
+// Releases every texture held by the given cache.
+void textCacheDestroy(struct TextCache *cache) {
+  u32 i;
+  for (i = 0; i < TEXT_CACHE_ENTRIES; i++) {
+    free(cache->entries[i].texture.data);
+  }
+  memset(cache->entries, 0, sizeof(cache->entries));
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <gccore.h>
+#include <grrlib.h>
+
+#include "font.h"
+
+// The amount of strings kept, and the longest string which may be kept.
+// Longer strings are drawn glyph by glyph instead.
+#define TEXT_CACHE_ENTRIES 8
+#define TEXT_CACHE_TEXT_SIZE 256
+
+// TextCacheEntry holds a string drawn in to a texture of its own.
+struct TextCacheEntry {
+  char text[TEXT_CACHE_TEXT_SIZE];
+  u32 size;
+
+  // The texture is drawn in white, so that any colour may be applied when it is drawn.
+  // Its buffer is kept when the entry is replaced, and only reallocated should it be too small.
+  GRRLIB_texImg texture;
+  u32 capacity;
+
+  // Where the texture lies relative to the top-left of the line.
+  int x;
+  int y;
+
+  // When the entry was last drawn, in draws made through the cache. Zero if unused.
+  u32 lastUsed;
+};
+
+// TextCache draws strings as a single quad each, rendering each in to a texture once.
+//
+// Most text on screen, such as the title and error message, remains the same for many frames.
+// Drawing it glyph by glyph loads the atlas and submits a quad for every glyph on every frame.
+// Entries are keyed by string and size. Once every entry is in use, the one drawn least recently
+// is replaced, such as the caption of the previous file during extraction.
+//
+// As the screen is rendered in full before the next frame is drawn, an entry is never replaced
+// while the GPU may still be reading it, provided no more strings are drawn per frame than are kept.
+struct TextCache {
+  const struct Font *font;
+  struct TextCacheEntry entries[TEXT_CACHE_ENTRIES];
+  u32 uses;
+};
+
+// Prepares a cache drawing with the given font.
+void textCacheInit(struct TextCache *cache, const struct Font *font);
+
+// Draws the given text with the top-left of its line at the given position, as fontPrint does.
+void textCacheDraw(struct TextCache *cache, int x, int y, const char *text, u32 size, u32 color);
+
+// Releases every texture held by the given cache.
+void textCacheDestroy(struct TextCache *cache);
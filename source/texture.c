@@ -0,0 +1,60 @@
+#include <gccore.h>
+#include <grrlib.h>
+#include <malloc.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "texture.h"
+
+// The version and format of tools/bakeimage.c's output we are able to read. See it for the format.
+#define TEXTURE_VERSION 1
+#define TEXTURE_FORMAT_RGBA8 6
+#define TEXTURE_HEADER_SIZE 32
+
+// Reads a big-endian u16.
+static u16 textureRead16(const u8 *data) {
+  return (data[0] << 8) | data[1];
+}
+
+// Loads a texture converted at build time by tools/bakeimage.c in to the given texture.
+// Returns false if the data is invalid or could not be copied.
+bool textureLoad(GRRLIB_texImg *texture, const u8 *data, u32 length) {
+  memset(texture, 0, sizeof(GRRLIB_texImg));
+  if (length < TEXTURE_HEADER_SIZE || memcmp(data, "GXTX", 4) != 0 || textureRead16(data + 4) != TEXTURE_VERSION ||
+      textureRead16(data + 6) != TEXTURE_FORMAT_RGBA8) {
+    return false;
+  }
+
+  u32 width = textureRead16(data + 8);
+  u32 height = textureRead16(data + 10);
+  u32 size = width * height * 4;
+  if (width % 4 != 0 || height % 4 != 0 || size > length - TEXTURE_HEADER_SIZE) {
+    return false;
+  }
+
+  // GX reads textures from memory, and requires them to be aligned by 32.
+  const u8 *pixels = data + TEXTURE_HEADER_SIZE;
+  if (((uintptr_t)pixels & 31) == 0) {
+    texture->data = (void *)pixels;
+  } else {
+    texture->data = memalign(32, size);
+    if (texture->data == NULL) {
+      return false;
+    }
+    memcpy(texture->data, pixels, size);
+  }
+
+  texture->w = width;
+  texture->h = height;
+  GRRLIB_FlushTex(texture);
+  return true;
+}
+
+// Releases the buffer of a texture loaded by textureLoad, should it have needed one.
+void textureDestroy(GRRLIB_texImg *texture, const u8 *data) {
+  if (texture->data != NULL && texture->data != data + TEXTURE_HEADER_SIZE) {
+    free(texture->data);
+  }
+  texture->data = NULL;
+}
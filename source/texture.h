@@ -0,0 +1,16 @@
+#pragma once
+
+#include <gccore.h>
+#include <grrlib.h>
+
+// Loads a texture converted at build time by tools/bakeimage.c in to the given texture,
+// for drawing through GRRLIB as though loaded by GRRLIB_LoadTexturePNG.
+//
+// Nothing is decoded: should the given data be aligned by 32, as the Makefile's bin2o does,
+// it is drawn from directly and must remain valid. Otherwise, it is copied in to a buffer
+// released by textureDestroy.
+// Returns false if the data is invalid or could not be copied.
+bool textureLoad(GRRLIB_texImg *texture, const u8 *data, u32 length);
+
+// Releases the buffer of a texture loaded by textureLoad, should it have needed one.
+void textureDestroy(GRRLIB_texImg *texture, const u8 *data);
@@ -0,0 +1,403 @@
+#include <gccore.h>
+#include <malloc.h>
+#include <ogc/lwp_watchdog.h>
+#include <ogc/machine/processor.h>
+#include <reent.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "main.h"
+#include "region.h"
+#include "trace.h"
+
+#if TRACE_ENABLED
+
+// A span of time spent on a single thread.
+struct TraceSpan {
+  const char *name;
+  lwp_t thread;
+  u64 start;
+  // Zero while the span remains open.
+  u64 end;
+
+  // The allocation count once begun, then the amount of allocations made until it ended.
+  u32 allocations;
+};
+
+// An entry among the slowest to pass through a stage.
+struct TraceEntry {
+  char name[TRACE_NAME_SIZE];
+  u64 ticks;
+};
+
+// A thread named via traceNameThread.
+struct TraceThread {
+  lwp_t thread;
+  const char *name;
+};
+
+// Spans, counters and entries are recorded from every thread, guarded by a single mutex.
+// Each is recorded at most a few times per entry, never per byte.
+struct Trace {
+  bool initialized;
+  mutex_t lock;
+  u64 epoch;
+
+  struct TraceSpan spans[TRACE_MAX_SPANS];
+  u32 spanCount;
+  u32 spansDropped;
+
+  struct TraceThread threads[TRACE_MAX_THREADS];
+  u32 threadCount;
+
+  u64 counters[TRACE_COUNTER_COUNT];
+  struct TraceEntry slowest[TRACE_STAGE_COUNT][TRACE_SLOWEST_ENTRIES];
+};
+static struct Trace trace;
+
+// The amount of heap allocations made since startup.
+static volatile u32 traceAllocations;
+
+// The threads within one of our wrapped allocators, by their struct _reent. newlib's
+// calloc and memalign are built on _malloc_r, so a single allocation may pass through
+// several of our wrappers on the same thread. Only the outermost is counted.
+static struct _reent *traceAllocating[TRACE_MAX_THREADS];
+
+// Counts a single heap allocation, unless the calling thread is already within one.
+// Returns the slot marking it as within one, or -1 if it already was.
+// Allocations are made from every thread, and we may be called with newlib's allocation
+// lock held, so we count with interrupts disabled instead.
+static s32 traceBeginAllocation(struct _reent *reent) {
+  u32 level;
+  _CPU_ISR_Disable(level);
+  s32 slot = -1;
+  u32 i;
+  for (i = 0; i < TRACE_MAX_THREADS; i++) {
+    if (traceAllocating[i] == reent) {
+      _CPU_ISR_Restore(level);
+      return -1;
+    }
+    if (traceAllocating[i] == NULL && slot < 0) {
+      slot = i;
+    }
+  }
+
+  // Should every slot be taken, nested allocations on this thread are counted too.
+  traceAllocations++;
+  if (slot >= 0) {
+    traceAllocating[slot] = reent;
+  }
+  _CPU_ISR_Restore(level);
+  return slot;
+}
+
+// Marks the calling thread as no longer within an allocation.
+static void traceEndAllocation(s32 slot) {
+  if (slot >= 0) {
+    traceAllocating[slot] = NULL;
+  }
+}
+
+// Returns the amount of heap allocations made since startup.
+u32 traceAllocationCount() {
+  return traceAllocations;
+}
+
+// newlib's allocators, wrapped via --wrap. Every other allocator, such as malloc or memalign,
+// is implemented on top of these.
+void *__real__malloc_r(struct _reent *reent, size_t size);
+void *__real__calloc_r(struct _reent *reent, size_t count, size_t size);
+void *__real__realloc_r(struct _reent *reent, void *pointer, size_t size);
+void *__real__memalign_r(struct _reent *reent, size_t alignment, size_t size);
+
+void *__wrap__malloc_r(struct _reent *reent, size_t size) {
+  s32 slot = traceBeginAllocation(reent);
+  void *result = __real__malloc_r(reent, size);
+  traceEndAllocation(slot);
+  return result;
+}
+
+void *__wrap__calloc_r(struct _reent *reent, size_t count, size_t size) {
+  s32 slot = traceBeginAllocation(reent);
+  void *result = __real__calloc_r(reent, count, size);
+  traceEndAllocation(slot);
+  return result;
+}
+
+void *__wrap__realloc_r(struct _reent *reent, void *pointer, size_t size) {
+  s32 slot = traceBeginAllocation(reent);
+  void *result = __real__realloc_r(reent, pointer, size);
+  traceEndAllocation(slot);
+  return result;
+}
+
+void *__wrap__memalign_r(struct _reent *reent, size_t alignment, size_t size) {
+  s32 slot = traceBeginAllocation(reent);
+  void *result = __real__memalign_r(reent, alignment, size);
+  traceEndAllocation(slot);
+  return result;
+}
+
+// The names of our counters and stages within the trace, indexed by their value.
+static const char *traceCounterNames[TRACE_COUNTER_COUNT] = {
+    "nandBytesRead", "bytesInflated", "bytesWritten", "writeCalls", "filesReused", "bytesPreallocated",
+    "entriesWritten", "entriesSkipped", "entriesResumed", "isfsCalls", "fopenCalls", "mkdirCalls", "mkdirCallsAvoided", "profileSaveFailures", "extractMicroseconds", "extractAllocations",
+    "arenaBytes", "arenaWastedBytes", "arenaReused", "arenaOverflows", "firstFrameMicroseconds", "startupMicroseconds",
+    "fadeInMicroseconds", "firstByteMicroseconds",
+};
+static const char *traceStageNames[TRACE_STAGE_COUNT] = {"inflate", "write"};
+
+// Prepares tracing, marking the start of the trace.
+void traceInit() {
+  memset(&trace, 0, sizeof(trace));
+  LWP_MutexInit(&trace.lock, false);
+  trace.epoch = gettime();
+  trace.initialized = true;
+}
+
+// Names the calling thread within the trace.
+void traceNameThread(const char *name) {
+  if (!trace.initialized) {
+    return;
+  }
+
+  lwp_t self = LWP_GetSelf();
+  LWP_MutexLock(trace.lock);
+
+  // Thread handles are reused, so a later name replaces an earlier one.
+  u32 i;
+  for (i = 0; i < trace.threadCount; i++) {
+    if (trace.threads[i].thread == self) {
+      break;
+    }
+  }
+  if (i < TRACE_MAX_THREADS) {
+    trace.threads[i].thread = self;
+    trace.threads[i].name = name;
+    if (i == trace.threadCount) {
+      trace.threadCount++;
+    }
+  }
+
+  LWP_MutexUnlock(trace.lock);
+}
+
+// Begins a span on the calling thread.
+struct TraceScope traceBegin(const char *name) {
+  struct TraceScope scope = {-1};
+  if (!trace.initialized) {
+    return scope;
+  }
+
+  lwp_t self = LWP_GetSelf();
+  LWP_MutexLock(trace.lock);
+  if (trace.spanCount < TRACE_MAX_SPANS) {
+    struct TraceSpan *span = &trace.spans[trace.spanCount];
+    span->name = name;
+    span->thread = self;
+    span->start = gettime();
+    span->end = 0;
+    span->allocations = traceAllocations;
+    scope.span = trace.spanCount++;
+  } else {
+    trace.spansDropped++;
+  }
+  LWP_MutexUnlock(trace.lock);
+  return scope;
+}
+
+// Ends the given span.
+void traceEnd(struct TraceScope *scope) {
+  if (scope->span < 0) {
+    return;
+  }
+
+  u64 now = gettime();
+  LWP_MutexLock(trace.lock);
+  struct TraceSpan *span = &trace.spans[scope->span];
+  span->end = now;
+  span->allocations = traceAllocations - span->allocations;
+  LWP_MutexUnlock(trace.lock);
+  scope->span = -1;
+}
+
+// Adds the given amount to a counter.
+void traceCount(enum TraceCounter counter, u64 amount) {
+  if (!trace.initialized) {
+    return;
+  }
+
+  LWP_MutexLock(trace.lock);
+  trace.counters[counter] += amount;
+  LWP_MutexUnlock(trace.lock);
+}
+
+// Sets a counter to the time since the start of the trace, unless already set.
+void traceMark(enum TraceCounter counter) {
+  if (!trace.initialized) {
+    return;
+  }
+
+  u64 now = gettime();
+  LWP_MutexLock(trace.lock);
+  if (trace.counters[counter] == 0) {
+    trace.counters[counter] = ticks_to_microsecs(now - trace.epoch);
+  }
+  LWP_MutexUnlock(trace.lock);
+}
+
+// Records the time an entry spent within the given stage, keeping it if among the slowest.
+void traceEntry(enum TraceStage stage, const char *name, u64 ticks) {
+  if (!trace.initialized) {
+    return;
+  }
+
+  LWP_MutexLock(trace.lock);
+
+  // Replace the fastest entry kept, should this entry be slower.
+  struct TraceEntry *entries = trace.slowest[stage];
+  struct TraceEntry *fastest = &entries[0];
+  u32 i;
+  for (i = 1; i < TRACE_SLOWEST_ENTRIES; i++) {
+    if (entries[i].ticks < fastest->ticks) {
+      fastest = &entries[i];
+    }
+  }
+  if (ticks > fastest->ticks) {
+    snprintf(fastest->name, TRACE_NAME_SIZE, "%s", name);
+    fastest->ticks = ticks;
+  }
+
+  LWP_MutexUnlock(trace.lock);
+}
+
+// Writes the given string as a JSON string.
+// Paths never contain control characters or quotes on FAT, but an archive may claim otherwise.
+static void traceWriteString(FILE *file, const char *string) {
+  fputc('"', file);
+  for (; *string != '\0'; string++) {
+    char c = *string;
+    if (c == '"' || c == '\\') {
+      fputc('\\', file);
+      fputc(c, file);
+    } else if ((u8)c >= 0x20) {
+      fputc(c, file);
+    }
+  }
+  fputc('"', file);
+}
+
+// Returns the given time in microseconds since the start of the trace.
+static unsigned long long traceMicroseconds(u64 ticks) {
+  return ticks_to_microsecs(ticks - trace.epoch);
+}
+
+// Writes the trace to the given path.
+// Tracing is merely informational, so failing to write it is not an error.
+void traceSave(const char *path) {
+  if (!trace.initialized) {
+    return;
+  }
+
+  FILE *file = fopen(path, "w");
+  if (file == NULL) {
+    return;
+  }
+
+  // Writing to the card is slow, and every other thread records while it takes place.
+  // The trace is copied under the lock, then written from the copy.
+  static struct Trace snapshot;
+  u64 now = gettime();
+  LWP_MutexLock(trace.lock);
+  memcpy(&snapshot, &trace, sizeof(struct Trace));
+  u32 allocations = traceAllocations;
+  LWP_MutexUnlock(trace.lock);
+
+  fprintf(file, "{\n  \"traceEvents\": [\n");
+  u32 i;
+  for (i = 0; i < snapshot.threadCount; i++) {
+    fprintf(file, "    {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": %u, \"args\": {\"name\": ",
+            (u32)snapshot.threads[i].thread);
+    traceWriteString(file, snapshot.threads[i].name);
+    fprintf(file, "}},\n");
+  }
+
+  for (i = 0; i < snapshot.spanCount; i++) {
+    const struct TraceSpan *span = &snapshot.spans[i];
+    u64 end = span->end != 0 ? span->end : now;
+    u32 spanAllocations = span->end != 0 ? span->allocations : allocations - span->allocations;
+    fprintf(file, "    {\"name\": ");
+    traceWriteString(file, span->name);
+    fprintf(file, ", \"ph\": \"X\", \"pid\": 0, \"tid\": %u, \"ts\": %llu, \"dur\": %llu, \"args\": {\"allocations\": %u}},\n",
+            (u32)span->thread, traceMicroseconds(span->start), (unsigned long long)ticks_to_microsecs(end - span->start), spanAllocations);
+  }
+
+  // Counters are given as a single sample at the end of the trace.
+  fprintf(file, "    {\"name\": \"counters\", \"ph\": \"C\", \"pid\": 0, \"ts\": %llu, \"args\": {", traceMicroseconds(now));
+  for (i = 0; i < TRACE_COUNTER_COUNT; i++) {
+    fprintf(file, "%s\"%s\": %llu", i > 0 ? ", " : "", traceCounterNames[i], (unsigned long long)snapshot.counters[i]);
+  }
+  fprintf(file, "}}\n  ],\n");
+
+  // Throughput is given over the time spent extracting, so that rendering and NAND cleanup
+  // do not hide a regression. The heap is as reported by malloc, with its peak being the most
+  // ever allocated at once, followed by the amount of allocations made since startup.
+  double seconds = snapshot.counters[TRACE_EXTRACT_MICROSECONDS] / 1000000.0;
+  double megabytes = snapshot.counters[TRACE_BYTES_WRITTEN] / (1024.0 * 1024.0);
+  struct mallinfo heap = mallinfo();
+  fprintf(file, "  \"summary\": {\"megabytesPerSecond\": %.2f, \"filesPerSecond\": %.1f, ",
+          seconds > 0 ? megabytes / seconds : 0, seconds > 0 ? snapshot.counters[TRACE_ENTRIES_WRITTEN] / seconds : 0);
+  fprintf(file, "\"heapInUse\": %lu, \"heapPeak\": %lu, \"heapArena\": %lu, \"allocations\": %u",
+          (unsigned long)heap.uordblks, (unsigned long)heap.usmblks, (unsigned long)heap.arena, allocations);
+
+  // Followed by the usage of each region, where fallbacks were allocated from the heap instead.
+  static const char *regionNames[REGION_COUNT] = {"mem1", "mem2"};
+  u32 region;
+  for (region = 0; region < REGION_COUNT; region++) {
+    struct RegionStats stats;
+    regionGetStats(region, &stats);
+    fprintf(file, ", \"%sBudget\": %u, \"%sPeak\": %u, \"%sFallbacks\": %u",
+            regionNames[region], stats.budget, regionNames[region], stats.peak, regionNames[region], stats.fallbacks);
+  }
+  fprintf(file, "},\n");
+
+  // The plan chosen for our buffers, and the arena sizes it was chosen from.
+  const struct RegionPlan *plan = regionGetPlan();
+  fprintf(file, "  \"memoryPlan\": {\"name\": \"%s\", \"arena1Size\": %u, \"arena2Size\": %u, ",
+          plan->name != NULL ? plan->name : "", plan->arenaSizes[REGION_MEM1], plan->arenaSizes[REGION_MEM2]);
+  fprintf(file, "\"windowSize\": %u, \"writerSize\": %u, \"ringDepth\": %u},\n", plan->windowSize, plan->writerSize, plan->ringDepth);
+
+  fprintf(file, "  \"spansDropped\": %u,\n  \"slowestEntries\": {\n", snapshot.spansDropped);
+  u32 stage;
+  for (stage = 0; stage < TRACE_STAGE_COUNT; stage++) {
+    fprintf(file, "    \"%s\": [", traceStageNames[stage]);
+
+    // Entries are kept unordered. Write them slowest first.
+    bool written[TRACE_SLOWEST_ENTRIES] = {false};
+    bool first = true;
+    while (true) {
+      const struct TraceEntry *entries = snapshot.slowest[stage];
+      s32 slowest = -1;
+      for (i = 0; i < TRACE_SLOWEST_ENTRIES; i++) {
+        if (!written[i] && entries[i].ticks > 0 && (slowest < 0 || entries[i].ticks > entries[slowest].ticks)) {
+          slowest = i;
+        }
+      }
+      if (slowest < 0) {
+        break;
+      }
+      written[slowest] = true;
+
+      fprintf(file, "%s\n      {\"path\": ", first ? "" : ",");
+      traceWriteString(file, entries[slowest].name);
+      fprintf(file, ", \"us\": %llu}", (unsigned long long)ticks_to_microsecs(entries[slowest].ticks));
+      first = false;
+    }
+    fprintf(file, "%s]%s\n", first ? "" : "\n    ", stage + 1 < TRACE_STAGE_COUNT ? "," : "");
+  }
+  fprintf(file, "  }\n}\n");
+
+  fclose(file);
+}
+
+#endif
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <gccore.h>
+#include <ogc/lwp_watchdog.h>
+
+// Tracing is compiled in unless TRACE_ENABLED is defined as 0, such as by building with TRACE=0.
+// When disabled, every TRACE_ macro compiles to nothing.
+//
+// Heap allocations are counted by wrapping newlib's allocators, which the Makefile does via
+// --wrap whenever tracing is enabled. Every span records the allocations made while it was open.
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+// The trace of the most recent launch, in the Chrome trace event format.
+// It is rewritten after each install, covering every install of the launch so far,
+// with counters and throughput totalled across them.
+// It can be opened with chrome://tracing or https://ui.perfetto.dev.
+#define TRACE_PATH OSC_DATA_PATH "/trace.json"
+
+// The amount of spans recorded. Spans beyond this are dropped.
+#define TRACE_MAX_SPANS 512
+
+// The amount of threads which may be given a name.
+#define TRACE_MAX_THREADS 8
+
+// The amount of entries kept for each stage, and the length of their names.
+#define TRACE_SLOWEST_ENTRIES 8
+#define TRACE_NAME_SIZE 128
+
+// Counters accumulated over a launch.
+enum TraceCounter {
+  TRACE_NAND_BYTES_READ,
+  TRACE_BYTES_INFLATED,
+  TRACE_BYTES_WRITTEN,
+  // write() calls made, existing files overwritten in place, and the zeroes libfat wrote
+  // growing files to their final size. See fat_writer.h.
+  TRACE_WRITE_CALLS,
+  TRACE_FILES_REUSED,
+  TRACE_BYTES_PREALLOCATED,
+  TRACE_ENTRIES_WRITTEN,
+  TRACE_ENTRIES_SKIPPED,
+  // Entries recorded as finished by a previous launch. See journal.h.
+  TRACE_ENTRIES_RESUMED,
+  TRACE_ISFS_CALLS,
+  TRACE_FOPEN_CALLS,
+  TRACE_MKDIR_CALLS,
+  // mkdir calls not made, as each directory is only created once. See dir_cache.h.
+  TRACE_MKDIR_CALLS_AVOIDED,
+  // Storage profiles probed but not remembered, so that the device will be probed again. See storage.h.
+  TRACE_PROFILE_SAVE_FAILURES,
+  // Time spent extracting, from which throughput is derived.
+  TRACE_EXTRACT_MICROSECONDS,
+  // Heap allocations made during extraction, from every thread.
+  TRACE_EXTRACT_ALLOCATIONS,
+  // The peak usage of every package's arena, the space wasted within them, the allocations
+  // served from their pools, and the allocations which did not fit. See arena.h.
+  TRACE_ARENA_BYTES,
+  TRACE_ARENA_WASTED_BYTES,
+  TRACE_ARENA_REUSED,
+  TRACE_ARENA_OVERFLOWS,
+  // Marks of when startup reached a milestone, in microseconds since the start of the trace.
+  // Startup runs while the fade-in plays, so it should finish close to when the fade-in does.
+  // See traceMark.
+  TRACE_FIRST_FRAME_MICROSECONDS,
+  TRACE_STARTUP_MICROSECONDS,
+  TRACE_FADE_IN_MICROSECONDS,
+  TRACE_FIRST_BYTE_MICROSECONDS,
+  TRACE_COUNTER_COUNT
+};
+
+// Stages for which the slowest entries are kept.
+enum TraceStage {
+  TRACE_STAGE_INFLATE,
+  TRACE_STAGE_WRITE,
+  TRACE_STAGE_COUNT
+};
+
+// TraceScope refers to a span begun by traceBegin.
+struct TraceScope {
+  s32 span;
+};
+
+// TraceTimer accumulates time spent on a single entry across several calls.
+struct TraceTimer {
+  u64 start;
+  u64 ticks;
+};
+
+#if TRACE_ENABLED
+
+// Prepares tracing, marking the start of the trace. Must be called before any other thread starts.
+void traceInit();
+
+// Names the calling thread within the trace.
+void traceNameThread(const char *name);
+
+// Begins a span on the calling thread. The given name must remain valid, such as a string literal.
+struct TraceScope traceBegin(const char *name);
+
+// Ends the given span.
+void traceEnd(struct TraceScope *scope);
+
+// Adds the given amount to a counter.
+void traceCount(enum TraceCounter counter, u64 amount);
+
+// Sets a counter to the time since the start of the trace, unless already set.
+void traceMark(enum TraceCounter counter);
+
+// Records the time an entry spent within the given stage, keeping it if among the slowest.
+void traceEntry(enum TraceStage stage, const char *name, u64 ticks);
+
+// Writes the trace to the given path. Spans still open are written as ending now.
+void traceSave(const char *path);
+
+// Returns the amount of heap allocations made since startup.
+u32 traceAllocationCount();
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+// Times the remainder of the enclosing block.
+#define TRACE_SCOPE(name) \
+  struct TraceScope TRACE_CONCAT(traceScope, __LINE__) __attribute__((cleanup(traceEnd))) = traceBegin(name)
+
+// Times the code between TRACE_BEGIN and TRACE_END, where a block is inconvenient.
+#define TRACE_BEGIN(scope, name) struct TraceScope scope = traceBegin(name)
+#define TRACE_END(scope) traceEnd(&(scope))
+
+#define TRACE_INIT() traceInit()
+#define TRACE_THREAD(name) traceNameThread(name)
+#define TRACE_COUNT(counter, amount) traceCount(counter, amount)
+#define TRACE_MARK(counter) traceMark(counter)
+#define TRACE_SAVE(path) traceSave(path)
+
+#define TRACE_TIMER_RESET(timer) ((timer).ticks = 0)
+#define TRACE_TIMER_START(timer) ((timer).start = gettime())
+#define TRACE_TIMER_STOP(timer) ((timer).ticks += gettime() - (timer).start)
+#define TRACE_ENTRY(stage, name, timer) traceEntry(stage, name, (timer).ticks)
+
+#else
+
+#define TRACE_SCOPE(name) do {} while (0)
+#define TRACE_BEGIN(scope, name) do {} while (0)
+#define TRACE_END(scope) do {} while (0)
+
+#define TRACE_INIT() do {} while (0)
+#define TRACE_THREAD(name) do {} while (0)
+#define TRACE_COUNT(counter, amount) do {} while (0)
+#define TRACE_MARK(counter) do {} while (0)
+#define TRACE_SAVE(path) do {} while (0)
+
+#define TRACE_TIMER_RESET(timer) do {} while (0)
+#define TRACE_TIMER_START(timer) do {} while (0)
+#define TRACE_TIMER_STOP(timer) do {} while (0)
+#define TRACE_ENTRY(stage, name, timer) do {} while (0)
+
+#endif
@@ -5,15 +5,19 @@
 #include <stdlib.h>
 
 #include "main.h"
+#include "trace.h"
 
 // Reads a file at the given path, returning the size.
 // Upon failure, the returned buffer will be NULL,
 // and errorMessage/errorCode will be updated appropiately.
 void *ISFS_GetFile(const char *path, u32 *size) {
+  TRACE_SCOPE("ISFS_GetFile");
+
 	// Default to having the size as zero in case we fail.
   *size = 0;
 
 	// Attempt to open a handle to our file.
+  TRACE_COUNT(TRACE_ISFS_CALLS, 1);
   s32 fd = ISFS_Open(path, ISFS_OPEN_READ);
   if (fd < 0) {
 		sprintf(errorMessage, "Could not open file (%d).", fd);
@@ -25,6 +29,7 @@ void *ISFS_GetFile(const char *path, u32 *size) {
 	static fstats stats ATTRIBUTE_ALIGN(32);
   memset(&stats, 0, sizeof(fstats));
 
+  TRACE_COUNT(TRACE_ISFS_CALLS, 1);
   s32 ret = ISFS_GetFileStats(fd, &stats);
 	if (ret < 0) {
 		sprintf(errorMessage, "Could not retrieve file stats (%d).", ret);
@@ -55,10 +60,12 @@ void *ISFS_GetFile(const char *path, u32 *size) {
 	}
 
 	// Attempt to read this file.
+	TRACE_COUNT(TRACE_ISFS_CALLS, 1);
 	s32 tmp_size = ISFS_Read(fd, buf, length);
 	if (tmp_size == length) {
 		// We were successful reading!.
     *size = tmp_size;
+		TRACE_COUNT(TRACE_NAND_BYTES_READ, tmp_size);
 	} else {
 		if (tmp_size >= 0) {
 			// If we have a positive file that does not match, the file could not be fully read.
@@ -76,6 +83,7 @@ void *ISFS_GetFile(const char *path, u32 *size) {
 	}
 
 	// Cleanup
+  TRACE_COUNT(TRACE_ISFS_CALLS, 1);
   ISFS_Close(fd);
   return buf;
 }
@@ -84,6 +92,7 @@ void *ISFS_GetFile(const char *path, u32 *size) {
 // Returns false on failure, updating errorMessage/errorCode appropiately.
 bool ISFS_WriteFile(const char *path, void* fileContents, int contentsLength) {
 	// Attempt to open a handle to our file.
+  TRACE_COUNT(TRACE_ISFS_CALLS, 1);
   s32 fd = ISFS_Open(path, ISFS_OPEN_WRITE);
   if (fd < 0) {
 		sprintf(errorMessage, "Could not open file (%d).", fd);
@@ -91,6 +100,7 @@ bool ISFS_WriteFile(const char *path, void* fileContents, int contentsLength) {
 		return false;
   }
 
+	TRACE_COUNT(TRACE_ISFS_CALLS, 1);
 	s32 ret = ISFS_Write(fd, fileContents, contentsLength);
 	if (ret < 0) {
 		sprintf(errorMessage, "Could not write file (%d).", ret);
@@ -98,6 +108,7 @@ bool ISFS_WriteFile(const char *path, void* fileContents, int contentsLength) {
 		return false;
 	}
 
+	TRACE_COUNT(TRACE_ISFS_CALLS, 1);
 	ISFS_Close(fd);
 	return true;
 }
@@ -111,6 +122,7 @@ bool RecreateFile(const char *path) {
 	u16 groupId = 0;
 	u8 attributes, ownerperm, groupperm, otherperm = 0;
 
+	TRACE_COUNT(TRACE_ISFS_CALLS, 1);
 	s32 ret = ISFS_GetAttr(path, &ownerId, &groupId, &attributes, &ownerperm, &groupperm, &otherperm);
 	if (ret < 0) {
 		sprintf(errorMessage, "Could not obtain file permissions (%d).", ret);
@@ -119,6 +131,7 @@ bool RecreateFile(const char *path) {
 	}
 
 	// Delete the original file.
+	TRACE_COUNT(TRACE_ISFS_CALLS, 1);
 	ret = ISFS_Delete(path);
 	if (ret < 0) {
 		sprintf(errorMessage, "Could not delete file (%d).", ret);
@@ -127,6 +140,7 @@ bool RecreateFile(const char *path) {
 	}
 
 	// Recreate.
+	TRACE_COUNT(TRACE_ISFS_CALLS, 1);
 	ret = ISFS_CreateFile(path, attributes, ownerperm, groupperm, otherperm);
 	if (ret < 0) {
 		sprintf(errorMessage, "Could not create file (%d).", ret);
@@ -135,6 +149,7 @@ bool RecreateFile(const char *path) {
 	}
 
 	// Restore previous attributes.
+	TRACE_COUNT(TRACE_ISFS_CALLS, 1);
 	ret = ISFS_SetAttr(path, ownerId, groupId, attributes, ownerperm, groupperm, otherperm);
 	if (ret < 0) {
 		sprintf(errorMessage, "Could not set attributes (%d).", ret);
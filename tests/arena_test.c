@@ -0,0 +1,309 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "miniz.h"
+
+// Replays traces of allocations against an arena, checking that every allocation keeps its
+// contents, lies within the region or the heap, and never overlaps another.
+//
+// The traces are recorded from miniz opening each corpus written by gencorpus, with the arena
+// sized as packageArenaSize() in package.c sizes it, where nothing may overflow to the heap.
+// A random trace of small and large allocations follows, in an arena too small to hold it,
+// where freed allocations must be reused from the pool.
+//
+// Usage: arena_test [corpus directory] [corpus...]
+
+#define ARENA_TEST_PATH_SIZE 1024
+#define ARENA_TEST_MAX_OPS 65536
+#define ARENA_TEST_MAX_LIVE 4096
+#define ARENA_TEST_RANDOM_OPS 50000
+
+// As PACKAGE_ARENA_SLACK in package.c.
+#define ARENA_TEST_SLACK 1024
+
+enum ArenaTestOpKind {
+  ARENA_TEST_ALLOC,
+  ARENA_TEST_REALLOC,
+  ARENA_TEST_FREE,
+};
+
+// A single call, on the allocation with the given ID.
+struct ArenaTestOp {
+  enum ArenaTestOpKind kind;
+  u32 id;
+  u32 size;
+};
+
+struct ArenaTestTrace {
+  struct ArenaTestOp ops[ARENA_TEST_MAX_OPS];
+  u32 count;
+
+  // The allocations live while recording, by ID.
+  void *live[ARENA_TEST_MAX_LIVE];
+  u32 ids;
+};
+
+static int arenaTestFailures;
+
+static void arenaTestFail(const char *what, u32 op) {
+  if (arenaTestFailures < 10) {
+    printf("  FAIL: %s at op %u\n", what, op);
+  }
+  arenaTestFailures++;
+}
+
+static void arenaTestRecord(struct ArenaTestTrace *trace, enum ArenaTestOpKind kind, u32 id, u32 size) {
+  if (trace->count < ARENA_TEST_MAX_OPS) {
+    trace->ops[trace->count++] = (struct ArenaTestOp){kind, id, size};
+  }
+}
+
+static s32 arenaTestFind(struct ArenaTestTrace *trace, void *pointer) {
+  u32 id;
+  for (id = 0; id < trace->ids; id++) {
+    if (trace->live[id] == pointer) {
+      return id;
+    }
+  }
+  return -1;
+}
+
+// miniz's allocation hooks, recording every call into the trace given as opaque.
+static void *arenaTestAlloc(void *opaque, size_t items, size_t size) {
+  struct ArenaTestTrace *trace = opaque;
+  void *pointer = malloc(items * size);
+  if (pointer != NULL && trace->ids < ARENA_TEST_MAX_LIVE) {
+    trace->live[trace->ids] = pointer;
+    arenaTestRecord(trace, ARENA_TEST_ALLOC, trace->ids++, items * size);
+  }
+  return pointer;
+}
+
+static void arenaTestFree(void *opaque, void *address) {
+  struct ArenaTestTrace *trace = opaque;
+  s32 id = arenaTestFind(trace, address);
+  if (id >= 0) {
+    trace->live[id] = NULL;
+    arenaTestRecord(trace, ARENA_TEST_FREE, id, 0);
+  }
+  free(address);
+}
+
+static void *arenaTestRealloc(void *opaque, void *address, size_t items, size_t size) {
+  struct ArenaTestTrace *trace = opaque;
+  if (address == NULL) {
+    return arenaTestAlloc(opaque, items, size);
+  }
+  s32 id = arenaTestFind(trace, address);
+  void *pointer = realloc(address, items * size);
+  if (pointer != NULL && id >= 0) {
+    trace->live[id] = pointer;
+    arenaTestRecord(trace, ARENA_TEST_REALLOC, id, items * size);
+  }
+  return pointer;
+}
+
+// Fills an allocation with a pattern identifying it.
+static void arenaTestFill(u8 *data, u32 id, u32 from, u32 to) {
+  u32 i;
+  for (i = from; i < to; i++) {
+    data[i] = (u8)(id * 31 + i);
+  }
+}
+
+static bool arenaTestCheck(const u8 *data, u32 id, u32 length) {
+  u32 i;
+  for (i = 0; i < length; i++) {
+    if (data[i] != (u8)(id * 31 + i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool arenaTestInRegion(const struct Arena *arena, const u8 *data, u32 size) {
+  return arena->region != NULL && data >= arena->region && data + size <= arena->region + arena->capacity;
+}
+
+// Replays the given trace against an arena of the given capacity, checking every allocation.
+static void arenaTestReplay(const struct ArenaTestTrace *trace, struct Arena *arena, u32 capacity) {
+  static u8 *live[ARENA_TEST_MAX_LIVE];
+  static u32 sizes[ARENA_TEST_MAX_LIVE];
+  memset(live, 0, sizeof(live));
+  if (!arenaInit(arena, capacity)) {
+    arenaTestFail("arenaInit", 0);
+    return;
+  }
+
+  u32 i;
+  for (i = 0; i < trace->count; i++) {
+    const struct ArenaTestOp *op = &trace->ops[i];
+    u8 *data = live[op->id];
+    if (op->kind != ARENA_TEST_ALLOC && (data == NULL || !arenaTestCheck(data, op->id, sizes[op->id]))) {
+      arenaTestFail("contents lost", i);
+    }
+
+    if (op->kind == ARENA_TEST_FREE) {
+      arenaFree(arena, data);
+      live[op->id] = NULL;
+      continue;
+    }
+
+    u8 *result = op->kind == ARENA_TEST_ALLOC ? arenaAlloc(arena, op->size) : arenaRealloc(arena, data, op->size);
+    if (result == NULL) {
+      arenaTestFail("allocation failed", i);
+      continue;
+    }
+    if ((uintptr_t)result % ARENA_ALIGNMENT != 0) {
+      arenaTestFail("misaligned", i);
+    }
+    u32 kept = op->kind == ARENA_TEST_ALLOC ? 0 : (sizes[op->id] < op->size ? sizes[op->id] : op->size);
+    if (!arenaTestCheck(result, op->id, kept)) {
+      arenaTestFail("contents not moved", i);
+    }
+    live[op->id] = result;
+    sizes[op->id] = op->size;
+    arenaTestFill(result, op->id, kept, op->size);
+
+    // Allocations within the region must not overlap any other still live.
+    if (arenaTestInRegion(arena, result, op->size)) {
+      u32 other;
+      for (other = 0; other < ARENA_TEST_MAX_LIVE; other++) {
+        if (other != op->id && live[other] != NULL && live[other] < result + op->size &&
+            result < live[other] + sizes[other]) {
+          arenaTestFail("overlap", i);
+          break;
+        }
+      }
+    } else if (arena->region != NULL && result >= arena->region && result < arena->region + arena->capacity) {
+      arenaTestFail("past the region", i);
+    }
+  }
+
+  // Whatever the trace left live must be intact. Allocations within the region are
+  // released with it, while those from the heap are freed now.
+  for (i = 0; i < ARENA_TEST_MAX_LIVE; i++) {
+    if (live[i] != NULL) {
+      if (!arenaTestCheck(live[i], i, sizes[i])) {
+        arenaTestFail("contents lost at the end", trace->count);
+      }
+      if (!arenaTestInRegion(arena, live[i], sizes[i])) {
+        arenaFree(arena, live[i]);
+      }
+    }
+  }
+  if (arena->peak > arena->capacity) {
+    arenaTestFail("peak beyond the region", trace->count);
+  }
+}
+
+static struct ArenaTestTrace arenaTestTrace;
+
+// Records miniz opening the given archive and reading every entry's stat, then replays it.
+static void arenaTestCorpus(const char *directory, const char *corpus) {
+  char path[ARENA_TEST_PATH_SIZE];
+  snprintf(path, sizeof(path), "%s/%s.zip", directory, corpus);
+
+  struct ArenaTestTrace *trace = &arenaTestTrace;
+  memset(trace, 0, sizeof(*trace));
+  mz_zip_archive zip;
+  memset(&zip, 0, sizeof(zip));
+  zip.m_pAlloc = arenaTestAlloc;
+  zip.m_pFree = arenaTestFree;
+  zip.m_pRealloc = arenaTestRealloc;
+  zip.m_pAlloc_opaque = trace;
+  if (!mz_zip_reader_init_file(&zip, path, 0)) {
+    printf("  could not open %s\n", path);
+    arenaTestFailures++;
+    return;
+  }
+  u32 entries = mz_zip_reader_get_num_files(&zip);
+  u32 capacity = mz_zip_get_central_dir_size(&zip) + entries * 2 * sizeof(mz_uint32) + ARENA_TEST_SLACK;
+  u32 i;
+  for (i = 0; i < entries; i++) {
+    mz_zip_archive_file_stat stat;
+    mz_zip_reader_file_stat(&zip, i, &stat);
+  }
+
+  // A package's arena is released in one step once closed, so the frees made by
+  // mz_zip_reader_end are left out, as are the arena's statistics over them.
+  u32 opened = trace->count;
+  mz_zip_reader_end(&zip);
+  trace->count = opened;
+
+  struct Arena arena;
+  int failures = arenaTestFailures;
+  arenaTestReplay(trace, &arena, capacity);
+  if (arena.overflows > 0) {
+    arenaTestFail("overflowed a region sized as by package.c", trace->count);
+  }
+  printf("  %-8s %5u calls, %8u of %8u bytes at peak, %6u wasted, %u reused, %u overflows%s\n", corpus,
+         trace->count, arena.peak, capacity, arena.wasted, arena.reused, arena.overflows,
+         arenaTestFailures > failures ? ", FAIL" : "");
+  arenaDestroy(&arena);
+}
+
+static u64 arenaTestState = 0x4152454E;
+
+static u32 arenaTestRandom() {
+  arenaTestState ^= arenaTestState << 13;
+  arenaTestState ^= arenaTestState >> 7;
+  arenaTestState ^= arenaTestState << 17;
+  return (u32)(arenaTestState >> 16);
+}
+
+// A random trace, mostly of allocations small enough for the pool.
+static void arenaTestRandomTrace() {
+  struct ArenaTestTrace *trace = &arenaTestTrace;
+  memset(trace, 0, sizeof(*trace));
+  static bool live[ARENA_TEST_MAX_LIVE];
+  memset(live, 0, sizeof(live));
+
+  u32 i;
+  for (i = 0; i < ARENA_TEST_RANDOM_OPS; i++) {
+    u32 id = arenaTestRandom() % ARENA_TEST_MAX_LIVE;
+    u32 size = arenaTestRandom() % 8 == 0 ? arenaTestRandom() % 16384 : arenaTestRandom() % (ARENA_POOL_MAX_SIZE + 64);
+    if (!live[id]) {
+      arenaTestRecord(trace, ARENA_TEST_ALLOC, id, size);
+      live[id] = true;
+    } else if (arenaTestRandom() % 3 == 0) {
+      arenaTestRecord(trace, ARENA_TEST_REALLOC, id, size);
+    } else {
+      arenaTestRecord(trace, ARENA_TEST_FREE, id, 0);
+      live[id] = false;
+    }
+  }
+
+  struct Arena arena;
+  int failures = arenaTestFailures;
+  arenaTestReplay(trace, &arena, 1024 * 1024);
+  if (arena.reused == 0 || arena.overflows == 0) {
+    arenaTestFail("the pool or the heap went unused", trace->count);
+  }
+  printf("  %-8s %5u calls, %8u of %8u bytes at peak, %6u wasted, %u reused, %u overflows%s\n", "random",
+         trace->count, arena.peak, arena.capacity, arena.wasted, arena.reused, arena.overflows,
+         arenaTestFailures > failures ? ", FAIL" : "");
+  arenaDestroy(&arena);
+}
+
+int main(int argc, char **argv) {
+  const char *directory = argc > 1 ? argv[1] : "build/corpus";
+  if (argc > 2) {
+    int i;
+    for (i = 2; i < argc; i++) {
+      arenaTestCorpus(directory, argv[i]);
+    }
+  } else {
+    arenaTestCorpus(directory, "deep");
+    arenaTestCorpus(directory, "app");
+  }
+  arenaTestRandomTrace();
+
+  if (arenaTestFailures > 0) {
+    printf("  %d failures\n", arenaTestFailures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,392 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "host/host.h"
+#include "ec_cfg.h"
+#include "main.h"
+#include "miniz.h"
+#include "region.h"
+#include "storage.h"
+#include "trace.h"
+
+// Runs the downloader end to end on the host, installing each given corpus written by gencorpus.
+//
+// Every run takes place in a fresh process with fresh NAND and storage directories, as a
+// launch of the downloader would. It runs the downloader's main() until it relaunches
+// the shop channel, and the installed files are then checked against the package.
+//
+// For each run, throughput is as reported by the trace, followed by what was written to storage,
+// including the zeroes libfat would write growing files when built with PREALLOCATE=1. The
+// peak heap and the amount of allocations are as seen by host/alloc.c. The trace's own count of allocations follows,
+// then the allocations it saw during extraction per entry written, and the write() calls made by
+// the FAT writer. The peak use of MEM1 and MEM2 within their budgets follows, along with the
+// allocations which fell back to the heap. The median of every run is given per corpus.
+//
+// bench_heap is built with PLACEMENT=1, leaving every buffer to the heap, so that running both
+// compares the placements. See source/region.h.
+//
+// With -b, each run is followed by a baseline extracting the same corpus as the downloader once
+// did, an entry at a time with mz_zip_reader_extract_to_file, with its throughput and write()
+// calls given alongside. Its write() calls are counted by the kernel, so they depend on the
+// buffer given by the host's stdio rather than newlib's.
+//
+// Usage: bench [-r runs] [-p] [-b] <corpus directory> <corpus...>
+//   -r  The amount of runs per corpus. Defaults to 5.
+//   -p  Leave storage unprofiled, so that the first launch probes it. See source/storage.h.
+//   -b  Also extract each corpus through mz_zip_reader_extract_to_file.
+
+#define BENCH_PATH_SIZE 1024
+#define BENCH_MAX_RUNS 64
+#define BENCH_URL_SIZE 256
+
+// The title each corpus is installed as.
+#define BENCH_TITLE_ID 0x000100014F534331ULL
+
+// The size of a TMD with a single content.
+#define BENCH_TMD_SIZE 520
+
+struct BenchResult {
+  char url[BENCH_URL_SIZE];
+  double megabytesPerSecond;
+  double filesPerSecond;
+  u64 extractMicroseconds;
+  double megabytesWritten;
+  u64 traceAllocations;
+  double allocationsPerEntry;
+  u64 writeCalls;
+  u32 regionPeaks[REGION_COUNT];
+  u32 regionFallbacks;
+  struct HostHeapStats heap;
+  u32 bad;
+
+  // Extracting through mz_zip_reader_extract_to_file, should the baseline be run.
+  double baselineMegabytesPerSecond;
+  u64 baselineWriteCalls;
+};
+
+// Where the child reports its heap usage once it relaunches.
+static int benchPipe = -1;
+
+// Called by the child in place of relaunching the shop channel.
+void hostLaunch(const char *url) {
+  struct BenchResult result;
+  memset(&result, 0, sizeof(result));
+  snprintf(result.url, sizeof(result.url), "%s", url);
+  hostGetHeapStats(&result.heap);
+  if (write(benchPipe, &result, sizeof(result)) != sizeof(result)) {
+    _exit(1);
+  }
+  _exit(0);
+}
+
+// Returns the number following the given key within the given JSON, or 0 if it is not present.
+static double benchJsonNumber(const char *json, const char *key) {
+  char quoted[64];
+  snprintf(quoted, sizeof(quoted), "\"%s\": ", key);
+  const char *position = strstr(json, quoted);
+  return position != NULL ? strtod(position + strlen(quoted), NULL) : 0;
+}
+
+// Reads the trace of the run from beneath the given storage directory.
+static void benchReadTrace(const char *fat, struct BenchResult *result) {
+  char path[BENCH_PATH_SIZE];
+  snprintf(path, sizeof(path), "%s%s", fat, TRACE_PATH + strlen("fat:"));
+  FILE *file = fopen(path, "r");
+  if (file == NULL) {
+    return;
+  }
+  fseek(file, 0, SEEK_END);
+  long length = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  char *json = calloc(1, length + 1);
+  if (json != NULL && fread(json, 1, length, file) == (size_t)length) {
+    // Spans have allocation counts of their own, preceding the summary.
+    const char *summary = strstr(json, "\"summary\"");
+    result->extractMicroseconds = benchJsonNumber(json, "extractMicroseconds");
+    result->megabytesWritten =
+        (benchJsonNumber(json, "bytesWritten") + benchJsonNumber(json, "bytesPreallocated")) / (1024 * 1024);
+    double entries = benchJsonNumber(json, "entriesWritten");
+    result->allocationsPerEntry = entries > 0 ? benchJsonNumber(json, "extractAllocations") / entries : 0;
+    result->writeCalls = benchJsonNumber(json, "writeCalls");
+    if (summary != NULL) {
+      result->megabytesPerSecond = benchJsonNumber(summary, "megabytesPerSecond");
+      result->filesPerSecond = benchJsonNumber(summary, "filesPerSecond");
+      result->traceAllocations = benchJsonNumber(summary, "allocations");
+      result->regionPeaks[REGION_MEM1] = benchJsonNumber(summary, "mem1Peak");
+      result->regionPeaks[REGION_MEM2] = benchJsonNumber(summary, "mem2Peak");
+      result->regionFallbacks = benchJsonNumber(summary, "mem1Fallbacks") + benchJsonNumber(summary, "mem2Fallbacks");
+    }
+  }
+  free(json);
+  fclose(file);
+}
+
+// Lays out NAND as the shop channel leaves it once the given package has been downloaded.
+static bool benchPrepareNand(const char *nand, const char *package) {
+  char path[BENCH_PATH_SIZE];
+  snprintf(path, sizeof(path), "%s/title/%08x/%08x/content/00000000.app", nand, TITLE_UPPER(BENCH_TITLE_ID),
+           TITLE_LOWER(BENCH_TITLE_ID));
+  if (!hostCopyFile(package, path)) {
+    return false;
+  }
+
+  static u8 tmd[BENCH_TMD_SIZE];
+  snprintf(path, sizeof(path), "%s/title/%08x/%08x/content/title.tmd", nand, TITLE_UPPER(BENCH_TITLE_ID),
+           TITLE_LOWER(BENCH_TITLE_ID));
+  if (!hostWriteFile(path, tmd, sizeof(tmd))) {
+    return false;
+  }
+
+  // osc.cfg holds null-terminated keys, each followed by its null-terminated value prefixed by "=".
+  char config[64];
+  int length = snprintf(config, sizeof(config), "titleId%c=%016llx", '\0', (unsigned long long)BENCH_TITLE_ID);
+  snprintf(path, sizeof(path), "%s%s", nand, EC_CFG_PATH);
+  return hostWriteFile(path, config, length + 1);
+}
+
+// Saves the default profile for storage, so that it is not probed. See source/storage.h.
+static bool benchPrepareStorage(const char *fat) {
+  char path[BENCH_PATH_SIZE];
+  char profile[64];
+  int length = snprintf(profile, sizeof(profile), "%u %u %u\n", STORAGE_DEFAULT_CACHE_PAGES,
+                        STORAGE_DEFAULT_SECTORS_PER_PAGE, 0);
+  snprintf(path, sizeof(path), "%s%s", fat, STORAGE_PROFILE_PATH + strlen("fat:"));
+  return hostWriteFile(path, profile, length);
+}
+
+// Installs the given package once, within a child process.
+static bool benchRun(const char *work, const char *package, bool probe, struct BenchResult *result) {
+  char nand[BENCH_PATH_SIZE];
+  char fat[BENCH_PATH_SIZE];
+  snprintf(nand, sizeof(nand), "%s/nand", work);
+  snprintf(fat, sizeof(fat), "%s/fat", work);
+  if (!hostRemoveTree(nand) || !hostRemoveTree(fat) || !benchPrepareNand(nand, package) || !hostMakeDirs(fat) ||
+      (!probe && !benchPrepareStorage(fat))) {
+    fprintf(stderr, "Could not prepare %s\n", work);
+    return false;
+  }
+
+  int fds[2];
+  if (pipe(fds) < 0) {
+    return false;
+  }
+  // The child executes us anew, so that nothing allocated here is counted by its trace.
+  fflush(stdout);
+  pid_t child = fork();
+  if (child == 0) {
+    close(fds[0]);
+    char pipeArg[16];
+    snprintf(pipeArg, sizeof(pipeArg), "%d", fds[1]);
+    execl("/proc/self/exe", "bench", "-l", pipeArg, nand, fat, (char *)NULL);
+    _exit(1);
+  }
+  close(fds[1]);
+
+  memset(result, 0, sizeof(struct BenchResult));
+  ssize_t length = read(fds[0], result, sizeof(struct BenchResult));
+  close(fds[0]);
+  int status = 0;
+  waitpid(child, &status, 0);
+  if (length != sizeof(struct BenchResult) || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    fprintf(stderr, "The downloader exited without relaunching\n");
+    return false;
+  }
+
+  benchReadTrace(fat, result);
+  result->bad = hostVerifyExtraction(package, fat);
+  return strcmp(result->url, "/error?error=SUCCESS") == 0 && result->bad == 0;
+}
+
+// Returns the amount of write() calls made by this process so far, or 0 if unknown.
+static u64 benchWriteSyscalls() {
+  FILE *file = fopen("/proc/self/io", "r");
+  if (file == NULL) {
+    return 0;
+  }
+  char line[128];
+  unsigned long long calls = 0;
+  while (fgets(line, sizeof(line), file) != NULL) {
+    if (sscanf(line, "syscw: %llu", &calls) == 1) {
+      break;
+    }
+  }
+  fclose(file);
+  return calls;
+}
+
+// Creates the parent directories of the given path, as extracting a file requires.
+static bool benchMakeParents(char *path) {
+  char *separator;
+  for (separator = strchr(path + 1, '/'); separator != NULL; separator = strchr(separator + 1, '/')) {
+    *separator = '\0';
+    bool made = mkdir(path, 0777) == 0 || errno == EEXIST;
+    *separator = '/';
+    if (!made) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Extracts the given package beneath fresh storage an entry at a time, as the downloader once did.
+// Directory entries are created as they are met, and the parents of every entry before it,
+// so that archives without directory entries, or beneath a fresh "apps", may be extracted too.
+static bool benchBaseline(const char *work, const char *package, struct BenchResult *result) {
+  char fat[BENCH_PATH_SIZE];
+  snprintf(fat, sizeof(fat), "%s/baseline", work);
+  mz_zip_archive zip;
+  memset(&zip, 0, sizeof(zip));
+  if (!hostRemoveTree(fat) || !hostMakeDirs(fat) || !mz_zip_reader_init_file(&zip, package, 0)) {
+    fprintf(stderr, "Could not prepare %s\n", fat);
+    return false;
+  }
+
+  u64 bytes = 0;
+  bool success = true;
+  fflush(stdout);
+  u64 writeCalls = benchWriteSyscalls();
+  double start = hostSeconds();
+  mz_uint i;
+  for (i = 0; i < mz_zip_reader_get_num_files(&zip) && success; i++) {
+    mz_zip_archive_file_stat stat;
+    char path[BENCH_PATH_SIZE];
+    success = mz_zip_reader_file_stat(&zip, i, &stat);
+    snprintf(path, sizeof(path), "%s/%s", fat, stat.m_filename);
+    if (success && stat.m_is_directory) {
+      success = benchMakeParents(path) && (mkdir(path, 0777) == 0 || errno == EEXIST);
+    } else if (success) {
+      success = benchMakeParents(path) && mz_zip_reader_extract_to_file(&zip, i, path, 0);
+      bytes += stat.m_uncomp_size;
+    }
+  }
+  double seconds = hostSeconds() - start;
+  result->baselineWriteCalls = benchWriteSyscalls() - writeCalls;
+  result->baselineMegabytesPerSecond = seconds > 0 ? bytes / (1024.0 * 1024.0) / seconds : 0;
+  mz_zip_reader_end(&zip);
+
+  if (!success) {
+    printf("baseline could not extract %s\n", package);
+    return false;
+  }
+  return hostVerifyExtraction(package, fat) == 0;
+}
+
+static int benchCompareDoubles(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return x < y ? -1 : x > y;
+}
+
+// Returns the median of the given values, reordering them.
+static double benchMedian(double *values, u32 count) {
+  qsort(values, count, sizeof(double), benchCompareDoubles);
+  return count % 2 == 1 ? values[count / 2] : (values[count / 2 - 1] + values[count / 2]) / 2;
+}
+
+// Launches the downloader with the given NAND and storage directories, reporting to the given pipe.
+static int benchLaunch(const char *pipeArg, const char *nand, const char *fat) {
+  benchPipe = strtol(pipeArg, NULL, 10);
+  hostSetRoots(nand, fat);
+  hostResetHeapStats();
+  char *argv[] = {"boot.dol", NULL};
+  return downloaderMain(1, argv);
+}
+
+int main(int argc, char **argv) {
+  if (argc == 5 && strcmp(argv[1], "-l") == 0) {
+    return benchLaunch(argv[2], argv[3], argv[4]);
+  }
+
+  u32 runs = 5;
+  bool probe = false;
+  bool baseline = false;
+  int option;
+  while ((option = getopt(argc, argv, "r:pb")) != -1) {
+    if (option == 'r') {
+      runs = strtoul(optarg, NULL, 10);
+    } else if (option == 'p') {
+      probe = true;
+    } else if (option == 'b') {
+      baseline = true;
+    } else {
+      return 2;
+    }
+  }
+  if (optind + 2 > argc || runs == 0 || runs > BENCH_MAX_RUNS) {
+    fprintf(stderr, "Usage: %s [-r runs] [-p] [-b] <corpus directory> <corpus...>\n", argv[0]);
+    return 2;
+  }
+
+  char work[BENCH_PATH_SIZE];
+  snprintf(work, sizeof(work), "%s/run", argv[optind]);
+
+  bool success = true;
+  printf("%-8s %4s %10s %10s %10s %10s %12s %12s %12s %10s %10s", "corpus", "run", "MB/s", "files/s", "extract ms",
+         "written MB", "peak heap", "allocations", "traced", "per entry", "writes");
+  printf(" %10s %10s %10s", "MEM1 KB", "MEM2 KB", "fallbacks");
+  printf(baseline ? " %10s %10s\n" : "\n", "base MB/s", "base writes");
+  int arg;
+  for (arg = optind + 1; arg < argc; arg++) {
+    char package[BENCH_PATH_SIZE];
+    snprintf(package, sizeof(package), "%s/%s.zip", argv[optind], argv[arg]);
+
+    double megabytes[BENCH_MAX_RUNS];
+    double files[BENCH_MAX_RUNS];
+    double peaks[BENCH_MAX_RUNS];
+    double allocations[BENCH_MAX_RUNS];
+    double writes[BENCH_MAX_RUNS];
+    double baselineMegabytes[BENCH_MAX_RUNS];
+    double baselineWrites[BENCH_MAX_RUNS];
+    u32 run;
+    for (run = 0; run < runs; run++) {
+      struct BenchResult result;
+      if (!benchRun(work, package, probe, &result)) {
+        printf("%-8s %4u failed: %s, %u entries differ\n", argv[arg], run + 1, result.url, result.bad);
+        success = false;
+        break;
+      }
+      if (baseline && !benchBaseline(work, package, &result)) {
+        printf("%-8s %4u baseline failed\n", argv[arg], run + 1);
+        success = false;
+        break;
+      }
+      printf("%-8s %4u %10.2f %10.1f %10.1f %10.2f %12llu %12llu %12llu %10.3f %10llu", argv[arg], run + 1,
+             result.megabytesPerSecond, result.filesPerSecond, result.extractMicroseconds / 1000.0,
+             result.megabytesWritten, (unsigned long long)result.heap.peak, (unsigned long long)result.heap.allocations,
+             (unsigned long long)result.traceAllocations, result.allocationsPerEntry,
+             (unsigned long long)result.writeCalls);
+      printf(" %10u %10u %10u", result.regionPeaks[REGION_MEM1] / 1024, result.regionPeaks[REGION_MEM2] / 1024,
+             result.regionFallbacks);
+      if (baseline) {
+        printf(" %10.2f %10llu", result.baselineMegabytesPerSecond, (unsigned long long)result.baselineWriteCalls);
+      }
+      printf("\n");
+      megabytes[run] = result.megabytesPerSecond;
+      files[run] = result.filesPerSecond;
+      peaks[run] = result.heap.peak;
+      allocations[run] = result.heap.allocations;
+      writes[run] = result.writeCalls;
+      baselineMegabytes[run] = result.baselineMegabytesPerSecond;
+      baselineWrites[run] = result.baselineWriteCalls;
+    }
+    if (run == runs) {
+      printf("%-8s %4s %10.2f %10.1f %10s %10s %12.0f %12.0f %12s %10s %10.0f", argv[arg], "med",
+             benchMedian(megabytes, runs), benchMedian(files, runs), "", "", benchMedian(peaks, runs),
+             benchMedian(allocations, runs), "", "", benchMedian(writes, runs));
+      printf(" %10s %10s %10s", "", "", "");
+      if (baseline) {
+        printf(" %10.2f %10.0f", benchMedian(baselineMegabytes, runs), benchMedian(baselineWrites, runs));
+      }
+      printf("\n");
+    }
+  }
+
+  hostRemoveTree(work);
+  return success ? 0 : 1;
+}
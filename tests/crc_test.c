@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host/host.h"
+#include "miniz.h"
+#include "zlib_ref.h"
+
+// Checks mz_crc32 against zlib's crc32 over every alignment, length and starting CRC,
+// then measures its throughput. The Makefile builds this against each configuration of
+// miniz: slice8 as on the host, table with a single table, and portable as on PowerPC,
+// where words are assembled byte by byte.
+
+#define CRC_TEST_BUFFER_SIZE (16 * 1024 * 1024)
+#define CRC_TEST_TRIALS 20000
+#define CRC_TEST_PASSES 8
+
+static u64 crcTestState = 0x43524333;
+
+static u32 crcTestRandom() {
+  crcTestState ^= crcTestState << 13;
+  crcTestState ^= crcTestState >> 7;
+  crcTestState ^= crcTestState << 17;
+  return (u32)(crcTestState >> 16);
+}
+
+static int crcTestFailures;
+
+static void crcTestExpect(bool condition, const char *what, size_t offset, size_t length) {
+  if (!condition) {
+    printf("  FAIL: %s (offset %zu, length %zu)\n", what, offset, length);
+    crcTestFailures++;
+  }
+}
+
+// Returns the throughput of the given CRC over the given data, in GB/s.
+static double crcTestThroughput(unsigned long (*crc)(unsigned long, const unsigned char *, size_t),
+                                const u8 *data, size_t length) {
+  volatile unsigned long sink = 0;
+  double start = hostSeconds();
+  u32 pass;
+  for (pass = 0; pass < CRC_TEST_PASSES; pass++) {
+    sink ^= crc(sink, data, length);
+  }
+  return (double)CRC_TEST_PASSES * length / (hostSeconds() - start) / 1e9;
+}
+
+static unsigned long crcTestMiniz(unsigned long crc, const unsigned char *data, size_t length) {
+  return mz_crc32(crc, data, length);
+}
+
+int main(int argc, char **argv) {
+  u8 *buffer = malloc(CRC_TEST_BUFFER_SIZE + 64);
+  if (buffer == NULL) {
+    return 1;
+  }
+  size_t i;
+  for (i = 0; i < CRC_TEST_BUFFER_SIZE + 64; i++) {
+    buffer[i] = crcTestRandom();
+  }
+
+  // The check value of CRC-32, and of nothing at all.
+  crcTestExpect(mz_crc32(MZ_CRC32_INIT, (const u8 *)"123456789", 9) == 0xCBF43926, "check value", 0, 9);
+  crcTestExpect(mz_crc32(MZ_CRC32_INIT, buffer, 0) == 0, "empty", 0, 0);
+
+  // Every alignment and every length around the eight bytes folded at once.
+  size_t offset;
+  size_t length;
+  for (offset = 0; offset < 16; offset++) {
+    for (length = 0; length < 64; length++) {
+      crcTestExpect(mz_crc32(0x12345678, buffer + offset, length) == zlibCrc32(0x12345678, buffer + offset, length),
+                    "short", offset, length);
+    }
+  }
+
+  // Random alignments, lengths and starting CRCs.
+  u32 trial;
+  for (trial = 0; trial < CRC_TEST_TRIALS; trial++) {
+    offset = crcTestRandom() % 64;
+    length = trial % 100 == 0 ? crcTestRandom() % (1024 * 1024) : crcTestRandom() % 5000;
+    mz_ulong seed = crcTestRandom();
+    crcTestExpect(mz_crc32(seed, buffer + offset, length) == zlibCrc32(seed, buffer + offset, length), "random",
+                  offset, length);
+  }
+
+  // Chaining across pieces of every size gives the CRC of the whole.
+  for (trial = 0; trial < 200; trial++) {
+    length = crcTestRandom() % (256 * 1024);
+    mz_ulong chained = MZ_CRC32_INIT;
+    size_t position = 0;
+    while (position < length) {
+      size_t piece = crcTestRandom() % 3000;
+      if (piece > length - position) {
+        piece = length - position;
+      }
+      chained = mz_crc32(chained, buffer + position, piece);
+      position += piece;
+    }
+    crcTestExpect(chained == zlibCrc32(0, buffer, length), "chained", 0, length);
+  }
+
+  double aligned = crcTestThroughput(crcTestMiniz, buffer, CRC_TEST_BUFFER_SIZE);
+  double misaligned = crcTestThroughput(crcTestMiniz, buffer + 3, CRC_TEST_BUFFER_SIZE);
+  double zlib = crcTestThroughput(zlibCrc32, buffer, CRC_TEST_BUFFER_SIZE);
+  printf("  mz_crc32 %.2f GB/s aligned, %.2f GB/s misaligned; zlib %.2f GB/s\n", aligned, misaligned, zlib);
+
+  free(buffer);
+  if (crcTestFailures > 0) {
+    printf("  %d failures\n", crcTestFailures);
+    return 1;
+  }
+  return 0;
+}
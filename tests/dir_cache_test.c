@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "host/host.h"
+#include "dir_cache.h"
+#include "main.h"
+#include "trace.h"
+
+// Checks the directories a DirCache creates for an archive's paths.
+//
+// Every directory needed must be created once, whether named by a directory entry or only
+// implied by a file. Only directory entries naming a directory named before are counted as
+// mkdir calls avoided, as those alone were created again before the cache. A path leaving
+// the root via ".." must be rejected before anything of it is added.
+//
+// Usage: dir_cache_test [work directory]
+
+#define DIR_CACHE_TEST_PATH_SIZE 1024
+
+static int dirCacheTestFailures;
+
+static void dirCacheTestExpect(bool condition, const char *what) {
+  if (!condition) {
+    printf("  FAIL: %s\n", what);
+    dirCacheTestFailures++;
+  }
+}
+
+static char dirCacheTestFat[DIR_CACHE_TEST_PATH_SIZE];
+
+// Returns whether the given directory exists beneath the storage directory.
+static bool dirCacheTestExists(const char *name) {
+  char path[DIR_CACHE_TEST_PATH_SIZE];
+  struct stat stats;
+  snprintf(path, sizeof(path), "%s/%s", dirCacheTestFat, name);
+  return stat(path, &stats) == 0 && S_ISDIR(stats.st_mode);
+}
+
+int main(int argc, char **argv) {
+  const char *work = argc > 1 ? argv[1] : "build/dir_cache";
+  char nand[DIR_CACHE_TEST_PATH_SIZE];
+  snprintf(nand, sizeof(nand), "%s/nand", work);
+  snprintf(dirCacheTestFat, sizeof(dirCacheTestFat), "%s/fat", work);
+  hostRemoveTree(work);
+  hostMakeDirs(dirCacheTestFat);
+  hostSetRoots(nand, dirCacheTestFat);
+  TRACE_INIT();
+
+  static const struct {
+    const char *name;
+    bool isDirectory;
+  } entries[] = {
+      {"apps/", true},
+      {"apps/osc/", true},
+      {"apps/osc/boot.dol", false},
+      {"apps/osc/", true},
+      {"apps/osc/data/a/b/c.txt", false},
+      {"./apps/osc/data/", true},
+      {"apps/..osc/meta.xml", false},
+  };
+  struct DirCache cache;
+  dirCacheTestExpect(dirCacheInit(&cache, "fat:"), "a cache could not be allocated");
+  u32 i;
+  for (i = 0; i < sizeof(entries) / sizeof(entries[0]); i++) {
+    dirCacheTestExpect(dirCacheAdd(&cache, entries[i].name, entries[i].isDirectory), "a path could not be added");
+  }
+
+  // Paths leaving the root fail, adding nothing.
+  static const char *escapes[] = {"../boot.dol", "apps/../../boot.dol", "apps/osc/..", "apps/evil/../"};
+  for (i = 0; i < sizeof(escapes) / sizeof(escapes[0]); i++) {
+    u32 count = cache.count;
+    errorCode[0] = '\0';
+    dirCacheTestExpect(!dirCacheAdd(&cache, escapes[i], true) && strcmp(errorCode, "ZIP_EXTRACT_FAILED") == 0,
+                       "a path leaving the root was accepted");
+    dirCacheTestExpect(cache.count == count, "a path leaving the root was added");
+  }
+
+  // apps, apps/osc, apps/osc/data, apps/osc/data/a, apps/osc/data/a/b and apps/..osc.
+  dirCacheTestExpect(cache.count == 6, "a directory was added more than once");
+  // Only apps/osc was named twice. apps/osc/data was implied by a file before it was named.
+  dirCacheTestExpect(cache.duplicates == 1, "duplicate directory entries were not counted");
+  dirCacheTestExpect(dirCacheCreate(&cache), "the directories could not be created");
+  dirCacheTestExpect(dirCacheTestExists("apps/osc/data/a/b") && dirCacheTestExists("apps/..osc"),
+                     "a directory was not created");
+  dirCacheTestExpect(!dirCacheTestExists("apps/evil") && !dirCacheTestExists("../boot.dol"),
+                     "a path leaving the root was created");
+  printf("  %u directories created, %u mkdir calls avoided\n", cache.count, cache.duplicates);
+  dirCacheDestroy(&cache);
+
+  hostRemoveTree(work);
+  if (dirCacheTestFailures > 0) {
+    printf("  %d failures\n", dirCacheTestFailures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "host/host.h"
+#include "extract.h"
+#include "main.h"
+#include "miniz.h"
+#include "region.h"
+#include "trace.h"
+
+// Checks that an extractor whose stages could not all be started recovers.
+//
+// Should any of its threads not be started, extractorStart must fail with ZIP_EXTRACT_FAILED,
+// having joined the stages it did start without writing anything. Every block must be returned,
+// so that the same extractor then installs an archive in full.
+//
+// Usage: extract_test [work directory]
+
+#define EXTRACT_TEST_PATH_SIZE 1024
+
+// Enough to pass more blocks through each link than it holds.
+#define EXTRACT_TEST_FILE_SIZE (EXTRACT_RING_MAX_DEPTH * EXTRACT_BLOCK_SIZE * 2)
+#define EXTRACT_TEST_FILE_COUNT 3
+
+static int extractTestFailures;
+
+static void extractTestExpect(bool condition, const char *what) {
+  if (!condition) {
+    printf("  FAIL: %s\n", what);
+    extractTestFailures++;
+  }
+}
+
+// Writes an archive of a few large files to the given path.
+static bool extractTestWriteArchive(const char *path) {
+  u8 *data = malloc(EXTRACT_TEST_FILE_SIZE);
+  if (data == NULL) {
+    return false;
+  }
+  u32 seed = 1;
+  u32 i;
+  for (i = 0; i < EXTRACT_TEST_FILE_SIZE; i++) {
+    seed = seed * 1103515245 + 12345;
+    data[i] = (seed >> 16) % 16;
+  }
+
+  mz_zip_archive zip;
+  memset(&zip, 0, sizeof(zip));
+  bool success = mz_zip_writer_init_file(&zip, path, 0);
+  for (i = 0; i < EXTRACT_TEST_FILE_COUNT && success; i++) {
+    char name[64];
+    snprintf(name, sizeof(name), "apps/extract/file%u.bin", i);
+    success = mz_zip_writer_add_mem(&zip, name, data, EXTRACT_TEST_FILE_SIZE, MZ_DEFAULT_COMPRESSION);
+  }
+  success = success && mz_zip_writer_finalize_archive(&zip);
+  mz_zip_writer_end(&zip);
+  free(data);
+  return success;
+}
+
+int main(int argc, char **argv) {
+  const char *work = argc > 1 ? argv[1] : "build/extract";
+  char nand[EXTRACT_TEST_PATH_SIZE];
+  char fat[EXTRACT_TEST_PATH_SIZE];
+  char archive[EXTRACT_TEST_PATH_SIZE];
+  snprintf(nand, sizeof(nand), "%s/nand", work);
+  snprintf(fat, sizeof(fat), "%s/fat", work);
+  snprintf(archive, sizeof(archive), "%s/package.zip", work);
+  hostRemoveTree(work);
+  hostMakeDirs(fat);
+  hostSetRoots(nand, fat);
+  regionInit();
+  TRACE_INIT();
+
+  static struct Extractor extractor;
+  mz_zip_archive zip;
+  memset(&zip, 0, sizeof(zip));
+  if (!extractTestWriteArchive(archive) || !extractorInit(&extractor)) {
+    printf("  could not prepare an extractor\n");
+    return 1;
+  }
+
+  // The writer, then the inflater, are started before the reader. Each fails in turn.
+  s32 allowed;
+  for (allowed = 0; allowed < 3; allowed++) {
+    if (!mz_zip_reader_init_file(&zip, archive, 0) || !extractorLoad(&extractor, &zip, NULL, NULL)) {
+      printf("  could not load the archive\n");
+      return 1;
+    }
+    errorCode[0] = '\0';
+    hostLimitThreads(allowed);
+    extractTestExpect(!extractorStart(&extractor) && strcmp(errorCode, "ZIP_EXTRACT_FAILED") == 0,
+                      "extraction started without all of its threads");
+    hostLimitThreads(-1);
+    extractTestExpect(extractor.readerThread == LWP_THREAD_NULL && extractor.inflaterThread == LWP_THREAD_NULL &&
+                          extractor.writerThread == LWP_THREAD_NULL,
+                      "a stage was left running");
+    char path[EXTRACT_TEST_PATH_SIZE];
+    struct stat stats;
+    snprintf(path, sizeof(path), "%s/apps/extract/file0.bin", fat);
+    extractTestExpect(stat(path, &stats) != 0, "a file was written");
+    extractorUnload(&extractor);
+    mz_zip_reader_end(&zip);
+  }
+
+  // The same extractor then installs the archive in full.
+  extractTestExpect(mz_zip_reader_init_file(&zip, archive, 0) && extractorLoad(&extractor, &zip, NULL, NULL) &&
+                        extractorStart(&extractor) && extractorWait(&extractor),
+                    "the archive could not be extracted after a failed start");
+  extractorUnload(&extractor);
+  mz_zip_reader_end(&zip);
+  extractTestExpect(hostVerifyExtraction(archive, fat) == 0, "the archive was not extracted");
+  extractorDestroy(&extractor);
+
+  hostRemoveTree(work);
+  if (extractTestFailures > 0) {
+    printf("  %d failures\n", extractTestFailures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,185 @@
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "font.h"
+
+#include "LiberationSans-Regular_font.h"
+
+// Checks the font baked by tools/bakefont.c against FreeType, drawing text as GRRLIB_PrintfTTF did.
+//
+// Every glyph of every baked size must have FreeType's metrics and coverage. Then every pair of
+// characters, and a few longer strings, are laid out by fontLayout and drawn from the atlas,
+// and must match FreeType's rendering pixel for pixel, kerning included.
+//
+// Usage: font_test [font.ttf]
+
+#define FONT_TEST_WIDTH 640
+#define FONT_TEST_HEIGHT 64
+
+static const char *fontTestStrings[] = {
+    "Installing Homebrew Browser... AVAWAY To Ty, {}[]|~ `quick` brown fox jumps @ 100%",
+    "Could not open file (-106). Press HOME to exit.",
+    "apps/wiixplorer/boot.dol",
+    "Install (2/3)",
+};
+
+// Text drawn by fontLayout and by FreeType.
+static u8 fontTestBaked[FONT_TEST_HEIGHT][FONT_TEST_WIDTH];
+static u8 fontTestReference[FONT_TEST_HEIGHT][FONT_TEST_WIDTH];
+
+static int fontTestFailures;
+
+// Draws a glyph from the atlas, as GRRLIB_DrawPart would with the font's texture.
+static void fontTestDrawGlyph(const struct Font *font, const struct FontGlyph *glyph, int x, int y, void *arg) {
+  u32 row;
+  u32 column;
+  for (row = 0; row < glyph->height; row++) {
+    for (column = 0; column < glyph->width; column++) {
+      int px = x + column;
+      int py = y + row;
+      if (px >= 0 && px < FONT_TEST_WIDTH && py >= 0 && py < FONT_TEST_HEIGHT) {
+        fontTestBaked[py][px] = fontCoverage(font, glyph->x + column, glyph->y + row);
+      }
+    }
+  }
+}
+
+// Draws the given text as GRRLIB_PrintfTTF does, with the top-left of its line at the origin.
+static void fontTestDrawReference(FT_Face face, const char *text, u32 size) {
+  FT_Set_Pixel_Sizes(face, 0, size);
+  int penX = 0;
+  int penY = size;
+  FT_UInt previous = 0;
+  for (; *text != '\0'; text++) {
+    FT_UInt index = FT_Get_Char_Index(face, (u8)*text);
+    if (FT_HAS_KERNING(face) && previous != 0 && index != 0) {
+      FT_Vector delta;
+      FT_Get_Kerning(face, previous, index, FT_KERNING_DEFAULT, &delta);
+      penX += delta.x >> 6;
+    }
+    if (FT_Load_Glyph(face, index, FT_LOAD_RENDER) != 0) {
+      continue;
+    }
+
+    FT_GlyphSlot slot = face->glyph;
+    u32 row;
+    u32 column;
+    for (row = 0; row < slot->bitmap.rows; row++) {
+      for (column = 0; column < slot->bitmap.width; column++) {
+        int px = penX + slot->bitmap_left + column;
+        int py = penY - slot->bitmap_top + row;
+        if (px >= 0 && px < FONT_TEST_WIDTH && py >= 0 && py < FONT_TEST_HEIGHT) {
+          fontTestReference[py][px] = slot->bitmap.buffer[row * slot->bitmap.pitch + column];
+        }
+      }
+    }
+    penX += slot->advance.x >> 6;
+    previous = index;
+  }
+}
+
+// Draws the given text both ways, returning whether they match.
+static bool fontTestCompare(const struct Font *font, FT_Face face, const char *text, u32 size) {
+  memset(fontTestBaked, 0, sizeof(fontTestBaked));
+  memset(fontTestReference, 0, sizeof(fontTestReference));
+  fontLayout(font, text, size, fontTestDrawGlyph, NULL);
+  fontTestDrawReference(face, text, size);
+  if (memcmp(fontTestBaked, fontTestReference, sizeof(fontTestBaked)) == 0) {
+    return true;
+  }
+  if (fontTestFailures < 10) {
+    printf("  FAIL: \"%s\" at %u pixels differs\n", text, size);
+  }
+  fontTestFailures++;
+  return false;
+}
+
+// Checks the metrics and coverage of every glyph of the given face.
+static void fontTestGlyphs(const struct Font *font, const struct FontFace *fontFace, FT_Face face) {
+  FT_Set_Pixel_Sizes(face, 0, fontFace->size);
+  u32 i;
+  for (i = 0; i < font->glyphCount; i++) {
+    const struct FontGlyph *glyph = &fontFace->glyphs[i];
+    u32 character = font->firstChar + i;
+    if (FT_Load_Char(face, character, FT_LOAD_RENDER) != 0) {
+      continue;
+    }
+
+    FT_GlyphSlot slot = face->glyph;
+    bool matches = glyph->width == slot->bitmap.width && glyph->height == slot->bitmap.rows &&
+                   glyph->left == slot->bitmap_left && glyph->top == slot->bitmap_top &&
+                   glyph->advance == slot->advance.x >> 6;
+    u32 row;
+    u32 column;
+    for (row = 0; matches && row < glyph->height; row++) {
+      for (column = 0; column < glyph->width; column++) {
+        if (fontCoverage(font, glyph->x + column, glyph->y + row) !=
+            slot->bitmap.buffer[row * slot->bitmap.pitch + column]) {
+          matches = false;
+        }
+      }
+    }
+    if (!matches) {
+      if (fontTestFailures < 10) {
+        printf("  FAIL: '%c' at %u pixels differs\n", character, fontFace->size);
+      }
+      fontTestFailures++;
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  const char *path = argc > 1 ? argv[1] : "../fonts/LiberationSans-Regular.ttf";
+  FT_Library library;
+  FT_Face face;
+  if (FT_Init_FreeType(&library) != 0 || FT_New_Face(library, path, 0, &face) != 0) {
+    printf("  could not open %s\n", path);
+    return 1;
+  }
+
+  struct Font font;
+  if (!fontLoad(&font, LiberationSans_Regular_font, LiberationSans_Regular_font_size)) {
+    printf("  could not load the baked font\n");
+    return 1;
+  }
+
+  u32 i;
+  for (i = 0; i < font.faceCount; i++) {
+    u32 size = font.faces[i].size;
+    fontTestGlyphs(&font, &font.faces[i], face);
+
+    // Every pair, so that every kerning pair is laid out.
+    u32 pairs = 0;
+    char pair[3] = {0};
+    u32 left;
+    u32 right;
+    for (left = 0; left < font.glyphCount; left++) {
+      for (right = 0; right < font.glyphCount; right++) {
+        pair[0] = font.firstChar + left;
+        pair[1] = font.firstChar + right;
+        pairs += fontTestCompare(&font, face, pair, size);
+      }
+    }
+
+    u32 strings = 0;
+    u32 string;
+    for (string = 0; string < sizeof(fontTestStrings) / sizeof(fontTestStrings[0]); string++) {
+      strings += fontTestCompare(&font, face, fontTestStrings[string], size);
+    }
+    printf("  %u pixels: %u glyphs, %u of %u pairs and %u of %zu strings match\n", size, font.glyphCount, pairs,
+           font.glyphCount * font.glyphCount, strings, sizeof(fontTestStrings) / sizeof(fontTestStrings[0]));
+  }
+
+  fontDestroy(&font);
+  FT_Done_Face(face);
+  FT_Done_FreeType(library);
+  if (fontTestFailures > 0) {
+    printf("  %d failures\n", fontTestFailures);
+    return 1;
+  }
+  return 0;
+}
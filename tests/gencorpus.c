@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host/host.h"
+#include "miniz.h"
+
+// Writes the packages the benchmark and tests install, as <directory>/<corpus>.zip.
+//
+// Each corpus stresses a different part of extraction: many tiny files, a few huge ones,
+// stored rather than deflated data, deeply nested trees, and a typical homebrew app.
+// Contents are generated from a fixed seed, so every run installs identical packages.
+//
+// Usage: gencorpus <directory> [corpus...]
+
+#define GENCORPUS_PATH_SIZE 512
+
+// A xorshift generator, so that corpora do not depend on the host's rand().
+static u64 gencorpusState;
+
+static u32 gencorpusRandom() {
+  gencorpusState ^= gencorpusState << 13;
+  gencorpusState ^= gencorpusState >> 7;
+  gencorpusState ^= gencorpusState << 17;
+  return (u32)(gencorpusState >> 16);
+}
+
+// Returns a value between min and max inclusive.
+static u32 gencorpusRange(u32 min, u32 max) {
+  return min + gencorpusRandom() % (max - min + 1);
+}
+
+enum GencorpusKind {
+  // Words separated by spaces and lines, deflating to roughly a third.
+  GENCORPUS_TEXT,
+  // Random bytes, which deflate does not shrink.
+  GENCORPUS_RANDOM,
+  // Runs of text and random bytes, as within an executable.
+  GENCORPUS_MIXED,
+};
+
+static const char *gencorpusWords[] = {
+    "channel", "shop", "homebrew", "wii", "install", "title", "content", "nand", "download",
+    "apps",    "meta", "icon",     "boot", "dol",    "zip",   "inflate", "sd",   "usb",
+};
+#define GENCORPUS_WORD_COUNT (sizeof(gencorpusWords) / sizeof(gencorpusWords[0]))
+
+static void gencorpusFill(u8 *data, size_t length, enum GencorpusKind kind) {
+  size_t i = 0;
+  while (i < length) {
+    bool text = kind == GENCORPUS_TEXT || (kind == GENCORPUS_MIXED && gencorpusRandom() % 2 == 0);
+    size_t run = kind == GENCORPUS_MIXED ? gencorpusRange(64, 4096) : length - i;
+    size_t end = i + run < length ? i + run : length;
+    while (i < end) {
+      if (text) {
+        const char *word = gencorpusWords[gencorpusRandom() % GENCORPUS_WORD_COUNT];
+        while (*word != '\0' && i < end) {
+          data[i++] = *word++;
+        }
+        if (i < end) {
+          data[i++] = gencorpusRandom() % 12 == 0 ? '\n' : ' ';
+        }
+      } else {
+        data[i++] = gencorpusRandom();
+      }
+    }
+  }
+}
+
+// Adds a file of the given length and kind, deflated unless stored is set.
+static bool gencorpusAddFile(mz_zip_archive *zip, const char *name, size_t length, enum GencorpusKind kind,
+                             bool stored) {
+  u8 *data = malloc(length > 0 ? length : 1);
+  if (data == NULL) {
+    return false;
+  }
+  gencorpusFill(data, length, kind);
+  bool success = mz_zip_writer_add_mem(zip, name, data, length, stored ? MZ_NO_COMPRESSION : MZ_DEFAULT_LEVEL);
+  free(data);
+  return success;
+}
+
+static bool gencorpusAddDirectory(mz_zip_archive *zip, const char *name) {
+  return mz_zip_writer_add_mem(zip, name, NULL, 0, MZ_NO_COMPRESSION);
+}
+
+// 4000 files of up to 4KB across 40 directories, without directory entries.
+static bool gencorpusTiny(mz_zip_archive *zip) {
+  char name[GENCORPUS_PATH_SIZE];
+  u32 i;
+  for (i = 0; i < 4000; i++) {
+    snprintf(name, sizeof(name), "apps/tiny/d%02u/f%04u.txt", i % 40, i);
+    if (!gencorpusAddFile(zip, name, gencorpusRange(200, 4096), GENCORPUS_TEXT, false)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Three files of 24MB: random and stored, text and deflated, and mixed and deflated.
+static bool gencorpusHuge(mz_zip_archive *zip) {
+  return gencorpusAddFile(zip, "apps/huge/random.bin", 24 * 1024 * 1024, GENCORPUS_RANDOM, true) &&
+         gencorpusAddFile(zip, "apps/huge/text.txt", 24 * 1024 * 1024, GENCORPUS_TEXT, false) &&
+         gencorpusAddFile(zip, "apps/huge/mixed.bin", 24 * 1024 * 1024, GENCORPUS_MIXED, false);
+}
+
+// 400 stored files of 64KB, as left by archivers for data that does not compress.
+static bool gencorpusStored(mz_zip_archive *zip) {
+  char name[GENCORPUS_PATH_SIZE];
+  u32 i;
+  for (i = 0; i < 400; i++) {
+    snprintf(name, sizeof(name), "apps/stored/s%03u.bin", i);
+    if (!gencorpusAddFile(zip, name, 64 * 1024, GENCORPUS_RANDOM, true)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// 800 files beneath trees 10 directories deep, sharing prefixes, with directory entries.
+static bool gencorpusDeep(mz_zip_archive *zip) {
+  char name[GENCORPUS_PATH_SIZE];
+  u32 tree;
+  for (tree = 0; tree < 8; tree++) {
+    u32 length = snprintf(name, sizeof(name), "apps/deep/t%u/", tree);
+    if (!gencorpusAddDirectory(zip, "apps/deep/") || !gencorpusAddDirectory(zip, name)) {
+      return false;
+    }
+
+    u32 depth;
+    for (depth = 0; depth < 10; depth++) {
+      length += snprintf(name + length, sizeof(name) - length, "level%u/", depth);
+      if (!gencorpusAddDirectory(zip, name)) {
+        return false;
+      }
+
+      u32 i;
+      for (i = 0; i < 10; i++) {
+        snprintf(name + length, sizeof(name) - length, "file%u.txt", i);
+        if (!gencorpusAddFile(zip, name, gencorpusRange(100, 16 * 1024), GENCORPUS_TEXT, false)) {
+          return false;
+        }
+      }
+      name[length] = '\0';
+    }
+  }
+  return true;
+}
+
+// A typical homebrew app: an executable, its metadata and icon, and 300 data files.
+static bool gencorpusApp(mz_zip_archive *zip) {
+  if (!gencorpusAddDirectory(zip, "apps/") || !gencorpusAddDirectory(zip, "apps/example/") ||
+      !gencorpusAddFile(zip, "apps/example/boot.dol", 3 * 1024 * 1024, GENCORPUS_MIXED, false) ||
+      !gencorpusAddFile(zip, "apps/example/meta.xml", 900, GENCORPUS_TEXT, false) ||
+      !gencorpusAddFile(zip, "apps/example/icon.png", 40 * 1024, GENCORPUS_RANDOM, true) ||
+      !gencorpusAddDirectory(zip, "apps/example/data/")) {
+    return false;
+  }
+
+  char name[GENCORPUS_PATH_SIZE];
+  u32 i;
+  for (i = 0; i < 300; i++) {
+    snprintf(name, sizeof(name), "apps/example/data/%s/asset%03u.dat", i % 3 == 0 ? "sounds" : "levels", i);
+    enum GencorpusKind kind = i % 3 == 0 ? GENCORPUS_RANDOM : GENCORPUS_MIXED;
+    if (!gencorpusAddFile(zip, name, gencorpusRange(10 * 1024, 200 * 1024), kind, false)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static const struct {
+  const char *name;
+  bool (*generate)(mz_zip_archive *zip);
+} gencorpusCorpora[] = {
+    {"tiny", gencorpusTiny}, {"huge", gencorpusHuge}, {"stored", gencorpusStored},
+    {"deep", gencorpusDeep}, {"app", gencorpusApp},
+};
+#define GENCORPUS_COUNT (sizeof(gencorpusCorpora) / sizeof(gencorpusCorpora[0]))
+
+static bool gencorpusWrite(const char *directory, u32 corpus) {
+  char path[GENCORPUS_PATH_SIZE];
+  snprintf(path, sizeof(path), "%s/%s.zip", directory, gencorpusCorpora[corpus].name);
+
+  mz_zip_archive zip;
+  memset(&zip, 0, sizeof(zip));
+  if (!mz_zip_writer_init_file(&zip, path, 0)) {
+    return false;
+  }
+
+  gencorpusState = 0x4F5343 + corpus;
+  bool success = gencorpusCorpora[corpus].generate(&zip) && mz_zip_writer_finalize_archive(&zip);
+  mz_zip_writer_end(&zip);
+  if (success) {
+    printf("%-8s %6u entries  %s\n", gencorpusCorpora[corpus].name, (u32)zip.m_total_files, path);
+  }
+  return success;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s <directory> [corpus...]\n", argv[0]);
+    return 2;
+  }
+  if (!hostMakeDirs(argv[1])) {
+    fprintf(stderr, "Could not create %s\n", argv[1]);
+    return 1;
+  }
+
+  u32 i;
+  for (i = 0; i < GENCORPUS_COUNT; i++) {
+    bool wanted = argc == 2;
+    int arg;
+    for (arg = 2; arg < argc; arg++) {
+      wanted |= strcmp(argv[arg], gencorpusCorpora[i].name) == 0;
+    }
+    if (wanted && !gencorpusWrite(argv[1], i)) {
+      fprintf(stderr, "Could not write corpus %s\n", gencorpusCorpora[i].name);
+      return 1;
+    }
+  }
+  return 0;
+}
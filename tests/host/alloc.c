@@ -0,0 +1,166 @@
+#define _GNU_SOURCE
+#include <gccore.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <reent.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host.h"
+#include "trace.h"
+
+// Allocation counting for the host.
+//
+// On the console, every allocator is built on newlib's reentrant _malloc_r and friends,
+// which trace.c wraps. Here, malloc and friends are wrapped via --wrap instead and passed
+// through those same wrappers, each thread having its own struct _reent as under newlib.
+// Beneath them, calloc and realloc of NULL are built on _malloc_r just as newlib's are, so
+// that an allocation counted twice on the console would be counted twice here. newlib's
+// memalign is too, but glibc's cannot be.
+//
+// Separately, every allocation made by the downloader is counted here along with the bytes
+// in use, so that the trace's own count may be checked and the peak heap reported.
+// Allocations made within glibc itself, such as by fopen, are not seen.
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *pointer, size_t size);
+void *__real_memalign(size_t alignment, size_t size);
+void __real_free(void *pointer);
+
+#if TRACE_ENABLED
+void *__wrap__malloc_r(struct _reent *reent, size_t size);
+void *__wrap__calloc_r(struct _reent *reent, size_t count, size_t size);
+void *__wrap__realloc_r(struct _reent *reent, void *pointer, size_t size);
+void *__wrap__memalign_r(struct _reent *reent, size_t alignment, size_t size);
+#define HOST_MALLOC_R __wrap__malloc_r
+#define HOST_CALLOC_R __wrap__calloc_r
+#define HOST_REALLOC_R __wrap__realloc_r
+#define HOST_MEMALIGN_R __wrap__memalign_r
+#else
+void *__real__malloc_r(struct _reent *reent, size_t size);
+void *__real__calloc_r(struct _reent *reent, size_t count, size_t size);
+void *__real__realloc_r(struct _reent *reent, void *pointer, size_t size);
+void *__real__memalign_r(struct _reent *reent, size_t alignment, size_t size);
+#define HOST_MALLOC_R __real__malloc_r
+#define HOST_CALLOC_R __real__calloc_r
+#define HOST_REALLOC_R __real__realloc_r
+#define HOST_MEMALIGN_R __real__memalign_r
+#endif
+
+static pthread_mutex_t hostHeapLock = PTHREAD_MUTEX_INITIALIZER;
+static struct HostHeapStats hostHeap;
+
+// Stands in for the calling thread's struct _reent, of which only the address is used.
+static __thread char hostReent;
+#define HOST_REENT ((struct _reent *)&hostReent)
+
+void hostGetHeapStats(struct HostHeapStats *stats) {
+  pthread_mutex_lock(&hostHeapLock);
+  *stats = hostHeap;
+  pthread_mutex_unlock(&hostHeapLock);
+}
+
+void hostResetHeapStats() {
+  pthread_mutex_lock(&hostHeapLock);
+  hostHeap.allocations = 0;
+  hostHeap.peak = hostHeap.inUse;
+  pthread_mutex_unlock(&hostHeapLock);
+}
+
+// Records an allocation made by the downloader, replacing the given previous one if any.
+static void hostRecord(void *pointer, size_t previousSize) {
+  size_t size = pointer != NULL ? malloc_usable_size(pointer) : 0;
+  pthread_mutex_lock(&hostHeapLock);
+  hostHeap.allocations++;
+  hostHeap.inUse = hostHeap.inUse + size - (previousSize < hostHeap.inUse ? previousSize : hostHeap.inUse);
+  if (hostHeap.inUse > hostHeap.peak) {
+    hostHeap.peak = hostHeap.inUse;
+  }
+  pthread_mutex_unlock(&hostHeapLock);
+}
+
+/*
+ *	newlib's allocators
+ */
+
+void *__real__malloc_r(struct _reent *reent, size_t size) {
+  return __real_malloc(size);
+}
+
+void *__real__calloc_r(struct _reent *reent, size_t count, size_t size) {
+  if (size != 0 && count > (size_t)-1 / size) {
+    return NULL;
+  }
+  void *pointer = HOST_MALLOC_R(reent, count * size);
+  if (pointer != NULL) {
+    memset(pointer, 0, count * size);
+  }
+  return pointer;
+}
+
+void *__real__realloc_r(struct _reent *reent, void *pointer, size_t size) {
+  if (pointer == NULL) {
+    return HOST_MALLOC_R(reent, size);
+  }
+  return __real_realloc(pointer, size);
+}
+
+void *__real__memalign_r(struct _reent *reent, size_t alignment, size_t size) {
+  return __real_memalign(alignment, size);
+}
+
+/*
+ *	libc's allocators
+ */
+
+void *__wrap_malloc(size_t size) {
+  void *pointer = HOST_MALLOC_R(HOST_REENT, size);
+  hostRecord(pointer, 0);
+  return pointer;
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+  void *pointer = HOST_CALLOC_R(HOST_REENT, count, size);
+  hostRecord(pointer, 0);
+  return pointer;
+}
+
+void *__wrap_realloc(void *pointer, size_t size) {
+  size_t previousSize = pointer != NULL ? malloc_usable_size(pointer) : 0;
+  void *result = HOST_REALLOC_R(HOST_REENT, pointer, size);
+  if (result != NULL || size == 0) {
+    hostRecord(result, previousSize);
+  }
+  return result;
+}
+
+void *__wrap_memalign(size_t alignment, size_t size) {
+  void *pointer = HOST_MEMALIGN_R(HOST_REENT, alignment, size);
+  hostRecord(pointer, 0);
+  return pointer;
+}
+
+void *__wrap_aligned_alloc(size_t alignment, size_t size) {
+  return __wrap_memalign(alignment, size);
+}
+
+char *__wrap_strdup(const char *string) {
+  size_t length = strlen(string) + 1;
+  char *copy = __wrap_malloc(length);
+  if (copy != NULL) {
+    memcpy(copy, string, length);
+  }
+  return copy;
+}
+
+void __wrap_free(void *pointer) {
+  if (pointer == NULL) {
+    return;
+  }
+  size_t size = malloc_usable_size(pointer);
+  pthread_mutex_lock(&hostHeapLock);
+  hostHeap.inUse -= size < hostHeap.inUse ? size : hostHeap.inUse;
+  pthread_mutex_unlock(&hostHeapLock);
+  __real_free(pointer);
+}
@@ -0,0 +1,135 @@
+#define _GNU_SOURCE
+#include <fat.h>
+#include <fcntl.h>
+#include <sdcard/wiisd_io.h>
+#include <ogc/usbstorage.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include "host.h"
+
+// Host stand-ins for libfat and the DISC_INTERFACEs it mounts.
+//
+// Whichever device is mounted, "fat:" is a directory on the host. Every libc call the
+// downloader makes with a path is wrapped via --wrap so that such paths are mapped to it,
+// and NAND paths passed to ISFS are mapped likewise by host/ogc.c. See tests/Makefile.
+
+#define HOST_PATH_SIZE 1024
+
+/*
+ *	DISC_INTERFACE
+ */
+
+static bool hostSdInserted = true;
+static bool hostUsbInserted = false;
+
+void hostSetInserted(bool sd, bool usb) {
+  hostSdInserted = sd;
+  hostUsbInserted = usb;
+}
+
+static bool hostDiscSucceed(void) {
+  return true;
+}
+
+static bool hostSdIsInserted(void) {
+  return hostSdInserted;
+}
+
+static bool hostUsbIsInserted(void) {
+  return hostUsbInserted;
+}
+
+const DISC_INTERFACE __io_wiisd = {
+    0, 0, hostDiscSucceed, hostSdIsInserted, NULL, NULL, hostDiscSucceed, hostDiscSucceed,
+};
+
+const DISC_INTERFACE __io_usbstorage = {
+    0, 0, hostDiscSucceed, hostUsbIsInserted, NULL, NULL, hostDiscSucceed, hostDiscSucceed,
+};
+
+/*
+ *	libfat
+ */
+
+bool fatMount(const char *name, const DISC_INTERFACE *interface, sec_t startSector, u32 cacheSize,
+              u32 SectorsPerPage) {
+  hostSetMounted(interface == &__io_usbstorage);
+  return interface->isInserted();
+}
+
+void fatUnmount(const char *name) {
+  sync();
+}
+
+/*
+ *	Paths
+ */
+
+int __real_open(const char *path, int flags, ...);
+FILE *__real_fopen(const char *path, const char *mode);
+int __real_mkdir(const char *path, mode_t mode);
+int __real_stat(const char *path, struct stat *stats);
+int __real_unlink(const char *path);
+int __real_remove(const char *path);
+int __real_rename(const char *from, const char *to);
+int __real_statvfs(const char *path, struct statvfs *stats);
+int __real_utime(const char *path, const struct utimbuf *times);
+
+int __wrap_open(const char *path, int flags, ...) {
+  mode_t mode = 0;
+  if (flags & O_CREAT) {
+    va_list args;
+    va_start(args, flags);
+    mode = va_arg(args, mode_t);
+    va_end(args);
+  }
+  char buffer[HOST_PATH_SIZE];
+  return __real_open(hostMapPath(path, buffer, sizeof(buffer)), flags, mode);
+}
+
+FILE *__wrap_fopen(const char *path, const char *mode) {
+  char buffer[HOST_PATH_SIZE];
+  return __real_fopen(hostMapPath(path, buffer, sizeof(buffer)), mode);
+}
+
+int __wrap_mkdir(const char *path, mode_t mode) {
+  char buffer[HOST_PATH_SIZE];
+  return __real_mkdir(hostMapPath(path, buffer, sizeof(buffer)), mode);
+}
+
+int __wrap_stat(const char *path, struct stat *stats) {
+  char buffer[HOST_PATH_SIZE];
+  return __real_stat(hostMapPath(path, buffer, sizeof(buffer)), stats);
+}
+
+int __wrap_unlink(const char *path) {
+  char buffer[HOST_PATH_SIZE];
+  return __real_unlink(hostMapPath(path, buffer, sizeof(buffer)));
+}
+
+int __wrap_remove(const char *path) {
+  char buffer[HOST_PATH_SIZE];
+  return __real_remove(hostMapPath(path, buffer, sizeof(buffer)));
+}
+
+int __wrap_rename(const char *from, const char *to) {
+  char fromBuffer[HOST_PATH_SIZE];
+  char toBuffer[HOST_PATH_SIZE];
+  return __real_rename(hostMapPath(from, fromBuffer, sizeof(fromBuffer)), hostMapPath(to, toBuffer, sizeof(toBuffer)));
+}
+
+int __wrap_statvfs(const char *path, struct statvfs *stats) {
+  char buffer[HOST_PATH_SIZE];
+  return __real_statvfs(hostMapPath(path, buffer, sizeof(buffer)), stats);
+}
+
+int __wrap_utime(const char *path, const struct utimbuf *times) {
+  char buffer[HOST_PATH_SIZE];
+  return __real_utime(hostMapPath(path, buffer, sizeof(buffer)), times);
+}
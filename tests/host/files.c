@@ -0,0 +1,152 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "host.h"
+#include "miniz.h"
+
+// Host file helpers shared by the tests and the benchmark.
+
+#define HOST_PATH_SIZE 1024
+#define HOST_COPY_SIZE (1024 * 1024)
+
+static int hostRemoveEntry(const char *path, const struct stat *stats, int type, struct FTW *ftw) {
+  return remove(path);
+}
+
+bool hostRemoveTree(const char *path) {
+  struct stat stats;
+  if (lstat(path, &stats) < 0) {
+    return errno == ENOENT;
+  }
+  return nftw(path, hostRemoveEntry, 16, FTW_DEPTH | FTW_PHYS) == 0;
+}
+
+bool hostMakeDirs(const char *path) {
+  char buffer[HOST_PATH_SIZE];
+  snprintf(buffer, sizeof(buffer), "%s", path);
+
+  char *separator;
+  for (separator = buffer + 1; *separator != '\0'; separator++) {
+    if (*separator == '/') {
+      *separator = '\0';
+      if (mkdir(buffer, 0777) < 0 && errno != EEXIST) {
+        return false;
+      }
+      *separator = '/';
+    }
+  }
+  return mkdir(buffer, 0777) == 0 || errno == EEXIST;
+}
+
+// Creates the parent directories of the given path.
+static bool hostMakeParents(const char *path) {
+  char buffer[HOST_PATH_SIZE];
+  snprintf(buffer, sizeof(buffer), "%s", path);
+  char *separator = strrchr(buffer, '/');
+  if (separator == NULL || separator == buffer) {
+    return true;
+  }
+  *separator = '\0';
+  return hostMakeDirs(buffer);
+}
+
+bool hostCopyFile(const char *from, const char *to) {
+  if (!hostMakeParents(to)) {
+    return false;
+  }
+  int input = open(from, O_RDONLY);
+  int output = open(to, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  char *buffer = malloc(HOST_COPY_SIZE);
+  bool success = input >= 0 && output >= 0 && buffer != NULL;
+
+  while (success) {
+    ssize_t length = read(input, buffer, HOST_COPY_SIZE);
+    if (length <= 0) {
+      success = length == 0;
+      break;
+    }
+    success = write(output, buffer, length) == length;
+  }
+
+  free(buffer);
+  if (input >= 0) {
+    close(input);
+  }
+  if (output >= 0 && close(output) < 0) {
+    success = false;
+  }
+  return success;
+}
+
+bool hostWriteFile(const char *path, const void *data, size_t length) {
+  if (!hostMakeParents(path)) {
+    return false;
+  }
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    return false;
+  }
+  bool success = fwrite(data, 1, length, file) == length;
+  return fclose(file) == 0 && success;
+}
+
+// Returns whether the file at the given path holds exactly the given data.
+static bool hostFileEquals(const char *path, const u8 *data, size_t length) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    return false;
+  }
+  u8 *contents = malloc(length + 1);
+  bool equal = contents != NULL && fread(contents, 1, length + 1, file) == length && memcmp(contents, data, length) == 0;
+  free(contents);
+  fclose(file);
+  return equal;
+}
+
+u32 hostVerifyExtraction(const char *archivePath, const char *root) {
+  mz_zip_archive zip;
+  memset(&zip, 0, sizeof(zip));
+  if (!mz_zip_reader_init_file(&zip, archivePath, 0)) {
+    printf("verify: could not open %s\n", archivePath);
+    return 1;
+  }
+
+  u32 bad = 0;
+  u32 i;
+  for (i = 0; i < mz_zip_reader_get_num_files(&zip); i++) {
+    mz_zip_archive_file_stat stat;
+    if (!mz_zip_reader_file_stat(&zip, i, &stat)) {
+      bad++;
+      continue;
+    }
+
+    char path[HOST_PATH_SIZE];
+    snprintf(path, sizeof(path), "%s/%s", root, stat.m_filename);
+    if (stat.m_is_directory) {
+      struct stat stats;
+      if (lstat(path, &stats) < 0 || !S_ISDIR(stats.st_mode)) {
+        printf("verify: missing directory %s\n", stat.m_filename);
+        bad++;
+      }
+      continue;
+    }
+
+    size_t length = 0;
+    void *data = mz_zip_reader_extract_to_heap(&zip, i, &length, 0);
+    if (data == NULL || !hostFileEquals(path, data, length)) {
+      printf("verify: %s differs\n", stat.m_filename);
+      bad++;
+    }
+    mz_free(data);
+  }
+
+  mz_zip_reader_end(&zip);
+  return bad;
+}
@@ -0,0 +1,15 @@
+#include <gccore.h>
+
+#include "main.h"
+
+// The globals defined by source/main.c, for tests built without it.
+
+static char hostErrorMessage[16384];
+static char hostErrorCode[255];
+
+char *errorMessage = hostErrorMessage;
+char *errorCode = hostErrorCode;
+char *downloadURL;
+
+u8 EMPTY_SHA1_HASH[20] = {0xda, 0x39, 0xa3, 0xee, 0x5e, 0x6b, 0x4b, 0x0d, 0x32, 0x55,
+                          0xbf, 0xef, 0x95, 0x60, 0x18, 0x90, 0xaf, 0xd8, 0x07, 0x09};
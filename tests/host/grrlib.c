@@ -0,0 +1,112 @@
+#define _GNU_SOURCE
+#include <gccore.h>
+#include <grrlib.h>
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wiiuse/wpad.h>
+
+#include "host.h"
+
+// Headless host stand-ins for GRRLIB, VIDEO and WPAD.
+//
+// Nothing is drawn, but draws are counted so that the cost of a frame may be compared.
+// A frame lasts a millisecond rather than a sixtieth of a second, so that fades do not
+// dominate a benchmark while rendering still yields to other threads as on the console.
+
+#define HOST_FRAME_NANOSECONDS 1000000
+
+static struct HostDrawStats hostDraws;
+
+void hostGetDrawStats(struct HostDrawStats *stats) {
+  *stats = hostDraws;
+}
+
+void hostResetDrawStats() {
+  memset(&hostDraws, 0, sizeof(hostDraws));
+}
+
+// Waits for the next frame.
+static void hostWaitFrame() {
+  struct timespec frame = {0, HOST_FRAME_NANOSECONDS};
+  nanosleep(&frame, NULL);
+}
+
+void GRRLIB_Init(void) {
+}
+
+void GRRLIB_Exit(void) {
+}
+
+void GRRLIB_Render(void) {
+  hostDraws.frames++;
+  hostWaitFrame();
+}
+
+void GRRLIB_SetBackgroundColour(u8 r, u8 g, u8 b, u8 a) {
+}
+
+GRRLIB_texImg *GRRLIB_CreateEmptyTexture(u32 w, u32 h) {
+  GRRLIB_texImg *tex = calloc(1, sizeof(GRRLIB_texImg));
+  if (tex == NULL) {
+    return NULL;
+  }
+  tex->data = memalign(32, w * h * 4);
+  if (tex->data == NULL) {
+    free(tex);
+    return NULL;
+  }
+  memset(tex->data, 0, w * h * 4);
+  tex->w = w;
+  tex->h = h;
+  return tex;
+}
+
+void GRRLIB_FreeTexture(GRRLIB_texImg *tex) {
+  if (tex != NULL) {
+    free(tex->data);
+    free(tex);
+  }
+}
+
+void GRRLIB_FlushTex(GRRLIB_texImg *tex) {
+  hostDraws.flushes++;
+  hostDraws.flushedPixels += (u64)tex->w * tex->h;
+}
+
+void GRRLIB_Rectangle(f32 x, f32 y, f32 width, f32 height, u32 color, bool filled) {
+  hostDraws.rectangles++;
+}
+
+void GRRLIB_DrawImg(f32 xpos, f32 ypos, const GRRLIB_texImg *tex, f32 degrees, f32 scaleX, f32 scaleY, u32 color) {
+  hostDraws.quads++;
+  hostDraws.images++;
+}
+
+void GRRLIB_DrawPart(f32 xpos, f32 ypos, f32 partx, f32 party, f32 partw, f32 parth, const GRRLIB_texImg *tex,
+                     f32 degrees, f32 scaleX, f32 scaleY, u32 color) {
+  hostDraws.quads++;
+}
+
+void GX_InvalidateTexAll(void) {
+}
+
+void VIDEO_WaitVSync(void) {
+  hostWaitFrame();
+}
+
+void VIDEO_SetBlack(bool black) {
+}
+
+s32 WPAD_Init(void) {
+  return 0;
+}
+
+s32 WPAD_ScanPads(void) {
+  return 0;
+}
+
+u32 WPAD_ButtonsDown(int chan) {
+  return WPAD_BUTTON_HOME;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <gccore.h>
+
+// The downloader's main(), renamed when built for the host. See tests/Makefile.
+int downloaderMain(int argc, char **argv);
+
+// Sets the host directories standing in for NAND and for the device mounted as "fat:".
+// Both default to "nand" and "fat" within the working directory.
+void hostSetRoots(const char *nand, const char *fat);
+
+// Returns the host path for the given "fat:" path within the given buffer.
+// Any other path, such as one already mapped, is returned as is.
+const char *hostMapPath(const char *path, char *buffer, size_t size);
+
+// Sets whether the front SD slot and USB hold a card, both of which are mounted at the same root.
+// By default, only the SD slot does.
+void hostSetInserted(bool sd, bool usb);
+
+// Gives USB a root of its own, mapped to whenever it is the device mounted as "fat:".
+// NULL, the default, mounts it at the same root as the SD slot.
+void hostSetUsbRoot(const char *fat);
+
+// Records whether the device mounted as "fat:" is USB, as host/fat.c's fatMount does,
+// and returns whether the device last mounted was.
+void hostSetMounted(bool usb);
+bool hostUsbMounted();
+
+// Limits the amount of threads LWP_CreateThread starts before failing, as libogc's does once
+// it runs out of threads. Negative, the default, is unlimited.
+void hostLimitThreads(s32 count);
+
+// Called in place of relaunching the shop channel, given the URL it would have been passed,
+// such as "/error?error=SUCCESS". The default prints the URL and exits; tests may define their own.
+void hostLaunch(const char *url);
+
+// Heap usage by allocations made through malloc and friends. See host/alloc.c.
+struct HostHeapStats {
+  // Allocations made, counting reallocations.
+  u64 allocations;
+  // Bytes allocated at once, now and at most.
+  u64 inUse;
+  u64 peak;
+};
+
+void hostGetHeapStats(struct HostHeapStats *stats);
+void hostResetHeapStats();
+
+// Drawing made through the GRRLIB stand-in, since the last reset. See host/grrlib.c.
+struct HostDrawStats {
+  u32 frames;
+  // Textured quads drawn, and those among them drawn via GRRLIB_DrawImg.
+  u32 quads;
+  u32 images;
+  u32 rectangles;
+  // Textures flushed to the GPU, and the pixels within them.
+  u32 flushes;
+  u64 flushedPixels;
+};
+
+void hostGetDrawStats(struct HostDrawStats *stats);
+void hostResetDrawStats();
+
+// Removes the given directory and everything within it, should it exist.
+bool hostRemoveTree(const char *path);
+
+// Creates the given directory and any parents, should they not exist.
+bool hostMakeDirs(const char *path);
+
+// Copies the file at the given path.
+bool hostCopyFile(const char *from, const char *to);
+
+// Writes the given data to the file at the given path, creating any parent directories.
+bool hostWriteFile(const char *path, const void *data, size_t length);
+
+// Checks that every entry of the archive at the given path was extracted beneath the given directory.
+// Returns the amount of entries missing or differing, printing each.
+u32 hostVerifyExtraction(const char *archivePath, const char *root);
+
+// Returns the time in seconds from an arbitrary point.
+double hostSeconds();
@@ -0,0 +1,554 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <gccore.h>
+#include <ogc/lwp_heap.h>
+#include <ogc/lwp_watchdog.h>
+#include <ogc/machine/processor.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "host.h"
+
+// Host stand-ins for libogc, enough to run the downloader as a process.
+//
+// NAND is a directory, and ISFS enforces the 32-byte alignment IOS requires of buffers.
+// LWP threads, mutexes and semaphores are built on pthreads, and each is given a small
+// integer handle as under libogc. Threads run in parallel rather than by priority, so
+// races hidden on the console's single core may surface here; that is deliberate.
+
+#define HOST_PATH_SIZE 1024
+
+/*
+ *	Paths
+ */
+
+static const char *hostNandRoot = "nand";
+static const char *hostFatRoot = "fat";
+static const char *hostUsbRoot = NULL;
+static bool hostUsbIsMounted = false;
+
+void hostSetRoots(const char *nand, const char *fat) {
+  hostNandRoot = nand;
+  hostFatRoot = fat;
+}
+
+void hostSetUsbRoot(const char *fat) {
+  hostUsbRoot = fat;
+}
+
+void hostSetMounted(bool usb) {
+  hostUsbIsMounted = usb;
+}
+
+bool hostUsbMounted() {
+  return hostUsbIsMounted;
+}
+
+const char *hostMapPath(const char *path, char *buffer, size_t size) {
+  if (strncmp(path, "fat:", 4) != 0) {
+    return path;
+  }
+  snprintf(buffer, size, "%s%s", hostUsbRoot != NULL && hostUsbMounted() ? hostUsbRoot : hostFatRoot, path + 4);
+  return buffer;
+}
+
+// Returns the host path for the given NAND path within the given buffer.
+static const char *isfsMapPath(const char *path, char *buffer, size_t size) {
+  snprintf(buffer, size, "%s%s", hostNandRoot, path);
+  return buffer;
+}
+
+/*
+ *	ISFS
+ */
+
+s32 ISFS_Initialize(void) {
+  return ISFS_OK;
+}
+
+s32 ISFS_Deinitialize(void) {
+  return ISFS_OK;
+}
+
+// Maps a host errno to the closest ISFS error.
+static s32 isfsError() {
+  return errno == ENOENT ? ISFS_ENOENT : ISFS_EINVAL;
+}
+
+s32 ISFS_Open(const char *filepath, u8 mode) {
+  char path[HOST_PATH_SIZE];
+  int flags = mode == ISFS_OPEN_READ ? O_RDONLY : mode == ISFS_OPEN_WRITE ? O_WRONLY : O_RDWR;
+  int fd = open(isfsMapPath(filepath, path, sizeof(path)), flags);
+  return fd < 0 ? isfsError() : fd;
+}
+
+s32 ISFS_Close(s32 fd) {
+  return close(fd) < 0 ? ISFS_EINVAL : ISFS_OK;
+}
+
+s32 ISFS_Read(s32 fd, void *buffer, u32 length) {
+  if (((uintptr_t)buffer & 31) != 0) {
+    return ISFS_EINVAL;
+  }
+  ssize_t result = read(fd, buffer, length);
+  return result < 0 ? ISFS_EINVAL : result;
+}
+
+s32 ISFS_Write(s32 fd, const void *buffer, u32 length) {
+  if (((uintptr_t)buffer & 31) != 0) {
+    return ISFS_EINVAL;
+  }
+  ssize_t result = write(fd, buffer, length);
+  return result < 0 ? ISFS_EINVAL : result;
+}
+
+s32 ISFS_Seek(s32 fd, s32 where, s32 whence) {
+  off_t result = lseek(fd, where, whence);
+  return result < 0 ? ISFS_EINVAL : result;
+}
+
+s32 ISFS_GetFileStats(s32 fd, fstats *status) {
+  struct stat stats;
+  if (fstat(fd, &stats) < 0) {
+    return ISFS_EINVAL;
+  }
+  status->file_length = stats.st_size;
+  status->file_pos = lseek(fd, 0, SEEK_CUR);
+  return ISFS_OK;
+}
+
+s32 ISFS_Delete(const char *filepath) {
+  char path[HOST_PATH_SIZE];
+  return unlink(isfsMapPath(filepath, path, sizeof(path))) < 0 ? isfsError() : ISFS_OK;
+}
+
+s32 ISFS_CreateFile(const char *filepath, u8 attributes, u8 owner_perm, u8 group_perm, u8 other_perm) {
+  char path[HOST_PATH_SIZE];
+  int fd = open(isfsMapPath(filepath, path, sizeof(path)), O_WRONLY | O_CREAT | O_EXCL, 0644);
+  if (fd < 0) {
+    return isfsError();
+  }
+  close(fd);
+  return ISFS_OK;
+}
+
+s32 ISFS_GetAttr(const char *filepath, u32 *ownerID, u16 *groupID, u8 *attributes, u8 *ownerperm, u8 *groupperm,
+                 u8 *otherperm) {
+  char path[HOST_PATH_SIZE];
+  struct stat stats;
+  if (stat(isfsMapPath(filepath, path, sizeof(path)), &stats) < 0) {
+    return isfsError();
+  }
+  *ownerID = 0x1000;
+  *groupID = 1;
+  *attributes = 0;
+  *ownerperm = 3;
+  *groupperm = 3;
+  *otherperm = 1;
+  return ISFS_OK;
+}
+
+s32 ISFS_SetAttr(const char *filepath, u32 ownerID, u16 groupID, u8 attributes, u8 ownerperm, u8 groupperm,
+                 u8 otherperm) {
+  return ISFS_OK;
+}
+
+/*
+ *	WII, VIDEO and cache
+ */
+
+__attribute__((weak)) void hostLaunch(const char *url) {
+  printf("launch %s\n", url);
+  exit(0);
+}
+
+s32 WII_Initialize(void) {
+  return 0;
+}
+
+s32 WII_LaunchTitleWithArgs(u64 titleID, int launchcode, ...) {
+  va_list args;
+  va_start(args, launchcode);
+  const char *url = va_arg(args, const char *);
+  va_end(args);
+
+  hostLaunch(url != NULL ? url : "");
+  return -1;
+}
+
+void DCFlushRange(void *startaddress, u32 len) {
+}
+
+void DCInvalidateRange(void *startaddress, u32 len) {
+}
+
+/*
+ *	Interrupts
+ */
+
+static pthread_mutex_t hostIsrLock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+u32 hostIsrDisable(void) {
+  pthread_mutex_lock(&hostIsrLock);
+  return 1;
+}
+
+void hostIsrRestore(u32 level) {
+  pthread_mutex_unlock(&hostIsrLock);
+}
+
+/*
+ *	Time
+ */
+
+u64 gettime(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return microsecs_to_ticks((u64)now.tv_sec * 1000000 + now.tv_nsec / 1000);
+}
+
+u32 diff_usec(u64 start, u64 end) {
+  return ticks_to_microsecs(end - start);
+}
+
+double hostSeconds() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/*
+ *	LWP
+ */
+
+#define HOST_MAX_OBJECTS 1024
+
+// Threads, mutexes and semaphores share a single table, indexed by handle.
+// Handle 0 is left unused, as libogc never returns it.
+static struct {
+  pthread_mutex_t lock;
+  void *objects[HOST_MAX_OBJECTS];
+  u32 count;
+} hostObjects = {PTHREAD_MUTEX_INITIALIZER, {NULL}, 1};
+
+static u32 hostAddObject(void *object) {
+  pthread_mutex_lock(&hostObjects.lock);
+  u32 handle = hostObjects.count < HOST_MAX_OBJECTS ? hostObjects.count++ : 0;
+  hostObjects.objects[handle] = object;
+  pthread_mutex_unlock(&hostObjects.lock);
+  if (handle == 0) {
+    fprintf(stderr, "host: out of LWP handles\n");
+    abort();
+  }
+  return handle;
+}
+
+static void *hostGetObject(u32 handle) {
+  pthread_mutex_lock(&hostObjects.lock);
+  void *object = handle < hostObjects.count ? hostObjects.objects[handle] : NULL;
+  pthread_mutex_unlock(&hostObjects.lock);
+  return object;
+}
+
+struct HostThread {
+  pthread_t thread;
+  lwp_t handle;
+  void *(*entry)(void *);
+  void *arg;
+};
+
+// The handle of the calling thread. The main thread is given its own on first use.
+static __thread lwp_t hostSelf = LWP_THREAD_NULL;
+
+static void *hostThreadStart(void *arg) {
+  struct HostThread *thread = arg;
+  hostSelf = thread->handle;
+  return thread->entry(thread->arg);
+}
+
+// The amount of threads LWP_CreateThread may yet start, or negative should it be unlimited.
+static s32 hostThreadsAllowed = -1;
+
+void hostLimitThreads(s32 count) {
+  hostThreadsAllowed = count;
+}
+
+s32 LWP_CreateThread(lwp_t *thethread, void *(*entry)(void *), void *arg, void *stackbase, u32 stack_size, u8 prio) {
+  if (hostThreadsAllowed == 0) {
+    return -1;
+  }
+  struct HostThread *thread = calloc(1, sizeof(struct HostThread));
+  if (thread == NULL) {
+    return -1;
+  }
+  thread->entry = entry;
+  thread->arg = arg;
+  thread->handle = hostAddObject(thread);
+  if (pthread_create(&thread->thread, NULL, hostThreadStart, thread) != 0) {
+    return -1;
+  }
+  // As under libogc, the handle is only given once the thread has started.
+  *thethread = thread->handle;
+  if (hostThreadsAllowed > 0) {
+    hostThreadsAllowed--;
+  }
+  return 0;
+}
+
+s32 LWP_JoinThread(lwp_t thethread, void **value_ptr) {
+  struct HostThread *thread = hostGetObject(thethread);
+  if (thread == NULL) {
+    return -1;
+  }
+  return pthread_join(thread->thread, value_ptr) == 0 ? 0 : -1;
+}
+
+lwp_t LWP_GetSelf(void) {
+  if (hostSelf == LWP_THREAD_NULL) {
+    hostSelf = hostAddObject(NULL);
+  }
+  return hostSelf;
+}
+
+void LWP_YieldThread(void) {
+  sched_yield();
+}
+
+s32 LWP_MutexInit(mutex_t *mutex, bool use_recursive) {
+  pthread_mutex_t *object = malloc(sizeof(pthread_mutex_t));
+  if (object == NULL) {
+    return -1;
+  }
+  pthread_mutexattr_t attributes;
+  pthread_mutexattr_init(&attributes);
+  pthread_mutexattr_settype(&attributes, use_recursive ? PTHREAD_MUTEX_RECURSIVE : PTHREAD_MUTEX_NORMAL);
+  pthread_mutex_init(object, &attributes);
+  pthread_mutexattr_destroy(&attributes);
+  *mutex = hostAddObject(object);
+  return 0;
+}
+
+s32 LWP_MutexDestroy(mutex_t mutex) {
+  return 0;
+}
+
+s32 LWP_MutexLock(mutex_t mutex) {
+  return pthread_mutex_lock(hostGetObject(mutex));
+}
+
+s32 LWP_MutexUnlock(mutex_t mutex) {
+  return pthread_mutex_unlock(hostGetObject(mutex));
+}
+
+// A counting semaphore bounded by a maximum, as libogc's is.
+struct HostSemaphore {
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  u32 count;
+  u32 max;
+};
+
+s32 LWP_SemInit(sem_t *sem, u32 start, u32 max) {
+  struct HostSemaphore *object = malloc(sizeof(struct HostSemaphore));
+  if (object == NULL) {
+    return -1;
+  }
+  pthread_mutex_init(&object->lock, NULL);
+  pthread_cond_init(&object->changed, NULL);
+  object->count = start;
+  object->max = max;
+  *sem = hostAddObject(object);
+  return 0;
+}
+
+s32 LWP_SemDestroy(sem_t sem) {
+  return 0;
+}
+
+s32 LWP_SemWait(sem_t sem) {
+  struct HostSemaphore *object = hostGetObject(sem);
+  pthread_mutex_lock(&object->lock);
+  while (object->count == 0) {
+    pthread_cond_wait(&object->changed, &object->lock);
+  }
+  object->count--;
+  pthread_mutex_unlock(&object->lock);
+  return 0;
+}
+
+s32 LWP_SemPost(sem_t sem) {
+  struct HostSemaphore *object = hostGetObject(sem);
+  pthread_mutex_lock(&object->lock);
+  if (object->count < object->max) {
+    object->count++;
+  }
+  pthread_cond_signal(&object->changed);
+  pthread_mutex_unlock(&object->lock);
+  return 0;
+}
+
+/*
+ *	SYS
+ */
+
+// Roughly what remains of a Wii's 24MB of MEM1 and 64MB of MEM2 once a program is loaded.
+// Build with MEMORY_TIER to choose a smaller plan than these allow. See source/region.c.
+#define HOST_ARENA1_SIZE (16 * 1024 * 1024)
+#define HOST_ARENA2_SIZE (52 * 1024 * 1024)
+
+static u8 hostArena1[HOST_ARENA1_SIZE] ATTRIBUTE_ALIGN(32);
+static u8 hostArena2[HOST_ARENA2_SIZE] ATTRIBUTE_ALIGN(32);
+static u8 *hostArena1Hi = hostArena1 + HOST_ARENA1_SIZE;
+static u8 *hostArena2Hi = hostArena2 + HOST_ARENA2_SIZE;
+
+u32 SYS_GetArena1Size(void) {
+  return hostArena1Hi - hostArena1;
+}
+
+void *SYS_GetArena1Lo(void) {
+  return hostArena1;
+}
+
+void *SYS_GetArena1Hi(void) {
+  return hostArena1Hi;
+}
+
+void SYS_SetArena1Hi(void *newHi) {
+  hostArena1Hi = newHi;
+}
+
+u32 SYS_GetArena2Size(void) {
+  return hostArena2Hi - hostArena2;
+}
+
+void *SYS_GetArena2Lo(void) {
+  return hostArena2;
+}
+
+void *SYS_GetArena2Hi(void) {
+  return hostArena2Hi;
+}
+
+void SYS_SetArena2Hi(void *newHi) {
+  hostArena2Hi = newHi;
+}
+
+/*
+ *	Heap
+ */
+
+// A first-fit heap over a caller's memory, standing in for libogc's __lwp_heap.
+// Each block is preceded by a header of 32 bytes, so that blocks stay aligned by 32 as under libogc.
+#define HOST_HEAP_HEADER_SIZE 32
+
+struct HostHeapBlock {
+  u32 size;
+  bool used;
+};
+
+struct HostHeap {
+  u8 *start;
+  u32 size;
+};
+
+u32 __lwp_heap_init(heap_cntrl *theheap, void *start_addr, u32 size, u32 pg_size) {
+  _Static_assert(sizeof(struct HostHeap) <= sizeof(heap_cntrl), "heap_cntrl is too small");
+  struct HostHeap *heap = (struct HostHeap *)theheap;
+  heap->start = (u8 *)(((uintptr_t)start_addr + 31) & ~(uintptr_t)31);
+  heap->size = (size - (heap->start - (u8 *)start_addr)) & ~31;
+  if (heap->size <= HOST_HEAP_HEADER_SIZE) {
+    return 0;
+  }
+
+  struct HostHeapBlock *block = (struct HostHeapBlock *)heap->start;
+  block->size = heap->size - HOST_HEAP_HEADER_SIZE;
+  block->used = false;
+  return heap->size;
+}
+
+void *__lwp_heap_allocate(heap_cntrl *theheap, u32 size) {
+  struct HostHeap *heap = (struct HostHeap *)theheap;
+  size = (size + 31) & ~31;
+
+  u32 isr;
+  _CPU_ISR_Disable(isr);
+  u8 *position;
+  for (position = heap->start; position < heap->start + heap->size;) {
+    struct HostHeapBlock *block = (struct HostHeapBlock *)position;
+    if (!block->used && block->size >= size) {
+      // Split off the remainder, should it hold a block of its own.
+      if (block->size >= size + 2 * HOST_HEAP_HEADER_SIZE) {
+        struct HostHeapBlock *rest = (struct HostHeapBlock *)(position + HOST_HEAP_HEADER_SIZE + size);
+        rest->size = block->size - size - HOST_HEAP_HEADER_SIZE;
+        rest->used = false;
+        block->size = size;
+      }
+      block->used = true;
+      _CPU_ISR_Restore(isr);
+      return position + HOST_HEAP_HEADER_SIZE;
+    }
+    position += HOST_HEAP_HEADER_SIZE + block->size;
+  }
+  _CPU_ISR_Restore(isr);
+  return NULL;
+}
+
+bool __lwp_heap_free(heap_cntrl *theheap, void *ptr) {
+  struct HostHeap *heap = (struct HostHeap *)theheap;
+  u8 *target = (u8 *)ptr - HOST_HEAP_HEADER_SIZE;
+
+  u32 isr;
+  _CPU_ISR_Disable(isr);
+  struct HostHeapBlock *previous = NULL;
+  u8 *position;
+  for (position = heap->start; position < heap->start + heap->size;) {
+    struct HostHeapBlock *block = (struct HostHeapBlock *)position;
+    u8 *next = position + HOST_HEAP_HEADER_SIZE + block->size;
+    if (position == target && block->used) {
+      block->used = false;
+
+      // Merge with the free blocks on either side.
+      if (next < heap->start + heap->size && !((struct HostHeapBlock *)next)->used) {
+        block->size += HOST_HEAP_HEADER_SIZE + ((struct HostHeapBlock *)next)->size;
+      }
+      if (previous != NULL && !previous->used) {
+        previous->size += HOST_HEAP_HEADER_SIZE + block->size;
+      }
+      _CPU_ISR_Restore(isr);
+      return true;
+    }
+    previous = block;
+    position = next;
+  }
+  _CPU_ISR_Restore(isr);
+  return false;
+}
+
+u32 __lwp_heap_getinfo(heap_cntrl *theheap, heap_iblock *theinfo) {
+  struct HostHeap *heap = (struct HostHeap *)theheap;
+  memset(theinfo, 0, sizeof(heap_iblock));
+
+  u32 isr;
+  _CPU_ISR_Disable(isr);
+  u8 *position;
+  for (position = heap->start; position < heap->start + heap->size;) {
+    struct HostHeapBlock *block = (struct HostHeapBlock *)position;
+    if (block->used) {
+      theinfo->used_blocks++;
+      theinfo->used_size += block->size;
+    } else {
+      theinfo->free_blocks++;
+      theinfo->free_size += block->size;
+    }
+    position += HOST_HEAP_HEADER_SIZE + block->size;
+  }
+  _CPU_ISR_Restore(isr);
+  return 0;
+}
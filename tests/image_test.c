@@ -0,0 +1,311 @@
+#include <png.h>
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "host/host.h"
+#include "texture.h"
+
+#include "osc_tex.h"
+
+// Checks the textures baked by tools/bakeimage.c against what GRRLIB_LoadTexturePNG made of the same images.
+//
+// The reference is decoded by libpng with the transformations GRRLIB's PNGU applies, expanding
+// every format to 8-bit RGBA, then tiled texel by texel as GRRLIB_SetPixelToTexImg does. The
+// logo linked in to the downloader is checked against images/osc.png, then images of every
+// format and of sizes which need padding are written, baked and checked the same way.
+// Textures must match once loaded by textureLoad, whether drawn from in place or copied.
+//
+// Usage: image_test [bakeimage] [osc.png]
+
+#define IMAGE_TEST_DIRECTORY "build/images"
+#define IMAGE_TEST_PATH_SIZE 256
+#define IMAGE_TEST_LOADS 100
+
+// An image written for bakeimage, with the format and bit depth it is written in.
+struct ImageTestImage {
+  const char *name;
+  u32 width;
+  u32 height;
+  int colorType;
+  int bitDepth;
+};
+
+static const struct ImageTestImage imageTestImages[] = {
+    {"rgba", 13, 7, PNG_COLOR_TYPE_RGB_ALPHA, 8},
+    {"rgb", 9, 5, PNG_COLOR_TYPE_RGB, 8},
+    {"gray", 6, 6, PNG_COLOR_TYPE_GRAY, 8},
+    {"gray_alpha", 5, 3, PNG_COLOR_TYPE_GRAY_ALPHA, 8},
+    {"palette", 7, 9, PNG_COLOR_TYPE_PALETTE, 8},
+    {"rgba16", 10, 10, PNG_COLOR_TYPE_RGB_ALPHA, 16},
+    {"rgb16", 3, 1, PNG_COLOR_TYPE_RGB, 16},
+    {"square", 16, 16, PNG_COLOR_TYPE_RGB_ALPHA, 8},
+};
+#define IMAGE_TEST_IMAGES (sizeof(imageTestImages) / sizeof(imageTestImages[0]))
+
+static int imageTestFailures;
+
+static u32 imageTestState = 0x1234567;
+
+static u32 imageTestRandom() {
+  imageTestState ^= imageTestState << 13;
+  imageTestState ^= imageTestState >> 17;
+  imageTestState ^= imageTestState << 5;
+  return imageTestState;
+}
+
+// Decodes the given image to 8-bit RGBA as GRRLIB's PNGU does, returning its pixels or NULL.
+static u8 *imageTestDecode(const char *path, u32 *width, u32 *height) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    return NULL;
+  }
+  png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+  png_infop info = png_create_info_struct(png);
+  u8 *pixels = NULL;
+  png_bytep *rows = NULL;
+  if (setjmp(png_jmpbuf(png))) {
+    free(pixels);
+    free(rows);
+    png_destroy_read_struct(&png, &info, NULL);
+    fclose(file);
+    return NULL;
+  }
+
+  png_init_io(png, file);
+  png_read_info(png, info);
+  // Palettes and low bit depths are expanded, transparency becomes alpha, 16-bit channels
+  // are truncated, and opaque images are given an alpha of 255.
+  png_set_expand(png);
+  png_set_strip_16(png);
+  png_set_gray_to_rgb(png);
+  png_set_add_alpha(png, 0xFF, PNG_FILLER_AFTER);
+  png_read_update_info(png, info);
+
+  *width = png_get_image_width(png, info);
+  *height = png_get_image_height(png, info);
+  pixels = malloc(*width * *height * 4);
+  rows = malloc(*height * sizeof(png_bytep));
+  u32 y;
+  for (y = 0; y < *height; y++) {
+    rows[y] = pixels + y * *width * 4;
+  }
+  png_read_image(png, rows);
+  png_read_end(png, NULL);
+
+  free(rows);
+  png_destroy_read_struct(&png, &info, NULL);
+  fclose(file);
+  return pixels;
+}
+
+// Tiles the given pixels in to a GX_TF_RGBA8 texture padded to a multiple of 4,
+// placing each texel as GRRLIB_SetPixelToTexImg does.
+static u8 *imageTestTile(const u8 *pixels, u32 width, u32 height, u32 *paddedWidth, u32 *paddedHeight) {
+  *paddedWidth = (width + 3) & ~3;
+  *paddedHeight = (height + 3) & ~3;
+  u8 *texture = calloc(1, *paddedWidth * *paddedHeight * 4);
+  u32 x;
+  u32 y;
+  for (y = 0; y < height; y++) {
+    for (x = 0; x < width; x++) {
+      const u8 *pixel = pixels + (y * width + x) * 4;
+      u32 offset = (((y >> 2) << 4) * *paddedWidth) + ((x >> 2) << 6) + ((((y % 4) << 2) + x % 4) << 1);
+      texture[offset] = pixel[3];
+      texture[offset + 1] = pixel[0];
+      texture[offset + 32] = pixel[1];
+      texture[offset + 33] = pixel[2];
+    }
+  }
+  return texture;
+}
+
+// Loads the given baked texture and checks it against the given image, both in place and copied.
+static bool imageTestCompare(const char *name, const char *path, const u8 *data, u32 length) {
+  u32 width;
+  u32 height;
+  u8 *pixels = imageTestDecode(path, &width, &height);
+  if (pixels == NULL) {
+    printf("  FAIL: could not decode %s\n", path);
+    imageTestFailures++;
+    return false;
+  }
+  u32 paddedWidth;
+  u32 paddedHeight;
+  u8 *reference = imageTestTile(pixels, width, height, &paddedWidth, &paddedHeight);
+
+  // Once aligned by 32, as bin2o does, and once not, so that it must be copied.
+  u8 *buffer = memalign(32, length + 32);
+  bool matches = true;
+  u32 offset;
+  for (offset = 0; offset <= 1; offset++) {
+    memcpy(buffer + offset, data, length);
+    GRRLIB_texImg texture;
+    if (!textureLoad(&texture, buffer + offset, length)) {
+      printf("  FAIL: %s could not be loaded\n", name);
+      matches = false;
+      break;
+    }
+    bool inPlace = (u8 *)texture.data == buffer + offset + 32;
+    if (inPlace != (offset == 0)) {
+      printf("  FAIL: %s was %s\n", name, inPlace ? "not copied" : "copied");
+      matches = false;
+    }
+    if (texture.w != paddedWidth || texture.h != paddedHeight) {
+      printf("  FAIL: %s is %ux%u rather than %ux%u\n", name, texture.w, texture.h, paddedWidth, paddedHeight);
+      matches = false;
+    } else if (memcmp(texture.data, reference, paddedWidth * paddedHeight * 4) != 0) {
+      printf("  FAIL: %s differs from %s\n", name, path);
+      matches = false;
+    }
+    textureDestroy(&texture, buffer + offset);
+  }
+
+  free(buffer);
+  free(reference);
+  free(pixels);
+  if (!matches) {
+    imageTestFailures++;
+  }
+  return matches;
+}
+
+// Writes random pixels in the given format to the given path.
+static bool imageTestWrite(const struct ImageTestImage *image, const char *path) {
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    return false;
+  }
+  png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+  png_infop info = png_create_info_struct(png);
+  u8 *row = NULL;
+  if (setjmp(png_jmpbuf(png))) {
+    free(row);
+    png_destroy_write_struct(&png, &info);
+    fclose(file);
+    return false;
+  }
+
+  png_init_io(png, file);
+  png_set_IHDR(png, info, image->width, image->height, image->bitDepth, image->colorType, PNG_INTERLACE_NONE,
+               PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+  u32 channels = 1;
+  if (image->colorType == PNG_COLOR_TYPE_PALETTE) {
+    // Half of the palette is given transparency, so that it is expanded in to alpha.
+    png_color palette[16];
+    png_byte transparency[8];
+    u32 i;
+    for (i = 0; i < 16; i++) {
+      palette[i].red = imageTestRandom();
+      palette[i].green = imageTestRandom();
+      palette[i].blue = imageTestRandom();
+    }
+    for (i = 0; i < 8; i++) {
+      transparency[i] = imageTestRandom();
+    }
+    png_set_PLTE(png, info, palette, 16);
+    png_set_tRNS(png, info, transparency, 8, NULL);
+  } else {
+    channels = png_get_channels(png, info);
+  }
+  png_write_info(png, info);
+
+  u32 rowSize = image->width * channels * image->bitDepth / 8;
+  row = malloc(rowSize);
+  u32 y;
+  for (y = 0; y < image->height; y++) {
+    u32 i;
+    for (i = 0; i < rowSize; i++) {
+      row[i] = image->colorType == PNG_COLOR_TYPE_PALETTE ? imageTestRandom() % 16 : imageTestRandom();
+    }
+    png_write_row(png, row);
+  }
+  png_write_end(png, NULL);
+
+  free(row);
+  png_destroy_write_struct(&png, &info);
+  return fclose(file) == 0;
+}
+
+// Reads the whole of the given file, returning it or NULL.
+static u8 *imageTestRead(const char *path, u32 *length) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    return NULL;
+  }
+  fseek(file, 0, SEEK_END);
+  *length = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  u8 *data = malloc(*length);
+  if (data != NULL && fread(data, 1, *length, file) != *length) {
+    free(data);
+    data = NULL;
+  }
+  fclose(file);
+  return data;
+}
+
+// Writes the given image, bakes it with bakeimage and checks the result.
+static bool imageTestBake(const char *bakeimage, const struct ImageTestImage *image) {
+  char png[IMAGE_TEST_PATH_SIZE];
+  char tex[IMAGE_TEST_PATH_SIZE];
+  char command[IMAGE_TEST_PATH_SIZE * 3];
+  snprintf(png, sizeof(png), "%s/%s.png", IMAGE_TEST_DIRECTORY, image->name);
+  snprintf(tex, sizeof(tex), "%s/%s.tex", IMAGE_TEST_DIRECTORY, image->name);
+  snprintf(command, sizeof(command), "%s %s %s", bakeimage, png, tex);
+  u32 length;
+  u8 *data;
+  if (!imageTestWrite(image, png) || system(command) != 0 || (data = imageTestRead(tex, &length)) == NULL) {
+    printf("  FAIL: could not bake %s\n", png);
+    imageTestFailures++;
+    return false;
+  }
+  bool matches = imageTestCompare(image->name, png, data, length);
+  free(data);
+  return matches;
+}
+
+int main(int argc, char **argv) {
+  const char *bakeimage = argc > 1 ? argv[1] : "build/bakeimage";
+  const char *logo = argc > 2 ? argv[2] : "../images/osc.png";
+
+  bool logoMatches = imageTestCompare("osc.tex", logo, osc_tex, osc_tex_size);
+
+  mkdir(IMAGE_TEST_DIRECTORY, 0755);
+  u32 images = 0;
+  u32 i;
+  for (i = 0; i < IMAGE_TEST_IMAGES; i++) {
+    images += imageTestBake(bakeimage, &imageTestImages[i]);
+  }
+  printf("  logo %s, %u of %zu baked images match\n", logoMatches ? "matches" : "differs", images, IMAGE_TEST_IMAGES);
+
+  // What loading the logo costs, decoded and tiled at startup as before, and loaded in place.
+  double start = hostSeconds();
+  for (i = 0; i < IMAGE_TEST_LOADS; i++) {
+    u32 width;
+    u32 height;
+    u32 paddedWidth;
+    u32 paddedHeight;
+    u8 *pixels = imageTestDecode(logo, &width, &height);
+    free(imageTestTile(pixels, width, height, &paddedWidth, &paddedHeight));
+    free(pixels);
+  }
+  double decodeSeconds = (hostSeconds() - start) / IMAGE_TEST_LOADS;
+  start = hostSeconds();
+  for (i = 0; i < IMAGE_TEST_LOADS; i++) {
+    GRRLIB_texImg texture;
+    textureLoad(&texture, osc_tex, osc_tex_size);
+    textureDestroy(&texture, osc_tex);
+  }
+  double loadSeconds = (hostSeconds() - start) / IMAGE_TEST_LOADS;
+  printf("  logo load: %.1f us decoded and tiled, %.2f us baked\n", decodeSeconds * 1e6, loadSeconds * 1e6);
+
+  if (imageTestFailures > 0) {
+    printf("  %d failures\n", imageTestFailures);
+    return 1;
+  }
+  return 0;
+}
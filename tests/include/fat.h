@@ -0,0 +1,9 @@
+#pragma once
+
+// Host stand-in for libfat. Implemented by host/fat.c.
+
+#include <gccore.h>
+
+bool fatMount(const char *name, const DISC_INTERFACE *interface, sec_t startSector, u32 cacheSize,
+              u32 SectorsPerPage);
+void fatUnmount(const char *name);
@@ -0,0 +1,129 @@
+#pragma once
+
+// Host stand-in for libogc's gccore.h, declaring only what the downloader uses.
+// Implemented by host/ogc.c. See tests/Makefile.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+typedef float f32;
+typedef u32 sec_t;
+
+#define ATTRIBUTE_ALIGN(v) __attribute__((aligned(v)))
+
+#define RGBA(r, g, b, a) \
+  ((u32)((((u32)(r)) << 24) | ((((u32)(g)) & 0xFF) << 16) | ((((u32)(b)) & 0xFF) << 8) | (((u32)(a)) & 0xFF)))
+
+// ISFS
+#define ISFS_OPEN_READ 1
+#define ISFS_OPEN_WRITE 2
+#define ISFS_OPEN_RW (ISFS_OPEN_READ | ISFS_OPEN_WRITE)
+
+#define ISFS_OK 0
+#define ISFS_EINVAL -4
+#define ISFS_ENOENT -106
+
+typedef struct {
+  u32 file_length;
+  u32 file_pos;
+} fstats;
+
+s32 ISFS_Initialize(void);
+s32 ISFS_Deinitialize(void);
+s32 ISFS_Open(const char *filepath, u8 mode);
+s32 ISFS_Close(s32 fd);
+s32 ISFS_Read(s32 fd, void *buffer, u32 length);
+s32 ISFS_Write(s32 fd, const void *buffer, u32 length);
+s32 ISFS_Seek(s32 fd, s32 where, s32 whence);
+s32 ISFS_GetFileStats(s32 fd, fstats *status);
+s32 ISFS_Delete(const char *filepath);
+s32 ISFS_CreateFile(const char *filepath, u8 attributes, u8 owner_perm, u8 group_perm, u8 other_perm);
+s32 ISFS_GetAttr(const char *filepath, u32 *ownerID, u16 *groupID, u8 *attributes, u8 *ownerperm, u8 *groupperm,
+                 u8 *otherperm);
+s32 ISFS_SetAttr(const char *filepath, u32 ownerID, u16 groupID, u8 attributes, u8 ownerperm, u8 groupperm,
+                 u8 otherperm);
+
+// ES
+typedef u32 signed_blob;
+
+typedef struct {
+  u32 cid;
+  u16 index;
+  u16 type;
+  u64 size;
+  u8 hash[20];
+} __attribute__((packed)) tmd_content;
+
+typedef struct {
+  u8 header[0xa4];
+  tmd_content contents[];
+} __attribute__((packed)) tmd;
+
+#define SIGNATURE_PAYLOAD(x) ((void *)(((u8 *)(x)) + 0x140))
+
+// WII
+s32 WII_Initialize(void);
+s32 WII_LaunchTitleWithArgs(u64 titleID, int launchcode, ...);
+
+// VIDEO
+void VIDEO_WaitVSync(void);
+void VIDEO_SetBlack(bool black);
+
+// Cache
+void DCFlushRange(void *startaddress, u32 len);
+void DCInvalidateRange(void *startaddress, u32 len);
+
+// LWP
+typedef u32 lwp_t;
+typedef u32 mutex_t;
+typedef u32 cond_t;
+typedef u32 sem_t;
+
+#define LWP_THREAD_NULL 0xffffffff
+#define LWP_PRIO_HIGHEST 127
+
+s32 LWP_CreateThread(lwp_t *thethread, void *(*entry)(void *), void *arg, void *stackbase, u32 stack_size, u8 prio);
+s32 LWP_JoinThread(lwp_t thethread, void **value_ptr);
+lwp_t LWP_GetSelf(void);
+void LWP_YieldThread(void);
+
+s32 LWP_MutexInit(mutex_t *mutex, bool use_recursive);
+s32 LWP_MutexDestroy(mutex_t mutex);
+s32 LWP_MutexLock(mutex_t mutex);
+s32 LWP_MutexUnlock(mutex_t mutex);
+
+s32 LWP_SemInit(sem_t *sem, u32 start, u32 max);
+s32 LWP_SemDestroy(sem_t sem);
+s32 LWP_SemWait(sem_t sem);
+s32 LWP_SemPost(sem_t sem);
+
+// SYS
+u32 SYS_GetArena1Size(void);
+void *SYS_GetArena1Lo(void);
+void *SYS_GetArena1Hi(void);
+void SYS_SetArena1Hi(void *newHi);
+u32 SYS_GetArena2Size(void);
+void *SYS_GetArena2Lo(void);
+void *SYS_GetArena2Hi(void);
+void SYS_SetArena2Hi(void *newHi);
+
+// DISC_INTERFACE, as used by libfat.
+typedef struct DISC_INTERFACE_STRUCT {
+  unsigned long ioType;
+  unsigned long features;
+  bool (*startup)(void);
+  bool (*isInserted)(void);
+  bool (*readSectors)(sec_t sector, sec_t numSectors, void *buffer);
+  bool (*writeSectors)(sec_t sector, sec_t numSectors, const void *buffer);
+  bool (*clearStatus)(void);
+  bool (*shutdown)(void);
+} DISC_INTERFACE;
@@ -0,0 +1,39 @@
+#pragma once
+
+// Host stand-in for GRRLIB. Nothing is drawn, though draws are counted. Implemented by host/grrlib.c.
+
+#include <gccore.h>
+
+typedef struct GRRLIB_texImg {
+  u32 w;
+  u32 h;
+  int handlex;
+  int handley;
+  int offsetx;
+  int offsety;
+  bool tiledtex;
+  u32 tilew;
+  u32 tileh;
+  u32 nbtilew;
+  u32 nbtileh;
+  u32 tilestart;
+  f32 ofnormaltexx;
+  f32 ofnormaltexy;
+  void *data;
+} GRRLIB_texImg;
+
+void GRRLIB_Init(void);
+void GRRLIB_Exit(void);
+void GRRLIB_Render(void);
+void GRRLIB_SetBackgroundColour(u8 r, u8 g, u8 b, u8 a);
+
+GRRLIB_texImg *GRRLIB_CreateEmptyTexture(u32 w, u32 h);
+void GRRLIB_FreeTexture(GRRLIB_texImg *tex);
+void GRRLIB_FlushTex(GRRLIB_texImg *tex);
+
+void GRRLIB_Rectangle(f32 x, f32 y, f32 width, f32 height, u32 color, bool filled);
+void GRRLIB_DrawImg(f32 xpos, f32 ypos, const GRRLIB_texImg *tex, f32 degrees, f32 scaleX, f32 scaleY, u32 color);
+void GRRLIB_DrawPart(f32 xpos, f32 ypos, f32 partx, f32 party, f32 partw, f32 parth, const GRRLIB_texImg *tex,
+                     f32 degrees, f32 scaleX, f32 scaleY, u32 color);
+
+void GX_InvalidateTexAll(void);
@@ -0,0 +1,22 @@
+#pragma once
+
+// Host stand-in for libogc's heap. Implemented by host/ogc.c.
+
+#include <gccore.h>
+
+typedef struct {
+  void *state;
+  u32 reserved[15];
+} heap_cntrl;
+
+typedef struct {
+  u32 free_blocks;
+  u32 free_size;
+  u32 used_blocks;
+  u32 used_size;
+} heap_iblock;
+
+u32 __lwp_heap_init(heap_cntrl *theheap, void *start_addr, u32 size, u32 pg_size);
+void *__lwp_heap_allocate(heap_cntrl *theheap, u32 size);
+bool __lwp_heap_free(heap_cntrl *theheap, void *ptr);
+u32 __lwp_heap_getinfo(heap_cntrl *theheap, heap_iblock *theinfo);
@@ -0,0 +1,15 @@
+#pragma once
+
+// Host stand-in for libogc's timebase. gettime() counts at the console's timebase frequency.
+
+#include <gccore.h>
+
+#define TB_TIMER_CLOCK 60750
+
+#define ticks_to_microsecs(ticks) ((((u64)(ticks) * 8) / (u64)(TB_TIMER_CLOCK / 125)))
+#define ticks_to_millisecs(ticks) (((u64)(ticks) / (u64)(TB_TIMER_CLOCK)))
+#define microsecs_to_ticks(usec) (((u64)(usec) * (TB_TIMER_CLOCK / 125)) / 8)
+#define millisecs_to_ticks(msec) ((u64)(msec) * (u64)(TB_TIMER_CLOCK))
+
+u64 gettime(void);
+u32 diff_usec(u64 start, u64 end);
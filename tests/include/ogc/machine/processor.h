@@ -0,0 +1,12 @@
+#pragma once
+
+// Host stand-in for libogc's interrupt control. Disabling interrupts on the console excludes every
+// other thread, so here it takes a single process-wide recursive lock instead. See host/ogc.c.
+
+#include <gccore.h>
+
+u32 hostIsrDisable(void);
+void hostIsrRestore(u32 level);
+
+#define _CPU_ISR_Disable(_isr_cookie) ((_isr_cookie) = hostIsrDisable())
+#define _CPU_ISR_Restore(_isr_cookie) hostIsrRestore(_isr_cookie)
@@ -0,0 +1,6 @@
+#pragma once
+
+// Host stand-in for newlib's reent.h. Each host thread has its own struct _reent, as under newlib.
+// See host/alloc.c.
+
+struct _reent;
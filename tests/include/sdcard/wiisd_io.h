@@ -0,0 +1,7 @@
+#pragma once
+
+// Host stand-in for libogc's front SD interface. See host/fat.c.
+
+#include <gccore.h>
+
+extern const DISC_INTERFACE __io_wiisd;
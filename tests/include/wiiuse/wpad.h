@@ -0,0 +1,11 @@
+#pragma once
+
+// Host stand-in for WPAD. HOME is always reported as pressed. See host/grrlib.c.
+
+#include <gccore.h>
+
+#define WPAD_BUTTON_HOME 0x0080
+
+s32 WPAD_Init(void);
+s32 WPAD_ScanPads(void);
+u32 WPAD_ButtonsDown(int chan);
@@ -0,0 +1,247 @@
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "host/host.h"
+#include "extract.h"
+#include "journal.h"
+#include "main.h"
+#include "manifest.h"
+#include "package.h"
+#include "region.h"
+#include "trace.h"
+
+// Interrupts installs at random points, as a power loss would, and checks that relaunching
+// resumes them to a complete and correct install.
+//
+// Each launch takes place in a child process, installing a package as extractPackage() in
+// main.c does. The child is killed after a random delay, then launched again, until a launch
+// finishes. The files installed are then checked against the package, and the journal must
+// have been removed. At least one launch must have resumed entries rather than starting over.
+// Entries resumed are trusted without touching the card, so the manifest must still give every
+// file the modification time it has, as recorded by the journal.
+//
+// Usage: journal_test [corpus directory] [corpus...]
+
+#define JOURNAL_TEST_PATH_SIZE 1024
+#define JOURNAL_TEST_ROUNDS 3
+#define JOURNAL_TEST_MAX_LAUNCHES 64
+
+#define JOURNAL_TEST_TITLE_ID 0x000100014F534331ULL
+#define JOURNAL_TEST_PACKAGE "/package.app"
+
+static u64 journalTestState = 0x4A524E4C;
+
+static u32 journalTestRandom() {
+  journalTestState ^= journalTestState << 13;
+  journalTestState ^= journalTestState >> 7;
+  journalTestState ^= journalTestState << 17;
+  return (u32)(journalTestState >> 16);
+}
+
+// Installs the package as extractPackage() does, reporting the amount of entries the
+// journal recorded as finished through the given pipe. Does not return.
+static void journalTestLaunch(int report) {
+  regionInit();
+  TRACE_INIT();
+  TRACE_THREAD("main");
+
+  static struct Extractor extractor;
+  static struct Package package;
+  static struct Journal journal;
+  if (!extractorInit(&extractor) || !packageOpen(&package, JOURNAL_TEST_TITLE_ID, JOURNAL_TEST_PACKAGE)) {
+    printf("  %s: %s\n", errorCode, errorMessage);
+    _exit(2);
+  }
+  u32 entryCount = mz_zip_reader_get_num_files(&package.zip);
+  if (!journalOpen(&journal, package.titleId, package.centralDirCrc32, entryCount)) {
+    printf("  %s: %s\n", errorCode, errorMessage);
+    _exit(2);
+  }
+
+  u32 resumed = 0;
+  u32 i;
+  for (i = 0; i < entryCount; i++) {
+    resumed += journalIsDone(&journal, i);
+  }
+  if (write(report, &resumed, sizeof(resumed)) != sizeof(resumed)) {
+    _exit(2);
+  }
+
+  char manifestPath[MANIFEST_PATH_SIZE];
+  manifestGetPath(manifestPath, package.titleId);
+  if (!extractorLoad(&extractor, &package.zip, manifestPath, &journal) || !extractorStart(&extractor) ||
+      !extractorWait(&extractor)) {
+    printf("  %s: %s\n", errorCode, errorMessage);
+    journalClose(&journal);
+    _exit(2);
+  }
+  extractorUnload(&extractor);
+  journalRemove(&journal);
+  packageClose(&package);
+  _exit(0);
+}
+
+// Launches a child, killing it after the given delay unless zero.
+// Returns whether it finished, setting resumed to what it reported. Exits upon failure.
+static bool journalTestRun(useconds_t delay, u32 *resumed) {
+  int report[2];
+  if (pipe(report) < 0) {
+    exit(1);
+  }
+  fflush(stdout);
+  pid_t child = fork();
+  if (child < 0) {
+    exit(1);
+  }
+  if (child == 0) {
+    close(report[0]);
+    journalTestLaunch(report[1]);
+  }
+  close(report[1]);
+
+  if (delay > 0) {
+    usleep(delay);
+    kill(child, SIGKILL);
+  }
+  int status;
+  waitpid(child, &status, 0);
+  *resumed = 0;
+  if (read(report[0], resumed, sizeof(*resumed)) != sizeof(*resumed)) {
+    *resumed = 0;
+  }
+  close(report[0]);
+
+  if (WIFEXITED(status) && WEXITSTATUS(status) != 0) {
+    printf("  FAIL: launch exited with %d\n", WEXITSTATUS(status));
+    exit(1);
+  }
+  return WIFEXITED(status);
+}
+
+// Prepares fresh NAND and storage directories holding the given package.
+static void journalTestPrepare(const char *work, const char *archive) {
+  char nand[JOURNAL_TEST_PATH_SIZE];
+  char fat[JOURNAL_TEST_PATH_SIZE];
+  char package[JOURNAL_TEST_PATH_SIZE];
+  char data[JOURNAL_TEST_PATH_SIZE];
+  snprintf(nand, sizeof(nand), "%s/nand", work);
+  snprintf(fat, sizeof(fat), "%s/fat", work);
+  snprintf(package, sizeof(package), "%s%s", nand, JOURNAL_TEST_PACKAGE);
+  snprintf(data, sizeof(data), "%s%s", fat, OSC_DATA_PATH + strlen("fat:"));
+  if (!hostRemoveTree(work) || !hostMakeDirs(nand) || !hostMakeDirs(data) || !hostCopyFile(archive, package)) {
+    printf("  could not prepare %s\n", work);
+    exit(1);
+  }
+}
+
+static int journalTestFailures;
+
+// Returns the amount of files of the given archive whose modification time differs from the
+// one given by the title's manifest, printing each.
+static u32 journalTestCheckManifest(const char *archive, const char *fat) {
+  char manifestPath[MANIFEST_PATH_SIZE];
+  struct Manifest manifest;
+  manifestGetPath(manifestPath, JOURNAL_TEST_TITLE_ID);
+  manifestLoad(&manifest, manifestPath);
+
+  mz_zip_archive zip;
+  memset(&zip, 0, sizeof(zip));
+  if (!mz_zip_reader_init_file(&zip, archive, 0)) {
+    manifestDestroy(&manifest);
+    return 1;
+  }
+  u32 bad = 0;
+  u32 i;
+  for (i = 0; i < mz_zip_reader_get_num_files(&zip); i++) {
+    mz_zip_archive_file_stat fileStat;
+    if (!mz_zip_reader_file_stat(&zip, i, &fileStat) || fileStat.m_is_directory) {
+      continue;
+    }
+    char path[JOURNAL_TEST_PATH_SIZE];
+    struct stat stats;
+    snprintf(path, sizeof(path), "%s/%s", fat, fileStat.m_filename);
+    const struct ManifestEntry *entry = manifestFind(&manifest, fileStat.m_filename);
+    if (entry == NULL || stat(path, &stats) != 0 || entry->mtime != stats.st_mtime) {
+      printf("  %s: modification time not within the manifest\n", fileStat.m_filename);
+      bad++;
+    }
+  }
+  mz_zip_reader_end(&zip);
+  manifestDestroy(&manifest);
+  return bad;
+}
+
+static void journalTestCorpus(const char *directory, const char *corpus) {
+  char archive[JOURNAL_TEST_PATH_SIZE];
+  char work[JOURNAL_TEST_PATH_SIZE];
+  static char nand[JOURNAL_TEST_PATH_SIZE];
+  static char fat[JOURNAL_TEST_PATH_SIZE];
+  char journal[JOURNAL_TEST_PATH_SIZE];
+  snprintf(archive, sizeof(archive), "%s/%s.zip", directory, corpus);
+  snprintf(work, sizeof(work), "%s/journal", directory);
+  snprintf(nand, sizeof(nand), "%s/nand", work);
+  snprintf(fat, sizeof(fat), "%s/fat", work);
+  snprintf(journal, sizeof(journal), "%s%s", fat, JOURNAL_PATH + strlen("fat:"));
+  hostSetRoots(nand, fat);
+
+  // An uninterrupted launch gives the range of delays to interrupt at.
+  journalTestPrepare(work, archive);
+  u32 resumed;
+  double start = hostSeconds();
+  journalTestRun(0, &resumed);
+  useconds_t duration = (hostSeconds() - start) * 1e6;
+
+  u32 round;
+  for (round = 0; round < JOURNAL_TEST_ROUNDS; round++) {
+    journalTestPrepare(work, archive);
+    u32 launches = 0;
+    u32 mostResumed = 0;
+    bool finished = false;
+    while (!finished && launches < JOURNAL_TEST_MAX_LAUNCHES) {
+      // Interrupt every launch but the last allowed, which finishes.
+      useconds_t delay = 0;
+      if (launches + 1 < JOURNAL_TEST_MAX_LAUNCHES) {
+        delay = duration / 8 + journalTestRandom() % (duration / 2);
+      }
+      finished = journalTestRun(delay, &resumed);
+      if (resumed > mostResumed) {
+        mostResumed = resumed;
+      }
+      launches++;
+    }
+
+    struct stat stats;
+    u32 bad = hostVerifyExtraction(archive, fat) + journalTestCheckManifest(archive, fat);
+    bool journalLeft = stat(journal, &stats) == 0;
+    bool passed = bad == 0 && !journalLeft && (launches == 1 || mostResumed > 0);
+    printf("  %s round %u: %u launches, at most %u entries resumed%s\n", corpus, round + 1, launches, mostResumed,
+           passed ? "" : ", FAIL");
+    if (journalLeft) {
+      printf("  FAIL: the journal was not removed\n");
+    }
+    journalTestFailures += !passed;
+  }
+}
+
+int main(int argc, char **argv) {
+  const char *directory = argc > 1 ? argv[1] : "build/corpus";
+  if (argc > 2) {
+    int i;
+    for (i = 2; i < argc; i++) {
+      journalTestCorpus(directory, argv[i]);
+    }
+  } else {
+    journalTestCorpus(directory, "deep");
+    journalTestCorpus(directory, "app");
+  }
+  if (journalTestFailures > 0) {
+    printf("  %d failures\n", journalTestFailures);
+    return 1;
+  }
+  return 0;
+}
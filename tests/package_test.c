@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host/host.h"
+#include "main.h"
+#include "manifest.h"
+#include "miniz.h"
+#include "package.h"
+#include "region.h"
+#include "trace.h"
+
+// Checks how packageOpen decides whether an empty content was nullified by an earlier launch.
+//
+// The title's TMD alone decides this. An empty content is only skipped should the TMD show it as
+// nullified, being empty with the hash of an empty file. An empty content the TMD still expects
+// to hold an archive must fail to open, even though a manifest remains from an earlier install,
+// whether the package is opened at once or in the background.
+//
+// Usage: package_test [work directory]
+
+#define PACKAGE_TEST_PATH_SIZE 1024
+#define PACKAGE_TEST_TITLE_ID 0x000100014f534331ULL
+#define PACKAGE_TEST_CONTENT "/title/00010001/4f534331/content/00000000.app"
+#define PACKAGE_TEST_TMD "/title/00010001/4f534331/content/title.tmd"
+#define PACKAGE_TEST_TMD_SIZE 520
+
+static int packageTestFailures;
+
+static void packageTestExpect(bool condition, const char *what) {
+  if (!condition) {
+    printf("  FAIL: %s\n", what);
+    packageTestFailures++;
+  }
+}
+
+static char packageTestNand[PACKAGE_TEST_PATH_SIZE];
+static char packageTestFat[PACKAGE_TEST_PATH_SIZE];
+
+// Writes the given content to NAND, along with a TMD giving its content the given size and hash.
+// No TMD is written should hash be NULL.
+static void packageTestPrepare(const void *content, size_t length, u64 size, const u8 *hash) {
+  char path[PACKAGE_TEST_PATH_SIZE];
+  snprintf(path, sizeof(path), "%s%s", packageTestNand, PACKAGE_TEST_CONTENT);
+  hostWriteFile(path, content, length);
+
+  snprintf(path, sizeof(path), "%s%s", packageTestNand, PACKAGE_TEST_TMD);
+  remove(path);
+  if (hash == NULL) {
+    return;
+  }
+  static u8 data[PACKAGE_TEST_TMD_SIZE] ATTRIBUTE_ALIGN(32);
+  memset(data, 0, sizeof(data));
+  tmd *titleTmd = SIGNATURE_PAYLOAD((signed_blob *)data);
+  titleTmd->contents[0].size = size;
+  memcpy(titleTmd->contents[0].hash, hash, sizeof(titleTmd->contents[0].hash));
+  hostWriteFile(path, data, sizeof(data));
+}
+
+// Opens the package prepared, at once or in the background, returning whether it opened.
+// Should it open, whether it was nullified is given.
+static bool packageTestOpen(bool prefetch, bool *nullified) {
+  static struct Package package;
+  errorCode[0] = '\0';
+  bool opened;
+  if (prefetch) {
+    packagePrefetch(&package, PACKAGE_TEST_TITLE_ID, PACKAGE_TEST_CONTENT);
+    opened = packageWait(&package);
+  } else {
+    opened = packageOpen(&package, PACKAGE_TEST_TITLE_ID, PACKAGE_TEST_CONTENT);
+  }
+  if (opened) {
+    *nullified = package.nullified;
+    packageClose(&package);
+  }
+  return opened;
+}
+
+int main(int argc, char **argv) {
+  const char *work = argc > 1 ? argv[1] : "build/package";
+  snprintf(packageTestNand, sizeof(packageTestNand), "%s/nand", work);
+  snprintf(packageTestFat, sizeof(packageTestFat), "%s/fat", work);
+  hostRemoveTree(work);
+  hostMakeDirs(packageTestNand);
+  hostMakeDirs(packageTestFat);
+  hostSetRoots(packageTestNand, packageTestFat);
+  regionInit();
+  TRACE_INIT();
+
+  // A manifest remains from an earlier install of the title.
+  char manifestPath[MANIFEST_PATH_SIZE];
+  char path[PACKAGE_TEST_PATH_SIZE];
+  manifestGetPath(manifestPath, PACKAGE_TEST_TITLE_ID);
+  snprintf(path, sizeof(path), "%s%s", packageTestFat, manifestPath + strlen("fat:"));
+  static const char manifest[] = "apps/osc/boot.dol\n";
+  hostWriteFile(path, manifest, strlen(manifest));
+
+  // An archive, as the shop channel leaves it.
+  size_t archiveLength = 0;
+  void *archive = NULL;
+  mz_zip_archive zip;
+  memset(&zip, 0, sizeof(zip));
+  static const char boot[] = "boot";
+  if (!mz_zip_writer_init_heap(&zip, 0, 0) ||
+      !mz_zip_writer_add_mem(&zip, "apps/osc/boot.dol", boot, strlen(boot), MZ_DEFAULT_COMPRESSION) ||
+      !mz_zip_writer_finalize_heap_archive(&zip, &archive, &archiveLength)) {
+    printf("  could not create an archive\n");
+    return 1;
+  }
+  mz_zip_writer_end(&zip);
+
+  static const u8 archiveHash[20] = {0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef, 0x01, 0x23,
+                                     0x45, 0x67, 0x89, 0xab, 0xcd, 0xef, 0x01, 0x23, 0x45, 0x67};
+  int prefetch;
+  for (prefetch = 0; prefetch < 2; prefetch++) {
+    bool nullified = false;
+
+    // An archive the TMD expects is opened, and is not nullified.
+    packageTestPrepare(archive, archiveLength, archiveLength, archiveHash);
+    packageTestExpect(packageTestOpen(prefetch, &nullified) && !nullified, "an archive was not opened");
+
+    // An empty content the TMD shows as nullified is skipped.
+    packageTestPrepare(NULL, 0, 0, EMPTY_SHA1_HASH);
+    packageTestExpect(packageTestOpen(prefetch, &nullified) && nullified,
+                      "a content nullified by its TMD was not skipped");
+
+    // An empty content the TMD still expects to hold an archive fails, despite the manifest.
+    packageTestPrepare(NULL, 0, archiveLength, archiveHash);
+    packageTestExpect(!packageTestOpen(prefetch, &nullified) && strcmp(errorCode, "ZIP_OPEN_FAILED") == 0,
+                      "an empty content expected to hold an archive was skipped");
+
+    // So does one the TMD gives as empty without the hash of an empty file.
+    packageTestPrepare(NULL, 0, 0, archiveHash);
+    packageTestExpect(!packageTestOpen(prefetch, &nullified) && strcmp(errorCode, "ZIP_OPEN_FAILED") == 0,
+                      "an empty content with the hash of an archive was skipped");
+
+    // And one whose TMD could not be read.
+    packageTestPrepare(NULL, 0, 0, NULL);
+    packageTestExpect(!packageTestOpen(prefetch, &nullified) && strcmp(errorCode, "ZIP_OPEN_FAILED") == 0,
+                      "an empty content without a TMD was skipped");
+  }
+  free(archive);
+
+  hostRemoveTree(work);
+  if (packageTestFailures > 0) {
+    printf("  %d failures\n", packageTestFailures);
+    return 1;
+  }
+  return 0;
+}
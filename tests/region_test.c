@@ -0,0 +1,213 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "host/host.h"
+#include "extract.h"
+#include "main.h"
+#include "region.h"
+#include "trace.h"
+
+// Checks how regionInit chooses a plan from the arenas available, and where buffers are placed.
+//
+// The largest plan whose budgets are within 1/REGION_ARENA_SHARE of both arenas must be chosen,
+// lowering either arena just below a plan's need choosing the next. The buffers of an extractor
+// and two package windows must fit the budgets of every plan, those touched per byte within MEM1
+// and the rest within MEM2. Allocations beyond a region's budget, or within a region too small to
+// be reserved, must fall back to the heap and be counted as such.
+//
+// The arenas are those of host/ogc.c, lowered before each regionInit. Built with MEMORY_TIER,
+// only the placement of the plan forced is checked.
+//
+// Usage: region_test [work directory]
+
+#define REGION_TEST_PATH_SIZE 1024
+
+static int regionTestFailures;
+
+static void regionTestExpect(bool condition, const char *what) {
+  if (!condition) {
+    printf("  FAIL: %s\n", what);
+    regionTestFailures++;
+  }
+}
+
+// The plans of region.c, from largest to smallest.
+static const char *regionTestPlans[] = {"large", "default", "small"};
+#define REGION_TEST_PLAN_COUNT (sizeof(regionTestPlans) / sizeof(regionTestPlans[0]))
+
+// The size of each arena before any was lowered.
+static u32 regionTestArenaSizes[REGION_COUNT];
+
+// Gives each arena the given size from its bottom, then chooses a plan.
+static const struct RegionPlan *regionTestInit(u32 mem1Size, u32 mem2Size) {
+  SYS_SetArena1Hi((u8 *)SYS_GetArena1Lo() + mem1Size);
+  SYS_SetArena2Hi((u8 *)SYS_GetArena2Lo() + mem2Size);
+  regionInit();
+  return regionGetPlan();
+}
+
+// Returns the index of the given plan within regionTestPlans.
+static u32 regionTestPlanIndex(const struct RegionPlan *plan) {
+  u32 i;
+  for (i = 0; i < REGION_TEST_PLAN_COUNT; i++) {
+    if (strcmp(plan->name, regionTestPlans[i]) == 0) {
+      break;
+    }
+  }
+  return i;
+}
+
+// Returns whether the given allocation lies within the budget reserved for the given region,
+// at the top of its arena.
+static bool regionTestWithin(enum Region region, const void *pointer) {
+  struct RegionStats stats;
+  regionGetStats(region, &stats);
+  const u8 *start = region == REGION_MEM1 ? SYS_GetArena1Hi() : SYS_GetArena2Hi();
+  const u8 *p = pointer;
+  return stats.budget > 0 && p >= start && p < start + stats.budget;
+}
+
+// Returns whether the given plan's budgets are within our share of the arenas it was chosen from.
+static bool regionTestWithinShare(const struct RegionPlan *plan) {
+  return plan->budgets[REGION_MEM1] <= plan->arenaSizes[REGION_MEM1] / REGION_ARENA_SHARE &&
+         plan->budgets[REGION_MEM2] <= plan->arenaSizes[REGION_MEM2] / REGION_ARENA_SHARE;
+}
+
+// Lowers the given arena to just below the need of every plan in turn, each time expecting the next plan.
+static void regionTestDescend(enum Region region) {
+  u32 sizes[REGION_COUNT] = {regionTestArenaSizes[REGION_MEM1], regionTestArenaSizes[REGION_MEM2]};
+  const struct RegionPlan *plan = regionTestInit(sizes[REGION_MEM1], sizes[REGION_MEM2]);
+  u32 index;
+  for (index = 0; index + 1 < REGION_TEST_PLAN_COUNT; index++) {
+    regionTestExpect(regionTestPlanIndex(plan) == index, "a larger plan was not chosen while it fit");
+
+    // The arena holding exactly our share of the plan's budget still fits it.
+    sizes[region] = plan->budgets[region] * REGION_ARENA_SHARE;
+    plan = regionTestInit(sizes[REGION_MEM1], sizes[REGION_MEM2]);
+    regionTestExpect(regionTestPlanIndex(plan) == index, "a plan was not chosen with exactly its share");
+
+    // Any less, and the next plan is chosen instead.
+    sizes[region] -= REGION_ALIGNMENT;
+    plan = regionTestInit(sizes[REGION_MEM1], sizes[REGION_MEM2]);
+    regionTestExpect(regionTestWithinShare(plan), "a plan exceeding its share was chosen");
+  }
+  regionTestExpect(regionTestPlanIndex(plan) == REGION_TEST_PLAN_COUNT - 1, "the smallest plan was not reached");
+
+  // The smallest plan is chosen should no plan fit.
+  sizes[region] = plan->budgets[region];
+  plan = regionTestInit(sizes[REGION_MEM1], sizes[REGION_MEM2]);
+  regionTestExpect(regionTestPlanIndex(plan) == REGION_TEST_PLAN_COUNT - 1,
+                   "the smallest plan was not chosen while no plan fit");
+}
+
+// Allocates the buffers of an extractor and two package windows under the plan chosen for the
+// given arena sizes, expecting every one of them within its region.
+static void regionTestPlacement(u32 mem1Size, u32 mem2Size) {
+  const struct RegionPlan *plan = regionTestInit(mem1Size, mem2Size);
+  static struct Extractor extractor;
+  regionTestExpect(extractorInit(&extractor), "an extractor could not be allocated");
+  void *windows[2];
+  windows[0] = regionAlloc(REGION_MEM2, plan->windowSize);
+  windows[1] = regionAlloc(REGION_MEM2, plan->windowSize);
+
+  regionTestExpect(regionTestWithin(REGION_MEM1, extractor.dict), "the inflate dictionary is not within MEM1");
+  regionTestExpect(regionTestWithin(REGION_MEM1, extractor.writer.buffer), "the FatWriter's buffer is not within MEM1");
+  regionTestExpect(regionTestWithin(REGION_MEM2, extractor.hashBuffer), "the hash buffer is not within MEM2");
+  regionTestExpect(regionTestWithin(REGION_MEM2, extractor.compressed.blocks[0].data) &&
+                       regionTestWithin(REGION_MEM2, extractor.decompressed.blocks[0].data),
+                   "the blocks are not within MEM2");
+  regionTestExpect(regionTestWithin(REGION_MEM2, windows[0]) && regionTestWithin(REGION_MEM2, windows[1]),
+                   "the package windows are not within MEM2");
+
+  struct RegionStats stats[REGION_COUNT];
+  u32 region;
+  for (region = 0; region < REGION_COUNT; region++) {
+    regionGetStats(region, &stats[region]);
+    regionTestExpect(stats[region].budget == plan->budgets[region], "a region was not reserved its budget");
+    regionTestExpect(stats[region].fallbacks == 0, "a buffer did not fit within its plan's budget");
+  }
+  printf("  %-8s MEM1 %6u of %6u bytes, MEM2 %7u of %7u bytes\n", plan->name, stats[REGION_MEM1].peak,
+         stats[REGION_MEM1].budget, stats[REGION_MEM2].peak, stats[REGION_MEM2].budget);
+
+  regionFree(windows[0]);
+  regionFree(windows[1]);
+  extractorDestroy(&extractor);
+  regionGetStats(REGION_MEM2, &stats[REGION_MEM2]);
+  regionTestExpect(stats[REGION_MEM2].used == 0, "a freed buffer remained in use");
+}
+
+int main(int argc, char **argv) {
+  const char *work = argc > 1 ? argv[1] : "build/region";
+  char nand[REGION_TEST_PATH_SIZE];
+  char fat[REGION_TEST_PATH_SIZE];
+  snprintf(nand, sizeof(nand), "%s/nand", work);
+  snprintf(fat, sizeof(fat), "%s/fat", work);
+  hostRemoveTree(work);
+  hostMakeDirs(fat);
+  hostSetRoots(nand, fat);
+  regionTestArenaSizes[REGION_MEM1] = SYS_GetArena1Size();
+  regionTestArenaSizes[REGION_MEM2] = SYS_GetArena2Size();
+  TRACE_INIT();
+
+  // MEMORY_TIER forces a plan, whatever the arenas.
+#ifdef REGION_TIER
+  bool forced = true;
+#else
+  bool forced = false;
+#endif
+  if (forced) {
+    regionTestPlacement(regionTestArenaSizes[REGION_MEM1], regionTestArenaSizes[REGION_MEM2]);
+  } else {
+    // Each arena alone decides the plan, once too small for the larger.
+    const struct RegionPlan *plan =
+        regionTestInit(regionTestArenaSizes[REGION_MEM1], regionTestArenaSizes[REGION_MEM2]);
+    regionTestExpect(regionTestPlanIndex(plan) == 0 && regionTestWithinShare(plan),
+                     "the largest plan was not chosen for a console's arenas");
+    regionTestDescend(REGION_MEM1);
+    regionTestDescend(REGION_MEM2);
+
+    // Each plan's buffers fit its budgets, as placed within each region.
+    u32 index;
+    for (index = 0; index < REGION_TEST_PLAN_COUNT; index++) {
+      u32 mem1Size = regionTestArenaSizes[REGION_MEM1];
+      while (regionTestPlanIndex(regionTestInit(mem1Size, regionTestArenaSizes[REGION_MEM2])) < index) {
+        mem1Size = regionGetPlan()->budgets[REGION_MEM1] * REGION_ARENA_SHARE - REGION_ALIGNMENT;
+      }
+      regionTestPlacement(mem1Size, regionTestArenaSizes[REGION_MEM2]);
+    }
+  }
+
+  // Allocations beyond a region's budget fall back to the heap, and the budget is reused once freed.
+  regionTestInit(regionTestArenaSizes[REGION_MEM1], regionTestArenaSizes[REGION_MEM2]);
+  struct RegionStats stats;
+  regionGetStats(REGION_MEM1, &stats);
+  void *first = regionAlloc(REGION_MEM1, stats.budget / 2);
+  void *second = regionAlloc(REGION_MEM1, stats.budget / 2);
+  regionTestExpect(regionTestWithin(REGION_MEM1, first), "an allocation within the budget was not placed within MEM1");
+  regionTestExpect(second != NULL && !regionTestWithin(REGION_MEM1, second) && ((uintptr_t)second % REGION_ALIGNMENT) == 0,
+                   "an allocation beyond the budget did not fall back to the heap");
+  regionFree(first);
+  void *third = regionAlloc(REGION_MEM1, stats.budget / 2);
+  regionTestExpect(regionTestWithin(REGION_MEM1, third), "a freed budget was not reused");
+  regionFree(second);
+  regionFree(third);
+  regionGetStats(REGION_MEM1, &stats);
+  regionTestExpect(stats.fallbacks == 1 && stats.used == 0, "a fallback was not counted");
+
+  // An arena too small for the plan's budget is not reserved, leaving every allocation to the heap.
+  regionTestInit(1024, regionTestArenaSizes[REGION_MEM2]);
+  void *buffer = regionAlloc(REGION_MEM1, 256);
+  regionGetStats(REGION_MEM1, &stats);
+  regionTestExpect(buffer != NULL && stats.budget == 0 && stats.fallbacks == 1 && !regionTestWithin(REGION_MEM1, buffer),
+                   "an arena too small was reserved");
+  regionFree(buffer);
+  regionTestExpect(SYS_GetArena1Size() == 1024, "an arena too small was lowered");
+
+  hostRemoveTree(work);
+  if (regionTestFailures > 0) {
+    printf("  %d failures\n", regionTestFailures);
+    return 1;
+  }
+  return 0;
+}
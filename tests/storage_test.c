@@ -0,0 +1,241 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "host/host.h"
+#include "ec_cfg.h"
+#include "main.h"
+#include "storage.h"
+#include "trace.h"
+
+// Checks how storageInit chooses a cache profile, and what it leaves on the device.
+//
+// A device without a remembered profile must be probed, and the fastest profile remembered
+// along with its throughput. A remembered profile, including one remembered before throughput
+// was, must be used as is without probing. Should the profile not be saved, the probe's scratch
+// files must not be left behind and the failure must be counted by the trace.
+//
+// Under the "fastest" policy, with the SD card and USB at roots of their own, the device
+// remembered as faster must be chosen, and a device whose throughput is unknown must be
+// measured, whether the profile is remembered or given by osc.cfg.
+//
+// Usage: storage_test [work directory]
+
+#define STORAGE_TEST_PATH_SIZE 1024
+
+static int storageTestFailures;
+
+static void storageTestExpect(bool condition, const char *what) {
+  if (!condition) {
+    printf("  FAIL: %s\n", what);
+    storageTestFailures++;
+  }
+}
+
+static char storageTestNand[STORAGE_TEST_PATH_SIZE];
+static char storageTestFat[STORAGE_TEST_PATH_SIZE];
+static char storageTestUsb[STORAGE_TEST_PATH_SIZE];
+
+// Whether USB was the device mounted by the last storageTestMount.
+static bool storageTestMountedUsb;
+
+// Returns the host path of the given "fat:" path on the SD card within the given buffer.
+static const char *storageTestPath(const char *path, char *buffer) {
+  snprintf(buffer, STORAGE_TEST_PATH_SIZE, "%s%s", storageTestFat, path + strlen("fat:"));
+  return buffer;
+}
+
+// Returns the host path of the given "fat:" path on USB within the given buffer.
+static const char *storageTestUsbPath(const char *path, char *buffer) {
+  snprintf(buffer, STORAGE_TEST_PATH_SIZE, "%s%s", storageTestUsb, path + strlen("fat:"));
+  return buffer;
+}
+
+// Reads the whole of the given host file in to the given buffer, returning false if it is absent.
+static bool storageTestReadHost(const char *hostPath, char *contents, size_t size) {
+  FILE *file = fopen(hostPath, "r");
+  if (file == NULL) {
+    return false;
+  }
+  size_t length = fread(contents, 1, size - 1, file);
+  contents[length] = '\0';
+  fclose(file);
+  return true;
+}
+
+// Reads the whole of the given "fat:" file on the SD card in to the given buffer, returning false if it is absent.
+static bool storageTestRead(const char *path, char *contents, size_t size) {
+  char hostPath[STORAGE_TEST_PATH_SIZE];
+  return storageTestReadHost(storageTestPath(path, hostPath), contents, size);
+}
+
+// Returns whether any of the probe's scratch files remain.
+static bool storageTestProbeFilesRemain() {
+  char hostPath[STORAGE_TEST_PATH_SIZE];
+  struct stat stats;
+  if (stat(storageTestPath(STORAGE_PROBE_PATH, hostPath), &stats) == 0) {
+    return true;
+  }
+  int i;
+  for (i = 0; i < STORAGE_PROBE_SMALL_FILES; i++) {
+    char path[64];
+    snprintf(path, sizeof(path), "%s.%d", STORAGE_PROBE_PATH, i);
+    if (stat(storageTestPath(path, hostPath), &stats) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Lays out a fresh SD card, holding the given profile should it not be NULL, and mounts whichever
+// device storageInit chooses. USB is only inserted should usbProfile not be NULL, holding it as
+// its profile unless it is empty. osc.cfg holds the given keys and values, each followed by a null,
+// should they not be NULL.
+static bool storageTestMount(const char *profile, const char *usbProfile, const char *config, size_t configLength) {
+  char path[STORAGE_TEST_PATH_SIZE];
+  hostRemoveTree(storageTestNand);
+  hostRemoveTree(storageTestFat);
+  hostRemoveTree(storageTestUsb);
+  hostMakeDirs(storageTestFat);
+  hostMakeDirs(storageTestUsb);
+  if (profile != NULL) {
+    hostWriteFile(storageTestPath(STORAGE_PROFILE_PATH, path), profile, strlen(profile));
+  }
+  if (usbProfile != NULL && usbProfile[0] != '\0') {
+    hostWriteFile(storageTestUsbPath(STORAGE_PROFILE_PATH, path), usbProfile, strlen(usbProfile));
+  }
+  hostSetInserted(true, usbProfile != NULL);
+
+  // osc.cfg holds null-terminated keys, each followed by its null-terminated value prefixed by "=".
+  static const char defaultConfig[] = "titleId\0=000100014f534331";
+  if (config == NULL) {
+    config = defaultConfig;
+    configLength = sizeof(defaultConfig);
+  }
+  snprintf(path, sizeof(path), "%s%s", storageTestNand, EC_CFG_PATH);
+  hostWriteFile(path, config, configLength);
+  if (ecInitCfg() < 0) {
+    printf("  could not load osc.cfg: %s\n", errorMessage);
+    return false;
+  }
+
+  bool mounted = storageInit();
+  storageTestMountedUsb = hostUsbMounted();
+  storageUnmount();
+  return mounted;
+}
+
+int main(int argc, char **argv) {
+  const char *work = argc > 1 ? argv[1] : "build/storage";
+  snprintf(storageTestNand, sizeof(storageTestNand), "%s/nand", work);
+  snprintf(storageTestFat, sizeof(storageTestFat), "%s/fat", work);
+  snprintf(storageTestUsb, sizeof(storageTestUsb), "%s/usb", work);
+  hostSetRoots(storageTestNand, storageTestFat);
+  hostSetUsbRoot(storageTestUsb);
+  TRACE_INIT();
+
+  char contents[256];
+  struct StorageProfile profile;
+  u32 cachePages;
+  u32 sectorsPerPage;
+  u32 throughput;
+
+  // A device seen for the first time is probed, and its fastest profile remembered with its throughput.
+  storageTestExpect(storageTestMount(NULL, NULL, NULL, 0), "a new device could not be mounted");
+  profile = storageGetProfile();
+  storageTestExpect(storageTestRead(STORAGE_PROFILE_PATH, contents, sizeof(contents)) &&
+                        sscanf(contents, "%u %u %u", &cachePages, &sectorsPerPage, &throughput) == 3 &&
+                        cachePages == profile.cachePages && sectorsPerPage == profile.sectorsPerPage &&
+                        throughput > 0,
+                    "a probed profile was not remembered along with its throughput");
+  storageTestExpect(!storageTestProbeFilesRemain(), "probing left its scratch files behind");
+  printf("  new device: probed %u pages of %u sectors at %u KiB/s\n", cachePages, sectorsPerPage, throughput);
+
+  // A remembered profile is used without probing, whether or not it holds a throughput.
+  static const char *remembered[] = {"8 128 2048\n", "16 64\n"};
+  u32 i;
+  for (i = 0; i < sizeof(remembered) / sizeof(remembered[0]); i++) {
+    storageTestExpect(storageTestMount(remembered[i], NULL, NULL, 0), "a remembered device could not be mounted");
+    profile = storageGetProfile();
+    sscanf(remembered[i], "%u %u", &cachePages, &sectorsPerPage);
+    storageTestExpect(profile.cachePages == cachePages && profile.sectorsPerPage == sectorsPerPage,
+                      "a remembered profile was not used");
+    storageTestExpect(storageTestRead(STORAGE_PROFILE_PATH, contents, sizeof(contents)) &&
+                          strcmp(contents, remembered[i]) == 0,
+                      "a remembered profile was probed again");
+  }
+
+  // A profile given by osc.cfg is used as is.
+  static const char config[] = "titleId\0=000100014f534331\0fatCachePages\0=32\0fatSectorsPerPage\0=16";
+  storageTestExpect(storageTestMount(NULL, NULL, config, sizeof(config)), "a configured device could not be mounted");
+  profile = storageGetProfile();
+  storageTestExpect(profile.cachePages == 32 && profile.sectorsPerPage == 16, "the configured profile was not used");
+
+  // Under "fastest", the device remembered as faster is chosen, even with a profile given by osc.cfg.
+  static const char fastest[] = "titleId\0=000100014f534331\0storageDevice\0=fastest";
+  static const char fastestConfig[] =
+      "titleId\0=000100014f534331\0storageDevice\0=fastest\0fatCachePages\0=32\0fatSectorsPerPage\0=16";
+  storageTestExpect(storageTestMount("4 64 1000\n", "8 64 5000\n", fastest, sizeof(fastest)) && storageTestMountedUsb,
+                    "the faster remembered device was not chosen");
+  storageTestExpect(storageTestMount("4 64 5000\n", "8 64 1000\n", fastestConfig, sizeof(fastestConfig)) &&
+                        !storageTestMountedUsb,
+                    "the faster remembered device was not chosen with a configured profile");
+  storageTestExpect(storageTestMount("4 64 1000\n", "8 64 5000\n", fastestConfig, sizeof(fastestConfig)) &&
+                        storageTestMountedUsb,
+                    "the faster remembered device was not chosen with a configured profile");
+
+  // A device whose throughput is unknown is measured once with the profile it is mounted with,
+  // which is remembered along with it. The throughput remembered by the other is left as is.
+  static const struct {
+    const char *usbProfile;
+    const char *config;
+    size_t configLength;
+    u32 cachePages;
+    u32 sectorsPerPage;
+  } unmeasured[] = {
+      {"", fastestConfig, sizeof(fastestConfig), 32, 16},
+      {"16 64\n", fastestConfig, sizeof(fastestConfig), 32, 16},
+      {"16 64\n", fastest, sizeof(fastest), 16, 64},
+  };
+  for (i = 0; i < sizeof(unmeasured) / sizeof(unmeasured[0]); i++) {
+    storageTestExpect(storageTestMount("4 64 1\n", unmeasured[i].usbProfile, unmeasured[i].config,
+                                       unmeasured[i].configLength),
+                      "a device of unknown throughput could not be mounted");
+    char usbPath[STORAGE_TEST_PATH_SIZE];
+    storageTestUsbPath(STORAGE_PROFILE_PATH, usbPath);
+    storageTestExpect(storageTestReadHost(usbPath, contents, sizeof(contents)) &&
+                          sscanf(contents, "%u %u %u", &cachePages, &sectorsPerPage, &throughput) == 3 &&
+                          cachePages == unmeasured[i].cachePages && sectorsPerPage == unmeasured[i].sectorsPerPage &&
+                          throughput > 0,
+                      "a device of unknown throughput was not measured with its profile");
+    storageTestExpect(storageTestRead(STORAGE_PROFILE_PATH, contents, sizeof(contents)) &&
+                          strcmp(contents, "4 64 1\n") == 0,
+                      "a device of known throughput was measured again");
+    storageTestExpect(storageTestMountedUsb, "the measured device was not chosen over a slower one");
+  }
+
+  // Should the profile not be saved, here as a directory stands in its place, the device is still
+  // mounted, and nothing of the probe is left behind.
+  char path[STORAGE_TEST_PATH_SIZE];
+  storageTestMount(NULL, NULL, NULL, 0);
+  hostRemoveTree(storageTestPath(STORAGE_PROFILE_PATH, path));
+  hostMakeDirs(path);
+  storageTestExpect(storageInit(), "a device whose profile could not be saved was not mounted");
+  storageUnmount();
+  storageTestExpect(!storageTestProbeFilesRemain(), "a failed save left the probe's scratch files behind");
+
+  // The failure is counted by the trace.
+  static char trace[64 * 1024];
+  TRACE_SAVE(TRACE_PATH);
+  storageTestExpect(storageTestRead(TRACE_PATH, trace, sizeof(trace)) &&
+                        strstr(trace, "\"profileSaveFailures\": 1") != NULL,
+                    "a failed save was not counted by the trace");
+
+  hostRemoveTree(work);
+  if (storageTestFailures > 0) {
+    printf("  %d failures\n", storageTestFailures);
+    return 1;
+  }
+  return 0;
+}
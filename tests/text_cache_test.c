@@ -0,0 +1,197 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host/host.h"
+#include "font.h"
+#include "text_cache.h"
+
+#include "LiberationSans-Regular_font.h"
+
+// Checks that text drawn through the text cache matches the glyphs it is made of,
+// and counts what drawing it costs per frame against drawing glyph by glyph.
+//
+// Each cached texture must hold the coverage of every glyph of its string, blended as drawing
+// them one by one would, at the position fontLayout gives them. A string already cached must
+// be drawn as a single quad without being rendered or flushed again, and the entry drawn
+// least recently must be the one replaced.
+
+#define TEXT_CACHE_TEST_WIDTH 640
+#define TEXT_CACHE_TEST_HEIGHT 64
+#define TEXT_CACHE_TEST_FRAMES 1000
+
+// The text of the error screen, as drawn by errorMessageLoop in main.c.
+struct TextCacheTestString {
+  const char *text;
+  u32 size;
+};
+
+static const struct TextCacheTestString textCacheTestScreen[] = {
+    {"Extract failed", 20},
+    {"Press HOME to exit.", 13},
+    {"Could not open file (-106).", 13},
+};
+#define TEXT_CACHE_TEST_SCREEN_STRINGS (sizeof(textCacheTestScreen) / sizeof(textCacheTestScreen[0]))
+
+static int textCacheTestFailures;
+
+static void textCacheTestExpect(bool condition, const char *what) {
+  if (!condition) {
+    printf("  FAIL: %s\n", what);
+    textCacheTestFailures++;
+  }
+}
+
+// The coverage of a string, drawn glyph by glyph with each blended over the last.
+static u8 textCacheTestExpected[TEXT_CACHE_TEST_HEIGHT][TEXT_CACHE_TEST_WIDTH];
+
+static void textCacheTestDrawGlyph(const struct Font *font, const struct FontGlyph *glyph, int x, int y, void *arg) {
+  u32 row;
+  u32 column;
+  for (row = 0; row < glyph->height; row++) {
+    for (column = 0; column < glyph->width; column++) {
+      u32 coverage = fontCoverage(font, glyph->x + column, glyph->y + row);
+      u8 *alpha = &textCacheTestExpected[y + row][x + column];
+      *alpha = *alpha + coverage - (*alpha * coverage) / 255;
+    }
+  }
+}
+
+// Returns the alpha of the given texel of a GX_TF_RGBA8 texture.
+static u8 textCacheTestAlpha(const GRRLIB_texImg *texture, u32 x, u32 y) {
+  const u8 *data = texture->data;
+  return data[((y / 4) * (texture->w / 4) + x / 4) * 64 + ((y % 4) * 4 + x % 4) * 2];
+}
+
+// Returns the entry of the given cache holding the given string, if any.
+static const struct TextCacheEntry *textCacheTestFind(const struct TextCache *cache, const char *text, u32 size) {
+  u32 i;
+  for (i = 0; i < TEXT_CACHE_ENTRIES; i++) {
+    if (cache->entries[i].lastUsed != 0 && cache->entries[i].size == size && strcmp(cache->entries[i].text, text) == 0) {
+      return &cache->entries[i];
+    }
+  }
+  return NULL;
+}
+
+// Checks the texture of the given string against its glyphs, drawn with the top-left of its line at the origin.
+static bool textCacheTestContents(const struct Font *font, const struct TextCacheEntry *entry, const char *text,
+                                  u32 size) {
+  memset(textCacheTestExpected, 0, sizeof(textCacheTestExpected));
+  fontLayout(font, text, size, textCacheTestDrawGlyph, NULL);
+
+  // Every texel of the texture must match, and nothing may be drawn outside of it.
+  u32 x;
+  u32 y;
+  for (y = 0; y < TEXT_CACHE_TEST_HEIGHT; y++) {
+    for (x = 0; x < TEXT_CACHE_TEST_WIDTH; x++) {
+      int tx = (int)x - entry->x;
+      int ty = (int)y - entry->y;
+      bool inside = tx >= 0 && ty >= 0 && tx < (int)entry->texture.w && ty < (int)entry->texture.h;
+      u8 actual = inside ? textCacheTestAlpha(&entry->texture, tx, ty) : 0;
+      if (actual != textCacheTestExpected[y][x]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  static struct Font font;
+  if (!fontLoad(&font, LiberationSans_Regular_font, LiberationSans_Regular_font_size)) {
+    printf("  could not load the baked font\n");
+    return 1;
+  }
+  static struct TextCache cache;
+  textCacheInit(&cache, &font);
+
+  // Every string of the error screen, at every size, matches its glyphs.
+  struct HostDrawStats draws;
+  u32 i;
+  u32 face;
+  for (face = 0; face < font.faceCount; face++) {
+    u32 size = font.faces[face].size;
+    for (i = 0; i < TEXT_CACHE_TEST_SCREEN_STRINGS; i++) {
+      const char *text = textCacheTestScreen[i].text;
+      textCacheDraw(&cache, 0, 0, text, size, 0xFFFFFFFF);
+      const struct TextCacheEntry *entry = textCacheTestFind(&cache, text, size);
+      textCacheTestExpect(entry != NULL && textCacheTestContents(&font, entry, text, size),
+                          "cached texture differs from its glyphs");
+    }
+  }
+
+  // A string already cached is drawn as a single quad, without being rendered again.
+  hostResetDrawStats();
+  textCacheDraw(&cache, 0, 0, textCacheTestScreen[0].text, font.faces[0].size, 0xFFFFFFFF);
+  hostGetDrawStats(&draws);
+  textCacheTestExpect(draws.quads == 1 && draws.images == 1 && draws.flushes == 0, "cached string rendered again");
+
+  // Filling the cache replaces the entry drawn least recently, reusing its buffer for a shorter string.
+  textCacheInit(&cache, &font);
+  char text[TEXT_CACHE_ENTRIES + 1][32];
+  for (i = 0; i <= TEXT_CACHE_ENTRIES; i++) {
+    snprintf(text[i], sizeof(text[i]), "Install (%u/%u) %s", i + 1, TEXT_CACHE_ENTRIES + 1, i == 0 ? "with more" : "");
+  }
+  for (i = 0; i < TEXT_CACHE_ENTRIES; i++) {
+    textCacheDraw(&cache, 0, 0, text[i], font.faces[0].size, 0xFFFFFFFF);
+  }
+  const struct TextCacheEntry *first = textCacheTestFind(&cache, text[0], font.faces[0].size);
+  void *buffer = first != NULL ? first->texture.data : NULL;
+  textCacheDraw(&cache, 0, 0, text[TEXT_CACHE_ENTRIES], font.faces[0].size, 0xFFFFFFFF);
+  const struct TextCacheEntry *replaced = textCacheTestFind(&cache, text[TEXT_CACHE_ENTRIES], font.faces[0].size);
+  textCacheTestExpect(textCacheTestFind(&cache, text[0], font.faces[0].size) == NULL && replaced == first,
+                      "least recently drawn entry not replaced");
+  textCacheTestExpect(replaced != NULL && replaced->texture.data == buffer, "buffer not reused");
+  textCacheTestExpect(replaced != NULL && textCacheTestContents(&font, replaced, text[TEXT_CACHE_ENTRIES],
+                                                                font.faces[0].size),
+                      "replaced texture differs from its glyphs");
+
+  // Strings too long to be kept are drawn glyph by glyph.
+  char longText[TEXT_CACHE_TEXT_SIZE + 1];
+  memset(longText, 'a', TEXT_CACHE_TEXT_SIZE);
+  longText[TEXT_CACHE_TEXT_SIZE] = '\0';
+  hostResetDrawStats();
+  textCacheDraw(&cache, 0, 0, longText, font.faces[0].size, 0xFFFFFFFF);
+  hostGetDrawStats(&draws);
+  textCacheTestExpect(draws.quads == TEXT_CACHE_TEXT_SIZE && draws.images == 0, "long string not drawn by glyph");
+
+  // What the error screen costs per frame, drawn glyph by glyph and through the cache.
+  hostResetDrawStats();
+  double start = hostSeconds();
+  u32 frame;
+  for (frame = 0; frame < TEXT_CACHE_TEST_FRAMES; frame++) {
+    for (i = 0; i < TEXT_CACHE_TEST_SCREEN_STRINGS; i++) {
+      fontPrint(&font, 0, 0, textCacheTestScreen[i].text, textCacheTestScreen[i].size, 0xFFFFFFFF);
+    }
+  }
+  double glyphSeconds = hostSeconds() - start;
+  hostGetDrawStats(&draws);
+  u64 glyphQuads = draws.quads;
+
+  textCacheInit(&cache, &font);
+  hostResetDrawStats();
+  start = hostSeconds();
+  for (frame = 0; frame < TEXT_CACHE_TEST_FRAMES; frame++) {
+    for (i = 0; i < TEXT_CACHE_TEST_SCREEN_STRINGS; i++) {
+      textCacheDraw(&cache, 0, 0, textCacheTestScreen[i].text, textCacheTestScreen[i].size, 0xFFFFFFFF);
+    }
+  }
+  double cacheSeconds = hostSeconds() - start;
+  hostGetDrawStats(&draws);
+  textCacheTestExpect(draws.quads == TEXT_CACHE_TEST_FRAMES * TEXT_CACHE_TEST_SCREEN_STRINGS &&
+                          draws.flushes == TEXT_CACHE_TEST_SCREEN_STRINGS,
+                      "error screen not drawn from the cache");
+  printf("  error screen per frame: %llu quads, %.2f us by glyph; %llu quads, %.2f us cached, %llu texels flushed once\n",
+         (unsigned long long)(glyphQuads / TEXT_CACHE_TEST_FRAMES), glyphSeconds * 1e6 / TEXT_CACHE_TEST_FRAMES,
+         (unsigned long long)(draws.quads / TEXT_CACHE_TEST_FRAMES), cacheSeconds * 1e6 / TEXT_CACHE_TEST_FRAMES,
+         (unsigned long long)draws.flushedPixels);
+
+  textCacheDestroy(&cache);
+  fontDestroy(&font);
+  if (textCacheTestFailures > 0) {
+    printf("  %d failures\n", textCacheTestFailures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,265 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host/host.h"
+#include "miniz.h"
+#include "zlib_ref.h"
+
+// Inflates streams deflated by zlib through tinfl, as the extractor does, and checks the
+// output against the original data. Then measures tinfl's throughput. The Makefile builds
+// this against the default configuration of miniz and the portable one, which is as on
+// PowerPC: no unaligned loads and no 64-bit registers.
+//
+// The streams cover every level and strategy, blocks ended by sync and full flushes, and
+// lengths around the dictionary size and the fast loop's input margins. Each is inflated
+// with the whole stream at once, in random chunks and a byte at a time.
+
+#define TINFL_TEST_BENCH_SIZE (16 * 1024 * 1024)
+#define TINFL_TEST_BENCH_RUNS 5
+#define TINFL_TEST_CHUNK 65536
+
+static u64 tinflTestState = 0x54494E46;
+
+static u32 tinflTestRandom() {
+  tinflTestState ^= tinflTestState << 13;
+  tinflTestState ^= tinflTestState >> 7;
+  tinflTestState ^= tinflTestState << 17;
+  return (u32)(tinflTestState >> 16);
+}
+
+enum TinflTestKind {
+  // Words, with matches at every distance up to the dictionary size.
+  TINFL_TEST_TEXT,
+  // Random bytes, stored by deflate.
+  TINFL_TEST_RANDOM,
+  // Long runs of a byte, as matches at distance one.
+  TINFL_TEST_RUNS,
+  // A random block repeated, as matches longer than their distance.
+  TINFL_TEST_PERIODIC,
+  // Runs of the above, with literals and matches in between.
+  TINFL_TEST_MIXED,
+  TINFL_TEST_KIND_COUNT,
+};
+
+static const char *tinflTestKindNames[] = {"text", "random", "runs", "periodic", "mixed"};
+
+static const char *tinflTestWords[] = {"channel", "shop", "homebrew", "wii", "install", "title",
+                                       "content", "nand", "download", "apps", "inflate", "dol"};
+#define TINFL_TEST_WORD_COUNT (sizeof(tinflTestWords) / sizeof(tinflTestWords[0]))
+
+static void tinflTestFill(u8 *data, size_t length, enum TinflTestKind kind) {
+  size_t i = 0;
+  while (i < length) {
+    enum TinflTestKind run = kind == TINFL_TEST_MIXED ? tinflTestRandom() % TINFL_TEST_MIXED : kind;
+    size_t end = kind == TINFL_TEST_MIXED ? i + 1 + tinflTestRandom() % 2048 : length;
+    if (end > length) {
+      end = length;
+    }
+    u32 period = 1 + tinflTestRandom() % 300;
+    u8 value = tinflTestRandom();
+    size_t start = i;
+    while (i < end) {
+      switch (run) {
+      case TINFL_TEST_TEXT: {
+        const char *word = tinflTestWords[tinflTestRandom() % TINFL_TEST_WORD_COUNT];
+        while (*word != '\0' && i < end) {
+          data[i++] = *word++;
+        }
+        if (i < end) {
+          data[i++] = tinflTestRandom() % 16 == 0 ? '\n' : ' ';
+        }
+        break;
+      }
+      case TINFL_TEST_RUNS:
+        if (tinflTestRandom() % 1000 == 0) {
+          value = tinflTestRandom();
+        }
+        data[i++] = value;
+        break;
+      case TINFL_TEST_PERIODIC:
+        data[i] = i - start < period ? (u8)tinflTestRandom() : data[i - period];
+        i++;
+        break;
+      default:
+        data[i++] = tinflTestRandom();
+        break;
+      }
+    }
+  }
+}
+
+enum TinflTestChunking {
+  TINFL_TEST_WHOLE,
+  TINFL_TEST_RANDOM_CHUNKS,
+  TINFL_TEST_BYTES,
+};
+
+static u8 tinflTestDict[TINFL_LZ_DICT_SIZE];
+
+// Inflates the given stream through a wrapping dictionary, as the extractor does, feeding
+// it in the given chunks. Compares the output with the expected data as it is written,
+// unless expected is NULL. Returns whether the stream inflated to exactly length bytes.
+static bool tinflTestInflate(const u8 *stream, size_t streamLength, const u8 *expected, size_t length,
+                             enum TinflTestChunking chunking) {
+  tinfl_decompressor inflator;
+  tinfl_init(&inflator);
+  size_t inPosition = 0;
+  size_t outPosition = 0;
+  size_t dictOffset = 0;
+  for (;;) {
+    size_t chunk = streamLength - inPosition;
+    if (chunking == TINFL_TEST_BYTES && chunk > 1) {
+      chunk = 1;
+    } else if (chunking == TINFL_TEST_RANDOM_CHUNKS && chunk > 1) {
+      chunk = 1 + tinflTestRandom() % (chunk < 4096 ? chunk : 4096);
+    }
+    size_t inBytes = chunk;
+    size_t outBytes = TINFL_LZ_DICT_SIZE - dictOffset;
+    mz_uint32 flags = inPosition + chunk < streamLength ? TINFL_FLAG_HAS_MORE_INPUT : 0;
+    tinfl_status status = tinfl_decompress(&inflator, stream + inPosition, &inBytes, tinflTestDict,
+                                           tinflTestDict + dictOffset, &outBytes, flags);
+    inPosition += inBytes;
+    if (outPosition + outBytes > length ||
+        (expected != NULL && memcmp(tinflTestDict + dictOffset, expected + outPosition, outBytes) != 0)) {
+      return false;
+    }
+    outPosition += outBytes;
+    dictOffset = (dictOffset + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+    if (status == TINFL_STATUS_DONE) {
+      return outPosition == length;
+    }
+    if (status < TINFL_STATUS_DONE || (status == TINFL_STATUS_NEEDS_MORE_INPUT && inPosition == streamLength)) {
+      return false;
+    }
+  }
+}
+
+static const size_t tinflTestLengths[] = {0,     1,     2,     3,     7,     8,     9,     15,     16,
+                                          17,    255,   256,   257,   1000,  4095,  4096,  32767,  32768,
+                                          32769, 65535, 65536, 65537, 98304, 200000};
+#define TINFL_TEST_LENGTH_COUNT (sizeof(tinflTestLengths) / sizeof(tinflTestLengths[0]))
+
+static const int tinflTestLevels[] = {0, 1, 6, 9};
+static const int tinflTestStrategies[] = {Z_DEFAULT_STRATEGY, Z_FILTERED, Z_HUFFMAN_ONLY, Z_RLE, Z_FIXED};
+static const size_t tinflTestFlushIntervals[] = {0, 1000, 20000};
+
+static int tinflTestFailures;
+static u32 tinflTestStreams;
+
+static void tinflTestStream(const u8 *data, size_t length, enum TinflTestKind kind, int level, int strategy,
+                            size_t flushInterval) {
+  size_t streamLength;
+  u8 *stream = zlibDeflateRaw(data, length, level, strategy, flushInterval, &streamLength);
+  if (stream == NULL) {
+    printf("  FAIL: zlib could not deflate %s, length %zu\n", tinflTestKindNames[kind], length);
+    tinflTestFailures++;
+    return;
+  }
+  tinflTestStreams++;
+  enum TinflTestChunking chunking;
+  for (chunking = TINFL_TEST_WHOLE; chunking <= TINFL_TEST_BYTES; chunking++) {
+    if (chunking == TINFL_TEST_BYTES && length > 65537) {
+      continue;
+    }
+    if (!tinflTestInflate(stream, streamLength, data, length, chunking)) {
+      printf("  FAIL: %s, length %zu, level %d, strategy %d, flush every %zu, chunking %d\n",
+             tinflTestKindNames[kind], length, level, strategy, flushInterval, chunking);
+      tinflTestFailures++;
+    }
+  }
+  free(stream);
+}
+
+static int tinflTestCompare(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return x < y ? -1 : x > y;
+}
+
+// Returns the median throughput of inflating the given stream in 64KB chunks, in MB/s.
+static double tinflTestThroughput(const u8 *stream, size_t streamLength, size_t length) {
+  double rates[TINFL_TEST_BENCH_RUNS];
+  u32 run;
+  for (run = 0; run < TINFL_TEST_BENCH_RUNS; run++) {
+    double start = hostSeconds();
+    tinfl_decompressor inflator;
+    tinfl_init(&inflator);
+    size_t inPosition = 0;
+    size_t dictOffset = 0;
+    tinfl_status status;
+    do {
+      size_t inBytes = streamLength - inPosition < TINFL_TEST_CHUNK ? streamLength - inPosition : TINFL_TEST_CHUNK;
+      size_t outBytes = TINFL_LZ_DICT_SIZE - dictOffset;
+      mz_uint32 flags = inPosition + inBytes < streamLength ? TINFL_FLAG_HAS_MORE_INPUT : 0;
+      status = tinfl_decompress(&inflator, stream + inPosition, &inBytes, tinflTestDict, tinflTestDict + dictOffset,
+                                &outBytes, flags);
+      inPosition += inBytes;
+      dictOffset = (dictOffset + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+    } while (status > TINFL_STATUS_DONE);
+    rates[run] = status == TINFL_STATUS_DONE ? length / (hostSeconds() - start) / 1e6 : 0;
+  }
+  qsort(rates, TINFL_TEST_BENCH_RUNS, sizeof(double), tinflTestCompare);
+  return rates[TINFL_TEST_BENCH_RUNS / 2];
+}
+
+int main(int argc, char **argv) {
+  size_t maxLength = tinflTestLengths[TINFL_TEST_LENGTH_COUNT - 1];
+  u8 *data = malloc(TINFL_TEST_BENCH_SIZE > maxLength ? TINFL_TEST_BENCH_SIZE : maxLength);
+  if (data == NULL) {
+    return 1;
+  }
+
+  enum TinflTestKind kind;
+  u32 length;
+  u32 level;
+  u32 strategy;
+  u32 flush;
+  for (kind = 0; kind < TINFL_TEST_KIND_COUNT; kind++) {
+    for (length = 0; length < TINFL_TEST_LENGTH_COUNT; length++) {
+      tinflTestFill(data, tinflTestLengths[length], kind);
+      for (level = 0; level < sizeof(tinflTestLevels) / sizeof(int); level++) {
+        // Stored blocks do not depend on the strategy.
+        u32 strategies = tinflTestLevels[level] == 0 ? 1 : sizeof(tinflTestStrategies) / sizeof(int);
+        for (strategy = 0; strategy < strategies; strategy++) {
+          for (flush = 0; flush < sizeof(tinflTestFlushIntervals) / sizeof(size_t); flush++) {
+            tinflTestStream(data, tinflTestLengths[length], kind, tinflTestLevels[level],
+                            tinflTestStrategies[strategy], tinflTestFlushIntervals[flush]);
+          }
+        }
+      }
+    }
+  }
+
+  // A truncated stream must not be reported as done.
+  tinflTestFill(data, 100000, TINFL_TEST_TEXT);
+  size_t streamLength;
+  u8 *stream = zlibDeflateRaw(data, 100000, 6, Z_DEFAULT_STRATEGY, 0, &streamLength);
+  if (stream == NULL || tinflTestInflate(stream, streamLength / 2, data, 100000, TINFL_TEST_WHOLE)) {
+    printf("  FAIL: truncated stream\n");
+    tinflTestFailures++;
+  }
+  free(stream);
+  printf("  %u streams inflated\n", tinflTestStreams);
+
+  static const enum TinflTestKind benchKinds[] = {TINFL_TEST_TEXT, TINFL_TEST_MIXED};
+  u32 bench;
+  for (bench = 0; bench < sizeof(benchKinds) / sizeof(benchKinds[0]); bench++) {
+    kind = benchKinds[bench];
+    tinflTestFill(data, TINFL_TEST_BENCH_SIZE, kind);
+    stream = zlibDeflateRaw(data, TINFL_TEST_BENCH_SIZE, 6, Z_DEFAULT_STRATEGY, 0, &streamLength);
+    if (stream == NULL) {
+      return 1;
+    }
+    printf("  %s: %.1f MB/s\n", tinflTestKindNames[kind],
+           tinflTestThroughput(stream, streamLength, TINFL_TEST_BENCH_SIZE));
+    free(stream);
+  }
+
+  free(data);
+  if (tinflTestFailures > 0) {
+    printf("  %d failures\n", tinflTestFailures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,59 @@
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include "zlib_ref.h"
+
+// zlib, as the reference the tests compare miniz against. It lives apart from the tests,
+// as miniz.h defines zlib's names as macros of its own.
+
+unsigned long zlibCrc32(unsigned long crc, const unsigned char *data, size_t length) {
+  while (length > 0) {
+    uInt chunk = length > 0x40000000 ? 0x40000000 : (uInt)length;
+    crc = crc32(crc, data, chunk);
+    data += chunk;
+    length -= chunk;
+  }
+  return crc;
+}
+
+unsigned char *zlibDeflateRaw(const unsigned char *data, size_t length, int level, int strategy,
+                              size_t flushInterval, size_t *compressedLength) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (deflateInit2(&stream, level, Z_DEFLATED, -15, 8, strategy) != Z_OK) {
+    return NULL;
+  }
+
+  // Each flush adds at most a few bytes, on top of deflate's own bound.
+  size_t capacity = deflateBound(&stream, length) + 16;
+  if (flushInterval > 0) {
+    capacity += (length / flushInterval + 1) * 16;
+  }
+  unsigned char *out = malloc(capacity);
+  if (out == NULL) {
+    deflateEnd(&stream);
+    return NULL;
+  }
+  stream.next_out = out;
+  stream.avail_out = capacity;
+
+  size_t position = 0;
+  unsigned flushes = 0;
+  int result = Z_OK;
+  while (result == Z_OK) {
+    size_t piece = flushInterval > 0 && length - position > flushInterval ? flushInterval : length - position;
+    int flush = position + piece == length ? Z_FINISH : flushes++ % 2 == 0 ? Z_SYNC_FLUSH : Z_FULL_FLUSH;
+    stream.next_in = (unsigned char *)data + position;
+    stream.avail_in = piece;
+    result = deflate(&stream, flush);
+    position += piece - stream.avail_in;
+  }
+  deflateEnd(&stream);
+  if (result != Z_STREAM_END) {
+    free(out);
+    return NULL;
+  }
+  *compressedLength = stream.total_out;
+  return out;
+}
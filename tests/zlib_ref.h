@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stddef.h>
+
+// Returns zlib's CRC-32 of the given data, continuing from the given CRC.
+unsigned long zlibCrc32(unsigned long crc, const unsigned char *data, size_t length);
+
+// Deflates the given data to a raw deflate stream with zlib, ending a block with a sync
+// flush and then a full flush, alternately, every flushInterval bytes if non-zero.
+// Returns the stream, to be freed by the caller, or NULL upon failure.
+unsigned char *zlibDeflateRaw(const unsigned char *data, size_t length, int level, int strategy,
+                              size_t flushInterval, size_t *compressedLength);
@@ -0,0 +1,281 @@
+// bakefont bakes the printable ASCII glyphs of a TrueType font, at the given pixel sizes,
+// into a texture atlas along with the metrics needed to lay them out.
+//
+// It runs on the build machine, so that the downloader neither embeds nor parses the font,
+// and no glyph is rasterized on the console. Glyphs are rendered and positioned exactly as
+// GRRLIB_PrintfTTF does, so text is drawn as it was before.
+//
+// Usage: bakefont <font.ttf> <output.font> <size>...
+//
+// The output is big-endian, as read by source/font.c:
+//   char magic[4]      "FONT"
+//   u16  version       FONT_VERSION
+//   u16  sizeCount
+//   u16  atlasWidth
+//   u16  atlasHeight
+//   u16  firstChar
+//   u16  glyphCount
+//   sizeCount times:   u16 pixelSize, u16 kerningCount
+//   sizeCount times:   glyphCount times: u16 x, u16 y, u8 width, u8 height, s8 left, s8 top, u8 advance, u8 reserved
+//   sizeCount times:   kerningCount times: u8 left, u8 right, s8 amount, u8 reserved, ordered by left
+//   padding to a multiple of 32 bytes
+//   the atlas, as a GX_TF_RGBA8 texture: white, with the glyph's coverage as alpha.
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FONT_VERSION 1
+
+#define FIRST_CHAR 32
+#define LAST_CHAR 126
+#define GLYPH_COUNT (LAST_CHAR - FIRST_CHAR + 1)
+#define MAX_SIZES 8
+
+// The width of the atlas, and the space left around every glyph so that filtering
+// never samples a neighbour.
+#define ATLAS_WIDTH 256
+#define GLYPH_PADDING 1
+
+struct Glyph {
+  int x, y;
+  int width, height;
+  int left, top;
+  int advance;
+  unsigned char *coverage;
+};
+
+struct Kerning {
+  int left, right, amount;
+};
+
+struct Size {
+  int pixels;
+  struct Glyph glyphs[GLYPH_COUNT];
+  struct Kerning *kerning;
+  int kerningCount;
+};
+
+static void fail(const char *message, const char *detail) {
+  fprintf(stderr, "bakefont: %s%s%s\n", message, detail != NULL ? ": " : "", detail != NULL ? detail : "");
+  exit(1);
+}
+
+// Renders every glyph of the given size, as GRRLIB_PrintfTTF does.
+static void renderSize(FT_Face face, struct Size *size) {
+  if (FT_Set_Pixel_Sizes(face, 0, size->pixels)) {
+    fail("could not set pixel size", NULL);
+  }
+
+  int c;
+  for (c = FIRST_CHAR; c <= LAST_CHAR; c++) {
+    struct Glyph *glyph = &size->glyphs[c - FIRST_CHAR];
+    if (FT_Load_Glyph(face, FT_Get_Char_Index(face, c), FT_LOAD_RENDER)) {
+      fail("could not render glyph", NULL);
+    }
+
+    FT_GlyphSlot slot = face->glyph;
+    if (slot->bitmap.width > 255 || slot->bitmap.rows > 255 || slot->bitmap_left < -128 ||
+        slot->bitmap_left > 127 || slot->bitmap_top < -128 || slot->bitmap_top > 127 || (slot->advance.x >> 6) > 255) {
+      fail("glyph too large", NULL);
+    }
+
+    glyph->width = slot->bitmap.width;
+    glyph->height = slot->bitmap.rows;
+    glyph->left = slot->bitmap_left;
+    glyph->top = slot->bitmap_top;
+    glyph->advance = slot->advance.x >> 6;
+    glyph->coverage = calloc(glyph->width * glyph->height + 1, 1);
+    int row;
+    for (row = 0; row < glyph->height; row++) {
+      memcpy(glyph->coverage + row * glyph->width, slot->bitmap.buffer + row * slot->bitmap.pitch, glyph->width);
+    }
+  }
+
+  // Kerning is applied between glyphs as GRRLIB_PrintfTTF does, should the font have any.
+  size->kerning = malloc(GLYPH_COUNT * GLYPH_COUNT * sizeof(struct Kerning));
+  size->kerningCount = 0;
+  if (!FT_HAS_KERNING(face)) {
+    return;
+  }
+
+  int left, right;
+  for (left = FIRST_CHAR; left <= LAST_CHAR; left++) {
+    for (right = FIRST_CHAR; right <= LAST_CHAR; right++) {
+      FT_Vector delta;
+      if (FT_Get_Kerning(face, FT_Get_Char_Index(face, left), FT_Get_Char_Index(face, right), FT_KERNING_DEFAULT, &delta)) {
+        continue;
+      }
+      int amount = delta.x >> 6;
+      if (amount != 0) {
+        struct Kerning *kerning = &size->kerning[size->kerningCount++];
+        kerning->left = left;
+        kerning->right = right;
+        kerning->amount = amount;
+      }
+    }
+  }
+}
+
+// Places every glyph within the atlas in rows, returning the height of the atlas.
+static int packGlyphs(struct Size *sizes, int sizeCount) {
+  int x = 0;
+  int y = 0;
+  int rowHeight = 0;
+
+  int s, i;
+  for (s = 0; s < sizeCount; s++) {
+    for (i = 0; i < GLYPH_COUNT; i++) {
+      struct Glyph *glyph = &sizes[s].glyphs[i];
+      int width = glyph->width + GLYPH_PADDING * 2;
+      int height = glyph->height + GLYPH_PADDING * 2;
+      if (x + width > ATLAS_WIDTH) {
+        x = 0;
+        y += rowHeight;
+        rowHeight = 0;
+      }
+
+      glyph->x = x + GLYPH_PADDING;
+      glyph->y = y + GLYPH_PADDING;
+      x += width;
+      if (height > rowHeight) {
+        rowHeight = height;
+      }
+    }
+  }
+
+  // GX textures are made of 4x4 tiles.
+  return (y + rowHeight + 3) & ~3;
+}
+
+// Converts the given coverage to a tiled GX_TF_RGBA8 texture.
+// Each 4x4 tile holds its alpha and red values, followed by its green and blue values.
+static unsigned char *tileAtlas(const unsigned char *coverage, int width, int height) {
+  unsigned char *texture = malloc(width * height * 4);
+  unsigned char *out = texture;
+
+  int tileX, tileY, x, y;
+  for (tileY = 0; tileY < height; tileY += 4) {
+    for (tileX = 0; tileX < width; tileX += 4) {
+      for (y = tileY; y < tileY + 4; y++) {
+        for (x = tileX; x < tileX + 4; x++) {
+          *out++ = coverage[y * width + x];
+          *out++ = 0xFF;
+        }
+      }
+      for (y = 0; y < 16; y++) {
+        *out++ = 0xFF;
+        *out++ = 0xFF;
+      }
+    }
+  }
+
+  return texture;
+}
+
+static void write8(FILE *file, int value) {
+  fputc(value & 0xFF, file);
+}
+
+static void write16(FILE *file, int value) {
+  write8(file, value >> 8);
+  write8(file, value);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 4 || argc - 3 > MAX_SIZES) {
+    fprintf(stderr, "usage: bakefont <font.ttf> <output.font> <size>...\n");
+    return 1;
+  }
+
+  FT_Library library;
+  FT_Face face;
+  if (FT_Init_FreeType(&library)) {
+    fail("could not initialize FreeType", NULL);
+  }
+  if (FT_New_Face(library, argv[1], 0, &face)) {
+    fail("could not open font", argv[1]);
+  }
+
+  static struct Size sizes[MAX_SIZES];
+  int sizeCount = argc - 3;
+  int s, i;
+  for (s = 0; s < sizeCount; s++) {
+    sizes[s].pixels = atoi(argv[3 + s]);
+    if (sizes[s].pixels <= 0 || sizes[s].pixels > 255) {
+      fail("invalid size", argv[3 + s]);
+    }
+    renderSize(face, &sizes[s]);
+  }
+
+  int height = packGlyphs(sizes, sizeCount);
+  if (height > 1024) {
+    fail("glyphs do not fit within the atlas", NULL);
+  }
+
+  unsigned char *coverage = calloc(ATLAS_WIDTH * height, 1);
+  for (s = 0; s < sizeCount; s++) {
+    for (i = 0; i < GLYPH_COUNT; i++) {
+      const struct Glyph *glyph = &sizes[s].glyphs[i];
+      int row;
+      for (row = 0; row < glyph->height; row++) {
+        memcpy(coverage + (glyph->y + row) * ATLAS_WIDTH + glyph->x, glyph->coverage + row * glyph->width, glyph->width);
+      }
+    }
+  }
+
+  FILE *file = fopen(argv[2], "wb");
+  if (file == NULL) {
+    fail("could not create output", argv[2]);
+  }
+
+  fwrite("FONT", 1, 4, file);
+  write16(file, FONT_VERSION);
+  write16(file, sizeCount);
+  write16(file, ATLAS_WIDTH);
+  write16(file, height);
+  write16(file, FIRST_CHAR);
+  write16(file, GLYPH_COUNT);
+  for (s = 0; s < sizeCount; s++) {
+    write16(file, sizes[s].pixels);
+    write16(file, sizes[s].kerningCount);
+  }
+  for (s = 0; s < sizeCount; s++) {
+    for (i = 0; i < GLYPH_COUNT; i++) {
+      const struct Glyph *glyph = &sizes[s].glyphs[i];
+      write16(file, glyph->x);
+      write16(file, glyph->y);
+      write8(file, glyph->width);
+      write8(file, glyph->height);
+      write8(file, glyph->left);
+      write8(file, glyph->top);
+      write8(file, glyph->advance);
+      write8(file, 0);
+    }
+  }
+  for (s = 0; s < sizeCount; s++) {
+    for (i = 0; i < sizes[s].kerningCount; i++) {
+      write8(file, sizes[s].kerning[i].left);
+      write8(file, sizes[s].kerning[i].right);
+      write8(file, sizes[s].kerning[i].amount);
+      write8(file, 0);
+    }
+  }
+  while (ftell(file) % 32 != 0) {
+    write8(file, 0);
+  }
+
+  unsigned char *texture = tileAtlas(coverage, ATLAS_WIDTH, height);
+  fwrite(texture, 1, ATLAS_WIDTH * height * 4, file);
+  if (fclose(file) != 0) {
+    fail("could not write output", argv[2]);
+  }
+
+  FT_Done_Face(face);
+  FT_Done_FreeType(library);
+  return 0;
+}
@@ -0,0 +1,139 @@
+// bakeimage converts a PNG image in to a GX texture, ready to be drawn without any decoding.
+//
+// GRRLIB_LoadTexturePNG decodes an image through libpng and then converts it in to tiles at
+// startup. Doing both on the build machine lets the downloader draw the image straight from
+// the DOL.
+//
+// Usage: bakeimage <image.png> <output.tex>
+//
+// The output is big-endian, as read by source/texture.c:
+//   char magic[4]      "GXTX"
+//   u16  version       TEXTURE_VERSION
+//   u16  format        TEXTURE_FORMAT_RGBA8, the only format GRRLIB draws
+//   u16  width         padded to a multiple of 4
+//   u16  height        padded to a multiple of 4
+//   padding to 32 bytes
+//   the texture, in 4x4 tiles, each holding its alpha and red values followed by its green and blue values.
+//
+// Padding is left transparent, to the right and bottom of the image, so that the image is drawn
+// at the same position and scale as it was before.
+
+#include <png.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEXTURE_VERSION 1
+#define TEXTURE_FORMAT_RGBA8 6
+#define TEXTURE_HEADER_SIZE 32
+
+static void fail(const char *message, const char *detail) {
+  fprintf(stderr, "bakeimage: %s%s%s\n", message, detail != NULL ? ": " : "", detail != NULL ? detail : "");
+  exit(1);
+}
+
+static void write8(FILE *file, int value) {
+  fputc(value & 0xFF, file);
+}
+
+static void write16(FILE *file, int value) {
+  write8(file, value >> 8);
+  write8(file, value);
+}
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    fprintf(stderr, "usage: bakeimage <image.png> <output.tex>\n");
+    return 1;
+  }
+
+  // Decode to 8-bit RGBA, as GRRLIB_LoadTexturePNG does through PNGU: palettes and low bit
+  // depths are expanded, transparency becomes alpha, 16-bit channels are truncated rather than
+  // rounded, and opaque images are given an alpha of 255.
+  FILE *input = fopen(argv[1], "rb");
+  if (input == NULL) {
+    fail("could not open image", argv[1]);
+  }
+  png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+  png_infop info = png_create_info_struct(png);
+  if (png == NULL || info == NULL) {
+    fail("could not allocate decoder", NULL);
+  }
+  if (setjmp(png_jmpbuf(png))) {
+    fail("could not decode image", argv[1]);
+  }
+  png_init_io(png, input);
+  png_read_info(png, info);
+  png_set_expand(png);
+  png_set_strip_16(png);
+  png_set_gray_to_rgb(png);
+  png_set_add_alpha(png, 0xFF, PNG_FILLER_AFTER);
+  png_read_update_info(png, info);
+
+  unsigned int imageWidth = png_get_image_width(png, info);
+  unsigned int imageHeight = png_get_image_height(png, info);
+  unsigned char *pixels = malloc((size_t)imageWidth * imageHeight * 4);
+  png_bytep *rows = malloc(imageHeight * sizeof(png_bytep));
+  if (pixels == NULL || rows == NULL) {
+    fail("could not allocate image", argv[1]);
+  }
+  unsigned int row;
+  for (row = 0; row < imageHeight; row++) {
+    rows[row] = pixels + (size_t)row * imageWidth * 4;
+  }
+  png_read_image(png, rows);
+  png_read_end(png, NULL);
+  png_destroy_read_struct(&png, &info, NULL);
+  free(rows);
+  fclose(input);
+
+  int width = (imageWidth + 3) & ~3;
+  int height = (imageHeight + 3) & ~3;
+  if (width > 1024 || height > 1024) {
+    fail("image too large for a GX texture", argv[1]);
+  }
+
+  FILE *file = fopen(argv[2], "wb");
+  if (file == NULL) {
+    fail("could not create output", argv[2]);
+  }
+
+  fwrite("GXTX", 1, 4, file);
+  write16(file, TEXTURE_VERSION);
+  write16(file, TEXTURE_FORMAT_RGBA8);
+  write16(file, width);
+  write16(file, height);
+  while (ftell(file) < TEXTURE_HEADER_SIZE) {
+    write8(file, 0);
+  }
+
+  int tileX, tileY, x, y, channel;
+  for (tileY = 0; tileY < height; tileY += 4) {
+    for (tileX = 0; tileX < width; tileX += 4) {
+      // Alpha and red, then green and blue, for each of the tile's 16 texels.
+      static const int channels[2][2] = {{3, 0}, {1, 2}};
+      int half;
+      for (half = 0; half < 2; half++) {
+        for (y = tileY; y < tileY + 4; y++) {
+          for (x = tileX; x < tileX + 4; x++) {
+            for (channel = 0; channel < 2; channel++) {
+              int value = 0;
+              if (x < (int)imageWidth && y < (int)imageHeight) {
+                value = pixels[(y * imageWidth + x) * 4 + channels[half][channel]];
+              }
+              write8(file, value);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  if (fclose(file) != 0) {
+    fail("could not write output", argv[2]);
+  }
+
+  free(pixels);
+  return 0;
+}